@@ -1,6 +1,7 @@
 #ifndef __XTEN_ALL_H__
 #define __XTEN_ALL_H__
 #include"log.h"
+#include"binlog.h"
 #include"util.h"
 #include"config.h"
 #include"fiber.h"
@@ -0,0 +1,86 @@
+#include "arena.h"
+#include "objpool.h"
+namespace Xten
+{
+    Arena::Arena(size_t block_size)
+        : _blockSize(block_size < 1024 ? 1024 : block_size)
+    {
+    }
+
+    Arena::~Arena()
+    {
+        freeBlocks(_blocks);
+        freeBlocks(_first);
+    }
+
+    void Arena::Reset()
+    {
+        freeBlocks(_blocks);
+        _blocks = nullptr;
+        if (_first)
+        {
+            _cur = (char *)(_first + 1);
+            _end = (char *)_first + _first->size;
+        }
+        else
+        {
+            _cur = _end = nullptr;
+        }
+        _usedBytes = 0;
+    }
+
+    void *Arena::do_allocate(size_t bytes, size_t alignment)
+    {
+        _allocCount++;
+        _usedBytes += bytes;
+        char *ptr = (char *)(((uintptr_t)_cur + alignment - 1) & ~(uintptr_t)(alignment - 1));
+        if (_cur && ptr + bytes <= _end)
+        {
+            _cur = ptr + bytes;
+            return ptr;
+        }
+        if (bytes + alignment > _blockSize / 2)
+        {
+            // 大的分配单独一块 当前块继续使用
+            Block *block = newBlock(bytes + alignment);
+            block->next = _blocks;
+            _blocks = block;
+            return (void *)(((uintptr_t)(block + 1) + alignment - 1) & ~(uintptr_t)(alignment - 1));
+        }
+        Block *block = newBlock(_blockSize);
+        if (!_first)
+        {
+            _first = block;
+        }
+        else
+        {
+            block->next = _blocks;
+            _blocks = block;
+        }
+        _cur = (char *)(block + 1);
+        _end = (char *)block + block->size;
+        ptr = (char *)(((uintptr_t)_cur + alignment - 1) & ~(uintptr_t)(alignment - 1));
+        _cur = ptr + bytes;
+        return ptr;
+    }
+
+    Arena::Block *Arena::newBlock(size_t bytes)
+    {
+        size_t size = bytes + sizeof(Block);
+        Block *block = (Block *)ObjPoolAllocator::Alloc(size);
+        block->next = nullptr;
+        block->size = size;
+        _blockCount++;
+        return block;
+    }
+
+    void Arena::freeBlocks(Block *head)
+    {
+        while (head)
+        {
+            Block *next = head->next;
+            ObjPoolAllocator::Dealloc(head, head->size);
+            head = next;
+        }
+    }
+}
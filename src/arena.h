@@ -0,0 +1,61 @@
+#ifndef __XTEN_ARENA_H__
+#define __XTEN_ARENA_H__
+#include <memory_resource>
+#include <memory>
+#include <cstdint>
+#include "nocopyable.hpp"
+namespace Xten
+{
+    /// @brief 请求级单调内存池(pmr::memory_resource) 只分配不单独释放 Reset时一次性回收
+    /// 内存块从ObjPoolAllocator申请 Reset保留第一块给下一个请求复用
+    /// 非线程安全: 同一时刻只在处理该请求的协程中使用
+    class Arena : public std::pmr::memory_resource, public NoCopyable
+    {
+    public:
+        typedef std::shared_ptr<Arena> ptr;
+        // block_size: 普通内存块大小 超过一半的分配单独占用一块
+        explicit Arena(size_t block_size = 8 * 1024);
+        ~Arena();
+        // 回收所有分配 保留第一块
+        void Reset();
+        // 分配次数
+        uint64_t GetAllocCount() const { return _allocCount; }
+        // 向ObjPoolAllocator申请内存块的次数
+        uint64_t GetBlockCount() const { return _blockCount; }
+        // 当前已分配的字节数
+        size_t GetUsedBytes() const { return _usedBytes; }
+        // 普通内存块大小
+        size_t GetBlockSize() const { return _blockSize; }
+
+    protected:
+        virtual void *do_allocate(size_t bytes, size_t alignment) override;
+        virtual void do_deallocate(void *ptr, size_t bytes, size_t alignment) override {}
+        virtual bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+
+    private:
+        // 内存块头部
+        struct Block
+        {
+            Block *next; // 下一个内存块
+            size_t size; // 内存块大小(包含头部)
+        };
+        // 申请一个至少能放下bytes的内存块
+        Block *newBlock(size_t bytes);
+        // 释放从head开始的内存块链表
+        static void freeBlocks(Block *head);
+
+    private:
+        size_t _blockSize;       // 普通内存块大小
+        Block *_first = nullptr; // 第一块(Reset保留)
+        Block *_blocks = nullptr; // 之后申请的内存块
+        char *_cur = nullptr;    // 当前块可用位置
+        char *_end = nullptr;    // 当前块末尾
+        uint64_t _allocCount = 0;
+        uint64_t _blockCount = 0;
+        size_t _usedBytes = 0;
+    };
+}
+#endif
@@ -0,0 +1,356 @@
+#include "binlog.h"
+namespace Xten
+{
+    // 记录编码辅助函数
+    template <class T>
+    static inline void PutValue(std::string &out, T val)
+    {
+        out.append((const char *)&val, sizeof(val));
+    }
+    static inline void PutString(std::string &out, const char *str, size_t len)
+    {
+        PutValue<uint32_t>(out, len);
+        out.append(str, len);
+    }
+    // 开始一条记录 预留长度字段 返回记录起始位置
+    static inline size_t BeginRecord(std::string &out, uint8_t type)
+    {
+        size_t begin = out.size();
+        PutValue<uint32_t>(out, 0);
+        PutValue<uint8_t>(out, type);
+        return begin;
+    }
+    // 结束一条记录 回填长度
+    static inline void EndRecord(std::string &out, size_t begin)
+    {
+        uint32_t len = out.size() - begin;
+        memcpy(&out[begin], &len, sizeof(len));
+    }
+
+    uint32_t LogSiteRegistry::Register(LogSite &site, const uint8_t *types, size_t count)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        uint32_t id = site.id.load(std::memory_order_relaxed);
+        if (id != 0)
+        {
+            return id;
+        }
+        site.types.assign(types, types + count);
+        _sites.push_back(&site);
+        id = _sites.size();
+        std::string record;
+        size_t begin = BeginRecord(record, LOG_RECORD_SITE);
+        PutValue<uint32_t>(record, id);
+        PutValue<uint8_t>(record, site.level);
+        PutValue<uint32_t>(record, site.line);
+        PutString(record, site.file, strlen(site.file));
+        PutString(record, site.fmt, strlen(site.fmt));
+        PutValue<uint8_t>(record, count);
+        record.append((const char *)types, count);
+        EndRecord(record, begin);
+        addDict(std::move(record));
+        site.id.store(id, std::memory_order_release);
+        return id;
+    }
+    uint32_t LogSiteRegistry::InternName(const std::string &name)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto it = _names.find(name);
+        if (it != _names.end())
+        {
+            return it->second;
+        }
+        uint32_t id = _names.size() + 1;
+        _names[name] = id;
+        std::string record;
+        size_t begin = BeginRecord(record, LOG_RECORD_NAME);
+        PutValue<uint32_t>(record, id);
+        PutString(record, name.data(), name.size());
+        EndRecord(record, begin);
+        addDict(std::move(record));
+        return id;
+    }
+    LogSite *LogSiteRegistry::GetSite(uint32_t id)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (id == 0 || id > _sites.size())
+        {
+            return nullptr;
+        }
+        return _sites[id - 1];
+    }
+    size_t LogSiteRegistry::GetDictSize()
+    {
+        return _dictSize.load(std::memory_order_acquire);
+    }
+    size_t LogSiteRegistry::AppendDict(size_t from, std::string &out)
+    {
+        if (from >= GetDictSize())
+        {
+            return from;
+        }
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (size_t i = from; i < _dict.size(); i++)
+        {
+            out.append(_dict[i]);
+        }
+        return _dict.size();
+    }
+    void LogSiteRegistry::addDict(std::string &&record)
+    {
+        _dict.push_back(std::move(record));
+        _dictSize.store(_dict.size(), std::memory_order_release);
+    }
+
+    // 用一个printf转换说明格式化一个值
+    template <class T>
+    static void AppendFormat(std::string &out, const std::string &spec, T val)
+    {
+        char buf[128];
+        int n = snprintf(buf, sizeof(buf), spec.c_str(), val);
+        if (n < 0)
+        {
+            return;
+        }
+        if ((size_t)n < sizeof(buf))
+        {
+            out.append(buf, n);
+            return;
+        }
+        size_t old = out.size();
+        out.resize(old + n + 1);
+        snprintf(&out[old], n + 1, spec.c_str(), val);
+        out.resize(old + n);
+    }
+    std::string LogBinaryFormat(const char *fmt, const uint8_t *types, size_t count, const char *data, size_t len)
+    {
+        std::string out;
+        const char *end = data + len;
+        size_t arg = 0;
+        for (const char *p = fmt; *p; p++)
+        {
+            if (*p != '%')
+            {
+                out.push_back(*p);
+                continue;
+            }
+            if (p[1] == '%')
+            {
+                out.push_back('%');
+                p++;
+                continue;
+            }
+            // 解析转换说明: 标志 宽度 精度 (去掉长度修饰 按记录的参数类型重新指定)
+            std::string spec = "%";
+            const char *q = p + 1;
+            while (*q && strchr("-+ #0'", *q))
+            {
+                spec.push_back(*q++);
+            }
+            while (*q && (isdigit(*q) || *q == '.'))
+            {
+                spec.push_back(*q++);
+            }
+            while (*q && strchr("hlLqjzt", *q))
+            {
+                q++;
+            }
+            if (!*q)
+            {
+                out.append(p);
+                break;
+            }
+            char conv = *q;
+            p = q;
+            if (arg >= count)
+            {
+                out.append("<<missing>>");
+                continue;
+            }
+            uint8_t type = types[arg++];
+            bool is_float = strchr("fFeEgGaA", conv) != nullptr;
+            if (type == LOG_ARG_STRING)
+            {
+                uint32_t slen = 0;
+                if (data + sizeof(slen) > end)
+                {
+                    out.append("<<truncated>>");
+                    break;
+                }
+                memcpy(&slen, data, sizeof(slen));
+                data += sizeof(slen);
+                if (data + slen > end)
+                {
+                    out.append("<<truncated>>");
+                    break;
+                }
+                std::string str(data, slen);
+                data += slen;
+                if (conv == 's')
+                {
+                    AppendFormat(out, spec + 's', str.c_str());
+                }
+                else
+                {
+                    out.append(str);
+                }
+                continue;
+            }
+            uint64_t raw = 0;
+            if (data + sizeof(raw) > end)
+            {
+                out.append("<<truncated>>");
+                break;
+            }
+            memcpy(&raw, data, sizeof(raw));
+            data += sizeof(raw);
+            if (type == LOG_ARG_DOUBLE)
+            {
+                double val;
+                memcpy(&val, &raw, sizeof(val));
+                if (is_float)
+                {
+                    AppendFormat(out, spec + conv, val);
+                }
+                else if (conv == 's')
+                {
+                    out.append(std::to_string(val));
+                }
+                else
+                {
+                    AppendFormat(out, spec + "ll" + conv, (long long)val);
+                }
+                continue;
+            }
+            if (conv == 'p')
+            {
+                AppendFormat(out, spec + 'p', (void *)(uintptr_t)raw);
+            }
+            else if (conv == 'c')
+            {
+                AppendFormat(out, spec + 'c', (int)raw);
+            }
+            else if (is_float)
+            {
+                AppendFormat(out, spec + conv, type == LOG_ARG_INT ? (double)(int64_t)raw : (double)raw);
+            }
+            else if (conv == 's')
+            {
+                out.append(type == LOG_ARG_INT ? std::to_string((int64_t)raw) : std::to_string(raw));
+            }
+            else if (type == LOG_ARG_INT && (conv == 'd' || conv == 'i'))
+            {
+                AppendFormat(out, spec + "ll" + conv, (long long)raw);
+            }
+            else
+            {
+                AppendFormat(out, spec + "ll" + conv, (unsigned long long)raw);
+            }
+        }
+        return out;
+    }
+
+    BinaryFileLogsinker::BinaryFileLogsinker(const std::string &filename, uint32_t flush_interval,
+                                             size_t buffer_size, bool drop_when_full)
+        : AsyncFileLogsinker(filename, flush_interval, buffer_size, drop_when_full),
+          _registry(LogSiteRegistry::GetInstance())
+    {
+    }
+    BinaryFileLogsinker::~BinaryFileLogsinker()
+    {
+        // 先停止刷盘线程 保证最后一次刷盘时prepareFlush还可用
+        stop();
+    }
+    // 文本日志 格式化后写成TEXT记录
+    void BinaryFileLogsinker::log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr ev)
+    {
+        if (level < _level_limit)
+        {
+            return;
+        }
+        if (!_b_has_formatter)
+        {
+            SetFormatter(logger->GetFormatter());
+        }
+        Formatter::ptr formatter;
+        {
+            // 锁内拷贝格式化器 防止格式化时被SetFormatter替换释放
+            SpinLock::Lock lock(_mutex);
+            formatter = _formatter;
+        }
+        static thread_local std::string t_record;
+        t_record.clear();
+        size_t begin = BeginRecord(t_record, LOG_RECORD_TEXT);
+        PutValue<uint32_t>(t_record, logger->GetNameId());
+        PutValue<uint8_t>(t_record, level);
+        PutValue<uint64_t>(t_record, TimeUitl::GetCurrentUS());
+        size_t len_pos = t_record.size();
+        PutValue<uint32_t>(t_record, 0);
+        formatter->formatTo(t_record, logger, level, ev);
+        uint32_t text_len = t_record.size() - len_pos - sizeof(uint32_t);
+        memcpy(&t_record[len_pos], &text_len, sizeof(text_len));
+        EndRecord(t_record, begin);
+        append(t_record.data(), t_record.size());
+    }
+    // 二进制日志 只写id和参数
+    void BinaryFileLogsinker::logBinary(Logger::ptr logger, const LogSite &site, const char *data, size_t len)
+    {
+        if (site.level < _level_limit)
+        {
+            return;
+        }
+        // 线程名的id按线程缓存
+        struct ThreadNameCache
+        {
+            std::string name;
+            uint32_t id = 0;
+        };
+        static thread_local ThreadNameCache t_thread_name;
+        const std::string &thread_name = Thread::GetName();
+        if (t_thread_name.id == 0 || t_thread_name.name != thread_name)
+        {
+            t_thread_name.name = thread_name;
+            t_thread_name.id = _registry->InternName(thread_name);
+        }
+        static thread_local std::string t_record;
+        t_record.clear();
+        size_t begin = BeginRecord(t_record, LOG_RECORD_EVENT);
+        PutValue<uint32_t>(t_record, site.id.load(std::memory_order_relaxed));
+        PutValue<uint32_t>(t_record, logger->GetNameId());
+        PutValue<uint32_t>(t_record, t_thread_name.id);
+        PutValue<uint32_t>(t_record, ThreadUtil::GetThreadId());
+        PutValue<uint32_t>(t_record, (uint32_t)FiberUtil::GetFiberId());
+        PutValue<uint64_t>(t_record, TimeUitl::GetCurrentUS());
+        t_record.append(data, len);
+        EndRecord(t_record, begin);
+        append(t_record.data(), t_record.size());
+    }
+    void BinaryFileLogsinker::prepareFlush(std::string &prefix, bool new_file)
+    {
+        if (new_file)
+        {
+            // 文件被删除或轮转 新文件需要重新写入会话和完整字典
+            _sessionWritten = false;
+        }
+        if (!_sessionWritten)
+        {
+            size_t begin = BeginRecord(prefix, LOG_RECORD_SESSION);
+            PutValue<uint32_t>(prefix, XTEN_BINLOG_MAGIC);
+            PutValue<uint32_t>(prefix, XTEN_BINLOG_VERSION);
+            PutValue<uint64_t>(prefix, TimeUitl::GetCurrentUS());
+            PutValue<uint32_t>(prefix, getpid());
+            EndRecord(prefix, begin);
+            _sessionWritten = true;
+            _dictWritten = 0;
+        }
+        _dictWritten = _registry->AppendDict(_dictWritten, prefix);
+    }
+    std::string BinaryFileLogsinker::toYamlString() // 将配置转化成yaml格式的string
+    {
+        YAML::Node node = YAML::Load(AsyncFileLogsinker::toYamlString());
+        node["type"] = "BinaryFileLogSinker";
+        std::stringstream ss;
+        ss << node;
+        return ss.str();
+    }
+}
@@ -0,0 +1,212 @@
+#ifndef __XTEN_BINLOG_H__
+#define __XTEN_BINLOG_H__
+#include "log.h"
+#include <string_view>
+#include <type_traits>
+
+// 二进制结构化日志 printf风格的格式串在调用点注册一次(LogSite) 每条日志只记录站点id和参数的二进制
+// 二进制落地类(BinaryFileLogAppender)直接写入参数字节 由bin/tools/xlogdecode离线还原成文本
+// 其他落地类(标准输出/文件)收到时在当前线程格式化成文本输出
+// 参数支持: 整数 枚举 浮点 const char* std::string std::string_view 指针 不支持printf的*宽度
+#define XTEN_LOG_BIN_LEVEL(logger, level, fmt, ...)                                          \
+    do                                                                                      \
+    {                                                                                       \
+        if (logger && logger->IsLevelEnabled(level))                                        \
+        {                                                                                   \
+            static Xten::LogSite __xten_log_site(level, __FILE__, __LINE__, fmt);            \
+            Xten::LogBinary(logger, __xten_log_site, ##__VA_ARGS__);                        \
+        }                                                                                   \
+    } while (0)
+
+#define XTEN_LOG_BIN_DEBUG(logger, fmt, ...) XTEN_LOG_BIN_LEVEL(logger, Xten::LogLevel::DEBUG, fmt, ##__VA_ARGS__)
+#define XTEN_LOG_BIN_INFO(logger, fmt, ...) XTEN_LOG_BIN_LEVEL(logger, Xten::LogLevel::INFO, fmt, ##__VA_ARGS__)
+#define XTEN_LOG_BIN_WARN(logger, fmt, ...) XTEN_LOG_BIN_LEVEL(logger, Xten::LogLevel::WARN, fmt, ##__VA_ARGS__)
+#define XTEN_LOG_BIN_ERROR(logger, fmt, ...) XTEN_LOG_BIN_LEVEL(logger, Xten::LogLevel::ERROR, fmt, ##__VA_ARGS__)
+#define XTEN_LOG_BIN_FATAL(logger, fmt, ...) XTEN_LOG_BIN_LEVEL(logger, Xten::LogLevel::FATAL, fmt, ##__VA_ARGS__)
+
+namespace Xten
+{
+    // 参数类型 注册站点时记录 事件中只写参数值
+    enum LogArgType : uint8_t
+    {
+        LOG_ARG_INT = 1,     // 有符号整数 8字节
+        LOG_ARG_UINT = 2,    // 无符号整数 8字节
+        LOG_ARG_DOUBLE = 3,  // 浮点 8字节
+        LOG_ARG_STRING = 4,  // 字符串 uint32长度+内容
+        LOG_ARG_POINTER = 5, // 指针 8字节
+    };
+    // 二进制日志文件中的记录类型 每条记录: uint32总长度(包含头部) + uint8类型 + 内容
+    enum LogRecordType : uint8_t
+    {
+        LOG_RECORD_SESSION = 1, // 进程会话开始 之后的站点/名字id只在本会话内有效
+        LOG_RECORD_SITE = 2,    // 站点: id level line file fmt 参数类型
+        LOG_RECORD_NAME = 3,    // 名字(日志器名 线程名): id name
+        LOG_RECORD_EVENT = 4,   // 二进制事件: 站点id 日志器名id 线程名id 线程id 协程id 时间(微秒) 参数
+        LOG_RECORD_TEXT = 5,    // 普通文本日志(已按sink的格式化器格式化)
+    };
+    // 二进制日志文件魔数
+    static const uint32_t XTEN_BINLOG_MAGIC = 0x474f4c58; // "XLOG"
+    static const uint32_t XTEN_BINLOG_VERSION = 1;
+
+    // 日志调用点 函数内静态变量 第一次输出时注册参数类型并分配id
+    struct LogSite
+    {
+        LogSite(LogLevel::Level lv, const char *f, uint32_t l, const char *fm)
+            : level(lv), file(f), line(l), fmt(fm) {}
+        LogLevel::Level level;
+        const char *file;
+        uint32_t line;
+        const char *fmt;
+        std::vector<uint8_t> types;    // 参数类型(LogArgType)
+        std::atomic<uint32_t> id{0};   // 注册后的id(0表示未注册)
+    };
+
+    // 站点和名字的注册表 同时保存编码好的字典记录 二进制落地类刷盘时把新增的字典写在事件之前
+    class LogSiteRegistry : public singleton<LogSiteRegistry>
+    {
+        friend class singleton<LogSiteRegistry>;
+
+    public:
+        // 注册站点 返回id(已注册直接返回)
+        uint32_t Register(LogSite &site, const uint8_t *types, size_t count);
+        // 注册名字 返回id(相同名字返回同一个id)
+        uint32_t InternName(const std::string &name);
+        // 获取站点
+        LogSite *GetSite(uint32_t id);
+        // 字典记录数
+        size_t GetDictSize();
+        // 把第[from, 当前)条字典记录追加到out 返回当前字典记录数
+        size_t AppendDict(size_t from, std::string &out);
+
+    private:
+        LogSiteRegistry() = default;
+        void addDict(std::string &&record);
+
+    private:
+        std::mutex _mutex;
+        std::vector<LogSite *> _sites;                      // 下标+1为站点id
+        std::unordered_map<std::string, uint32_t> _names;   // 名字 -> id
+        std::vector<std::string> _dict;                     // 编码好的字典记录(SITE/NAME)
+        std::atomic<size_t> _dictSize{0};                   // 字典记录数
+    };
+
+    // 参数类型萃取
+    template <class T, class = void>
+    struct LogArgTraits;
+    template <class T>
+    struct LogArgTraits<T, std::enable_if_t<std::is_integral<T>::value && std::is_signed<T>::value>>
+    {
+        static const uint8_t type = LOG_ARG_INT;
+    };
+    template <class T>
+    struct LogArgTraits<T, std::enable_if_t<std::is_integral<T>::value && !std::is_signed<T>::value>>
+    {
+        static const uint8_t type = LOG_ARG_UINT;
+    };
+    template <class T>
+    struct LogArgTraits<T, std::enable_if_t<std::is_enum<T>::value>>
+    {
+        static const uint8_t type = LOG_ARG_INT;
+    };
+    template <class T>
+    struct LogArgTraits<T, std::enable_if_t<std::is_floating_point<T>::value>>
+    {
+        static const uint8_t type = LOG_ARG_DOUBLE;
+    };
+    template <class T>
+    struct LogArgTraits<T, std::enable_if_t<std::is_pointer<T>::value &&
+                                            !std::is_same<std::remove_cv_t<std::remove_pointer_t<T>>, char>::value>>
+    {
+        static const uint8_t type = LOG_ARG_POINTER;
+    };
+    template <class T>
+    struct LogArgTraits<T, std::enable_if_t<std::is_same<T, char *>::value || std::is_same<T, const char *>::value ||
+                                            std::is_same<T, std::string>::value || std::is_same<T, std::string_view>::value>>
+    {
+        static const uint8_t type = LOG_ARG_STRING;
+    };
+
+    // 参数编码
+    template <class T>
+    inline void EncodeLogArg(std::string &out, const T &val)
+    {
+        typedef std::decay_t<T> Type;
+        uint8_t type = LogArgTraits<Type>::type;
+        if (type == LOG_ARG_DOUBLE)
+        {
+            double v = (double)val;
+            out.append((const char *)&v, sizeof(v));
+        }
+        else
+        {
+            uint64_t v = (uint64_t)(int64_t)val;
+            out.append((const char *)&v, sizeof(v));
+        }
+    }
+    template <class T>
+    inline void EncodeLogArg(std::string &out, T *val)
+    {
+        uint64_t v = (uint64_t)(uintptr_t)val;
+        out.append((const char *)&v, sizeof(v));
+    }
+    inline void EncodeLogArg(std::string &out, std::string_view val)
+    {
+        uint32_t len = val.size();
+        out.append((const char *)&len, sizeof(len));
+        out.append(val.data(), len);
+    }
+    inline void EncodeLogArg(std::string &out, const char *val)
+    {
+        EncodeLogArg(out, std::string_view(val ? val : "(null)"));
+    }
+    inline void EncodeLogArg(std::string &out, char *val)
+    {
+        EncodeLogArg(out, (const char *)val);
+    }
+    inline void EncodeLogArg(std::string &out, const std::string &val)
+    {
+        EncodeLogArg(out, std::string_view(val));
+    }
+
+    // 根据格式串和参数类型把参数二进制还原成文本(printf语义)
+    std::string LogBinaryFormat(const char *fmt, const uint8_t *types, size_t count, const char *data, size_t len);
+
+    // 编码参数后交给logger 宏XTEN_LOG_BIN_*调用
+    template <class... Args>
+    void LogBinary(Logger::ptr logger, LogSite &site, const Args &...args)
+    {
+        uint32_t id = site.id.load(std::memory_order_acquire);
+        if (id == 0)
+        {
+            const uint8_t types[] = {LogArgTraits<std::decay_t<Args>>::type..., 0};
+            id = LogSiteRegistry::GetInstance()->Register(site, types, sizeof...(Args));
+        }
+        static thread_local std::string t_args;
+        t_args.clear();
+        (EncodeLogArg(t_args, args), ...);
+        logger->logBinary(site, t_args.data(), t_args.size());
+    }
+
+    // 二进制文件输出落地类 复用AsyncFileLogsinker的线程缓冲区和刷盘线程
+    // 文本日志写成LOG_RECORD_TEXT 二进制日志写成LOG_RECORD_EVENT 新增的站点/名字在刷盘时写在事件之前
+    class BinaryFileLogsinker : public AsyncFileLogsinker
+    {
+    public:
+        typedef std::shared_ptr<BinaryFileLogsinker> ptr;
+        BinaryFileLogsinker(const std::string &filename, uint32_t flush_interval = 1000,
+                            size_t buffer_size = 1024 * 1024, bool drop_when_full = false);
+        ~BinaryFileLogsinker();
+        virtual void log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr ev) override;
+        virtual void logBinary(Logger::ptr logger, const LogSite &site, const char *data, size_t len) override;
+        virtual std::string toYamlString() override; // 将配置转化成yaml格式的string
+
+    protected:
+        virtual void prepareFlush(std::string &prefix, bool new_file) override;
+
+    private:
+        std::shared_ptr<LogSiteRegistry> _registry; // 持有注册表 进程退出时静态对象析构顺序不确定
+        bool _sessionWritten = false; // 本文件是否已写入会话记录(只在刷盘线程中使用)
+        size_t _dictWritten = 0;      // 已写入本文件的字典记录数(只在刷盘线程中使用)
+    };
+}
+#endif
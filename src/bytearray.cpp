@@ -7,19 +7,33 @@
 namespace Xten
 {
     static Xten::Logger::ptr g_logger = XTEN_LOG_NAME("system");
+    // Clear时链表模式最多保留的节点数
+    static const size_t s_clear_keep_nodes = 8;
+    // 环形模式的最小容量
+    static const size_t s_ring_min_capacity = 64;
+    // 向上取2的幂
+    static size_t RoundUpPow2(size_t size)
+    {
+        size_t cap = s_ring_min_capacity;
+        while (cap < size)
+        {
+            cap <<= 1;
+        }
+        return cap;
+    }
     ByteArray::Node::Node()
         : next(nullptr), size(0), memory(nullptr)
     {
     }
     ByteArray::Node::Node(size_t sz)
-        : next(nullptr), size(sz), memory(new char[sz])
+        : next(nullptr), size(sz), memory((char *)ObjPoolAllocator::Alloc(sz))
     {
     }
     ByteArray::Node::~Node()
     {
         if (memory)
         {
-            delete[] memory;
+            ObjPoolAllocator::Dealloc(memory, size);
         }
     }
     // 对负数进行zigzag压缩编码 32位
@@ -57,18 +71,27 @@ namespace Xten
     {
         return (val >> 1) ^ -(val & 1);
     }
-    ByteArray::ByteArray(size_t node_size)
-        : _root(new Node(node_size)),
-          _nodeSize(node_size),
+    ByteArray::ByteArray(size_t node_size, bool ring)
+        : _root(ring ? nullptr : new Node(node_size)),
+          _nodeSize(ring ? RoundUpPow2(node_size) : node_size),
           _position(0),
           _size(0),
           _cur(_root),
-          _capacity(node_size),
+          _capacity(_nodeSize),
           _endian(XTEN_BIG_ENDIAN)
     {
+        if (ring)
+        {
+            _ring = (char *)ObjPoolAllocator::Alloc(_capacity);
+        }
     }
     ByteArray::~ByteArray()
     {
+        if (_ring)
+        {
+            ObjPoolAllocator::Dealloc(_ring, _capacity);
+            _ring = nullptr;
+        }
         Node *next = nullptr;
         while (_root)
         {
@@ -260,6 +283,38 @@ namespace Xten
         {
             return;
         }
+        if (_ring)
+        {
+            if (_position + size > _capacity)
+            {
+                ringReserve(_position + size);
+            }
+            size_t phys = (_head + _position) & (_capacity - 1);
+            if (phys + size <= _capacity)
+            {
+                // 不跨越缓冲区末尾 直接拷贝
+                memcpy(_ring + phys, buf, size);
+                _position += size;
+                if (_position > _size)
+                {
+                    _size = _position;
+                }
+                return;
+            }
+            iovec segs[2];
+            int n = ringSegments(_position, size, segs);
+            memcpy(segs[0].iov_base, buf, segs[0].iov_len);
+            if (n > 1)
+            {
+                memcpy(segs[1].iov_base, (const char *)buf + segs[0].iov_len, segs[1].iov_len);
+            }
+            _position += size;
+            if (_position > _size)
+            {
+                _size = _position;
+            }
+            return;
+        }
         // 写入前判断空间是否需要扩容
         addFreeCapacity(size);
         // 当前节点位置
@@ -311,6 +366,20 @@ namespace Xten
         {
             throw std::out_of_range("no enough readSize");
         }
+        if (_ring)
+        {
+            size_t phys = (_head + _position) & (_capacity - 1);
+            if (phys + size <= _capacity)
+            {
+                memcpy(buf, _ring + phys, size);
+            }
+            else
+            {
+                Read(buf, size, _position);
+            }
+            _position += size;
+            return;
+        }
         size_t npos = _position % _nodeSize;
         size_t ncap = _cur->size - npos;
         size_t rd_pos = 0;
@@ -342,10 +411,25 @@ namespace Xten
     // 从指定位置开始读取数据 （不更新position和cur的位置）
     void ByteArray::Read(void *buf, size_t size, size_t position)
     {
-        if (size > (_size - position))
+        if (position > _size || size > (_size - position))
         {
             throw std::out_of_range("no enough readSize");
         }
+        if (_ring)
+        {
+            if (size == 0)
+            {
+                return;
+            }
+            iovec segs[2];
+            int n = ringSegments(position, size, segs);
+            memcpy(buf, segs[0].iov_base, segs[0].iov_len);
+            if (n > 1)
+            {
+                memcpy((char *)buf + segs[0].iov_len, segs[1].iov_base, segs[1].iov_len);
+            }
+            return;
+        }
         size_t npos = position % _nodeSize;
         size_t rd_pos = 0;
         // 根据position确定cur的Node节点位置
@@ -549,43 +633,60 @@ namespace Xten
     std::string ByteArray::ReadStringF16()
     {
         uint16_t len = ReadFUint16();
-        char buf[len + 1];
-        buf[len] = '\0'; // 最后一个字符设置为\0
-        Read(buf, len);
-        return std::string(buf);
+        // 直接读入string 不在协程栈上开辟变长数组
+        std::string str;
+        str.resize(len);
+        Read(&str[0], len);
+        return str;
     }
     // 读取字符串，由uint32保存长度
     std::string ByteArray::ReadStringF32()
     {
         uint32_t len = ReadFUint32();
-        char buf[len + 1];
-        buf[len] = '\0'; // 最后一个字符设置为\0
-        Read(buf, len);
-        return std::string(buf);
+        // 直接读入string 不在协程栈上开辟变长数组
+        std::string str;
+        str.resize(len);
+        Read(&str[0], len);
+        return str;
     }
     // 读取字符串，由uint64保存长度
     std::string ByteArray::ReadStringF64()
     {
         uint64_t len = ReadFUint64();
-        char buf[len + 1];
-        buf[len] = '\0'; // 最后一个字符设置为\0
-        Read(buf, len);
-        return std::string(buf);
+        // 直接读入string 不在协程栈上开辟变长数组
+        std::string str;
+        str.resize(len);
+        Read(&str[0], len);
+        return str;
     }
     // 读取字符串，由varint64保存长度
     std::string ByteArray::ReadStringVar64()
     {
         uint64_t len = ReadVarUint64();
-        char buf[len + 1];
-        buf[len] = '\0';
-        Read(buf, len);
-        return std::string(buf);
+        // 直接读入string 不在协程栈上开辟变长数组
+        std::string str;
+        str.resize(len);
+        Read(&str[0], len);
+        return str;
     }
     void ByteArray::Clear()
     {
         _position = _size = 0;
-        Node *tmp = _root->next;
-        _root->next = nullptr;
+        if (_ring)
+        {
+            _head = 0;
+            return;
+        }
+        // 保留前s_clear_keep_nodes个节点复用 其余释放
+        Node *last = _root;
+        size_t keep = 1;
+        while (last->next && keep < s_clear_keep_nodes)
+        {
+            last = last->next;
+            keep++;
+        }
+        Node *tmp = last->next;
+        last->next = nullptr;
         while (tmp)
         {
             _cur = tmp->next;
@@ -593,7 +694,72 @@ namespace Xten
             tmp = _cur;
         }
         _cur = _root;
-        _capacity = _nodeSize; // 只有一个节点
+        _capacity = _nodeSize * keep;
+    }
+    // 丢弃[0,position)已读数据
+    size_t ByteArray::DiscardRead()
+    {
+        if (_ring)
+        {
+            size_t n = _position;
+            _head = (_head + n) & (_capacity - 1);
+            _size -= n;
+            _position = 0;
+            return n;
+        }
+        Node *tail = _root;
+        while (tail->next)
+        {
+            tail = tail->next;
+        }
+        // 已读完的整节点挪到链表尾部作为空闲空间
+        size_t n = 0;
+        while (_root->next && _root != _cur)
+        {
+            Node *node = _root;
+            _root = _root->next;
+            node->next = nullptr;
+            tail->next = node;
+            tail = node;
+            if (!_cur)
+            {
+                // position正好在容量末尾
+                _cur = node;
+            }
+            n += _nodeSize;
+        }
+        _position -= n;
+        _size -= n;
+        return n;
+    }
+    // 获取[position,position+len)的只读视图
+    std::string_view ByteArray::GetReadView(size_t len)
+    {
+        if (len > GetReadSize())
+        {
+            throw std::out_of_range("no enough readSize");
+        }
+        if (len == 0)
+        {
+            return std::string_view();
+        }
+        if (_ring)
+        {
+            iovec segs[2];
+            if (ringSegments(_position, len, segs) > 1)
+            {
+                // 跨越缓冲区末尾 整理成连续(容量不变)
+                ringReserve(0);
+                ringSegments(_position, len, segs);
+            }
+            return std::string_view((const char *)segs[0].iov_base, len);
+        }
+        size_t npos = _position % _nodeSize;
+        if (_cur->size - npos < len)
+        {
+            return std::string_view();
+        }
+        return std::string_view(_cur->memory + npos, len);
     }
     // 设置当前bytearray的position
     void ByteArray::SetPosition(size_t pos)
@@ -607,6 +773,10 @@ namespace Xten
         {
             _size = _position;
         }
+        if (_ring)
+        {
+            return;
+        }
         // 根据新的position设置cur位置
         _cur = _root;
         while (pos > _cur->size)
@@ -659,6 +829,21 @@ namespace Xten
                                      << " error , errno=" << errno << " errstr=" << strerror(errno);
             return false;
         }
+        if (_ring)
+        {
+            std::vector<iovec> iovs;
+            GetReadBuffers(iovs, GetReadSize());
+            for (auto &iov : iovs)
+            {
+                fs.write((const char *)iov.iov_base, iov.iov_len);
+            }
+            if (with_md5)
+            {
+                std::ofstream ofs_md5(file + ".md5");
+                ofs_md5 << getMd5();
+            }
+            return true;
+        }
         int64_t position = _position;
         size_t npos = position % _nodeSize;
         Node *cur = _cur;
@@ -725,6 +910,11 @@ namespace Xten
         {
             return;
         }
+        if (_ring)
+        {
+            ringReserve(_position + size);
+            return;
+        }
         // 写入数据大于剩余空间 扩容
         size = size - old_cap;
         // 计算扩容节点个数，小数向上取整
@@ -760,6 +950,13 @@ namespace Xten
             return 0;
         }
         size_t size = len;
+        if (_ring)
+        {
+            iovec segs[2];
+            int n = ringSegments(_position, len, segs);
+            buffers.insert(buffers.end(), segs, segs + n);
+            return size;
+        }
         size_t npos = _position % _nodeSize;
         size_t ncap = _cur->size - npos;
         Node *cur = _cur;
@@ -796,6 +993,13 @@ namespace Xten
             return 0;
         }
         size_t size = len;
+        if (_ring)
+        {
+            iovec segs[2];
+            int n = ringSegments(pos, len, segs);
+            buffers.insert(buffers.end(), segs, segs + n);
+            return size;
+        }
         Node *cur = _root;
         size_t npos = pos % _nodeSize;
         int64_t count = pos / _nodeSize;
@@ -837,6 +1041,13 @@ namespace Xten
         }
         addFreeCapacity(len);
         size_t size = len;
+        if (_ring)
+        {
+            iovec segs[2];
+            int n = ringSegments(_position, len, segs);
+            buffers.insert(buffers.end(), segs, segs + n);
+            return size;
+        }
         size_t npos = _position % _nodeSize;
         size_t ncap = _cur->size - npos;
         Node *cur = _cur;
@@ -862,6 +1073,46 @@ namespace Xten
         }
         return size;
     }
+    // 环形模式: 逻辑区间[pos,pos+len)对应的物理内存段
+    int ByteArray::ringSegments(size_t pos, size_t len, iovec *segs) const
+    {
+        size_t phys = (_head + pos) & (_capacity - 1);
+        size_t first = _capacity - phys;
+        segs[0].iov_base = _ring + phys;
+        if (len <= first)
+        {
+            segs[0].iov_len = len;
+            return 1;
+        }
+        segs[0].iov_len = first;
+        segs[1].iov_base = _ring;
+        segs[1].iov_len = len - first;
+        return 2;
+    }
+    // 环形模式: 容量扩到至少size 数据整理到缓冲区开头
+    void ByteArray::ringReserve(size_t size)
+    {
+        size_t cap = _capacity;
+        while (cap < size)
+        {
+            cap <<= 1;
+        }
+        char *buf = (char *)ObjPoolAllocator::Alloc(cap);
+        if (_size > 0)
+        {
+            iovec segs[2];
+            int n = ringSegments(0, _size, segs);
+            memcpy(buf, segs[0].iov_base, segs[0].iov_len);
+            if (n > 1)
+            {
+                memcpy(buf + segs[0].iov_len, segs[1].iov_base, segs[1].iov_len);
+            }
+        }
+        ObjPoolAllocator::Dealloc(_ring, _capacity);
+        _ring = buf;
+        _capacity = cap;
+        _head = 0;
+    }
     // 获取当前bytearray中数据的md5值
     std::string ByteArray::getMd5()
     {
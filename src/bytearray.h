@@ -2,10 +2,12 @@
 #define __XTEN_BYETEARRAY_H__
 #include <vector>
 #include <string>
+#include <string_view>
 #include <memory>
 #include <endian.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include "objpool.h"
 #define XTEN_LITTLE_ENDIAN 1
 #define XTEN_BIG_ENDIAN 2
 // 判断本机字节序
@@ -21,7 +23,8 @@ namespace Xten
     public:
         typedef std::shared_ptr<ByteArray> ptr;
         // 构造函数 默认节点空间为4kB
-        ByteArray(size_t node_size = 4096);
+        // ring=true时使用连续环形缓冲区 node_size为初始容量(向上取2的幂) 空间不足时倍增
+        ByteArray(size_t node_size = 4096, bool ring = false);
         ~ByteArray();
         // 判断是否是小端
         bool IsLittleEndian();
@@ -35,8 +38,19 @@ namespace Xten
         void Read(void *buf, size_t size, size_t position);
         // 返回可读数据大小
         size_t GetReadSize();
-        // 清空bytearray _position和_size置零(只留下一个Node节点) 而不是真正清楚数据
+        // 清空bytearray _position和_size置零 而不是真正清楚数据(链表模式保留部分节点复用)
         void Clear();
+        // 丢弃[0,position)已读数据 position和size相应前移 空间留给后续写入
+        // 链表模式下回收的是已读完的整节点(挂到链表尾部复用) 返回丢弃的字节数
+        size_t DiscardRead();
+        // 获取[position,position+len)的只读视图 不移动position
+        // 环形模式下数据跨越缓冲区末尾时先整理成连续 链表模式下跨节点返回空视图
+        std::string_view GetReadView(size_t len);
+        // 是否为连续环形缓冲区模式
+        bool IsRing() const
+        {
+            return _ring != nullptr;
+        }
         // 获取当前的bytearray的position
         size_t GetPosition() const
         {
@@ -45,6 +59,8 @@ namespace Xten
         //获取第一个节点的内存空间的首地址指针
         void* GetBeginNodePtr() const
         {
+            if (_ring)
+                return _ring + _head;
             if(!_root)
                 return nullptr;
             return _root->memory;
@@ -166,10 +182,14 @@ namespace Xten
         void addFreeCapacity(size_t size);
         // 获取当前bytearray中数据的md5值
         std::string getMd5();
+        // 环形模式: 逻辑区间[pos,pos+len)对应的物理内存段(最多两段) 返回段数
+        int ringSegments(size_t pos, size_t len, iovec *segs) const;
+        // 环形模式: 容量扩到至少size(倍增) 数据整理到缓冲区开头
+        void ringReserve(size_t size);
 
     private:
-        // 存放数据的节点(链表组织)
-        struct Node
+        // 存放数据的节点(链表组织) 结点和内存都从ObjPoolAllocator分配
+        struct Node : public ObjPoolObject
         {
             Node();
             Node(size_t sz);
@@ -195,6 +215,10 @@ namespace Xten
         Node *_root;
         // 当前操作节点
         Node *_cur;
+        // 环形模式的连续缓冲区(链表模式为nullptr) 容量为_capacity
+        char *_ring = nullptr;
+        // 环形模式下逻辑位置0对应的物理偏移
+        size_t _head = 0;
     };
 }
 #endif
\ No newline at end of file
@@ -297,13 +297,16 @@ namespace Xten
         typedef std::shared_ptr<ConfigVar> ptr;
         typedef std::function<void(const T &old_val, const T &new_val)> on_change_cb; // 配置val变更 修改LoggerMgr实体的函数
         ConfigVar(const std::string &name, const T &val, const std::string &desc)
-            : ConfigVarBase(name, desc), _val(val) {}
+            : ConfigVarBase(name, desc)
+        {
+            _snapshots.emplace_back(new T(val));
+            _snapshot.store(_snapshots.back().get(), std::memory_order_release);
+        }
         virtual std::string ToString() override // 将val转成string
         {
             try
             {
-                RWMutex::ReadLock lock(_mutex); // 加读锁
-                return ToStr()(_val);
+                return ToStr()(GetValueRef());
             }
             catch (std::exception &e)
             {
@@ -331,29 +334,51 @@ namespace Xten
             return TypeUtil::TypeToName<T>(); //模板函数显示传入模板参数
         }
         // 子类增加对子类特有成员的操作函数
-        T GetValue()
-        {                                   // 获取
-            RWMutex::ReadLock lock(_mutex); // 加读锁
-            return _val;
+        // 无锁读取当前值的只读快照 不拷贝
+        // 快照不可修改 被替换的旧快照保留到配置项析构 所以返回的引用在配置项存活期间一直有效
+        const T &GetValueRef() const
+        {
+            return *_snapshot.load(std::memory_order_acquire);
+        }
+        T GetValue() // 获取(拷贝)
+        {
+            return GetValueRef();
+        }
+        // 值的版本号 每次发布新值加1 热点模块可以在线程局部缓存版本号和由值计算出的结果
+        uint64_t GetVersion() const
+        {
+            return _version.load(std::memory_order_acquire);
         }
         void SetValue(const T &val) // 设置value的配置值   并且发现值不一样的时候会调用变更函数进行配置实体的更改
         {
-            // std::cout << "SetValue" <<ToStr()(val)<< std::endl;
+            const T *old_val;
+            const T *new_val;
+            std::vector<on_change_cb> cbs;
+            // 从发布到回调全部完成都持有 并发SetValue的回调按发布顺序执行 监听者最后看到的一定是最新值
+            Mutex::Lock notify_lock(_notifyMutex);
             {
-                RWMutex::ReadLock lock(_mutex); // 加读锁
-                if (_val == val)
+                RWMutex::WriteLock lock(_mutex); // 加写锁 写者之间互斥
+                old_val = _snapshot.load(std::memory_order_relaxed);
+                if (*old_val == val)
                 {
                     return;
                 }
-                // 不相等
+                // 发布新快照 读者无锁 看到的要么是旧值要么是新值
+                _snapshots.emplace_back(new T(val));
+                new_val = _snapshots.back().get();
+                _snapshot.store(new_val, std::memory_order_release);
+                _version.fetch_add(1, std::memory_order_release);
+                cbs.reserve(_change_cbs.size());
                 for (auto &cb : _change_cbs)
                 {
-                    // std::cout << "走到调用变更函数" << std::endl;
-                    cb.second(_val, val); // 调用变更函数---在main函数之间就完成了注册
+                    cbs.push_back(cb.second);
                 }
             }
-            RWMutex::WriteLock lock(_mutex); // 加写锁
-            _val = val;
+            // 发布之后在读写锁外调用变更函数 回调中GetValue拿到的已经是新值(回调中不能再SetValue同一配置项)
+            for (auto &cb : cbs)
+            {
+                cb(*old_val, *new_val);
+            }
         }
         uint64_t AddListener(on_change_cb cb) // 添加
         {
@@ -387,8 +412,11 @@ namespace Xten
         }
 
     private:
-        RWMutex _mutex    ;                                 // lock锁 读写锁
-            T _val;                                        // 具体类型的配置值
+        RWMutex _mutex;                                    // 读写锁 保护写者和变更回调(读值不加锁)
+        Mutex _notifyMutex;                                // 变更通知锁 保证回调按发布顺序执行
+        std::atomic<const T *> _snapshot{nullptr};         // 当前值的快照
+        std::vector<std::unique_ptr<const T>> _snapshots;  // 所有发布过的快照 配置重载次数有限 析构时释放
+        std::atomic<uint64_t> _version{1};                 // 值的版本号
         std::unordered_map<int, on_change_cb> _change_cbs; // 变更配置回调函数组
     };
     // configvar的管理类  非实例化的静态成员类
@@ -1211,7 +1211,7 @@ namespace Xten
             // 启动定时器检查连接
             m_isStart = true;
             Xten::IOManager::GetThis()->addTimer(60 * 1000,
-                                                 std::bind(&MySQLManager::checkConnection, this, 30), true);
+                                                 std::bind(&MySQLManager::checkConnection, this, 30), true, 1000);
         }
         auto it = m_conns.find(name);
         if (it != m_conns.end())
@@ -4,26 +4,25 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <sys/socket.h>
+#include <thread>
 namespace Xten
 {
     FdCtx::FdCtx(int fd)
         : _fd(fd),
           _isInit(false),
-          _isClose(true),
           _isSocket(false),
+          _state(INITING),
           _isSysSetNoBlock(false),
           _isUserSetNoBlock(false),
+          _isUringMultishotRecv(false),
           _readTimeOut_ms(-1),
           _writeTimeOut_ms(-1)
     {
+        // 发布到FdCtxMgr之前初始化 不会与其他线程竞争
         init();
     }
     bool FdCtx::init()
     {
-        if (_isInit)
-        {
-            return true;
-        }
         _readTimeOut_ms = -1;
         _writeTimeOut_ms = -1;
         struct stat st;
@@ -52,8 +51,9 @@ namespace Xten
         {
             _isSysSetNoBlock = false;
         }
-        _isClose = false;
         _isUserSetNoBlock = false;
+        _isUringMultishotRecv = false;
+        _state.store(OPEN, std::memory_order_release);
         return _isInit;
     }
     // 是否是socketfd
@@ -69,7 +69,7 @@ namespace Xten
     // 是否关闭
     bool FdCtx::IsClose()
     {
-        return _isClose;
+        return _state.load(std::memory_order_acquire) != OPEN;
     }
     // 是否用户设置非阻塞
     bool FdCtx::GetUserNoBlock()
@@ -117,49 +117,54 @@ namespace Xten
             return _writeTimeOut_ms;
         }
     }
-    FdCtxMgr::FdCtxMgr()
+    FdCtx *FdCtxMgr::Get(int fd, bool auto_create)
     {
-        _fds.resize(64);
-    }
-    FdCtx::ptr FdCtxMgr::Get(int fd, bool auto_create)
-    {
-        if (fd == -1)
+        FdCtx *ctx = _fds.Get(fd);
+        if (XTEN_LIKELY(ctx && !ctx->IsClose()))
+        {
+            return ctx;
+        }
+        if (!auto_create)
+        {
             return nullptr;
+        }
+        if (!ctx)
         {
-            RWMutex::ReadLock rlock(_mutex);
-            if (fd >= (int)_fds.size())
-            {
-                if (auto_create == false)
-                {
-                    return nullptr;
-                }
-            }
-            else
-            {
-                if (_fds[fd] || !auto_create)
-                {
-                    return _fds[fd];
-                }
-            }
+            return _fds.GetOrCreate(fd, [](int fd)
+                                    { return new FdCtx(fd); });
         }
+        // fd被关闭后复用 只有抢到INITING的线程重新初始化
+        uint8_t expected = FdCtx::CLOSED;
+        if (ctx->_state.compare_exchange_strong(expected, FdCtx::INITING, std::memory_order_acq_rel))
         {
-            RWMutex::WriteLock wlock(_mutex);
-            FdCtx::ptr fdctx = std::make_shared<FdCtx>(fd);
-            if (fd >= (int)_fds.size())
-            {
-                _fds.resize(fd * 1.5);
-            }
-            _fds[fd] = std::move(fdctx);
+            ctx->init();
+            return ctx;
+        }
+        // 其他线程正在初始化 等待完成(只有fstat/fcntl)
+        while (ctx->_state.load(std::memory_order_acquire) == FdCtx::INITING)
+        {
+            std::this_thread::yield();
         }
-        return _fds[fd];
+        return ctx->IsClose() ? nullptr : ctx;
     }
     void FdCtxMgr::Del(int fd)
     {
-        RWMutex::WriteLock wlock(_mutex);
-        if ((fd >= (int)_fds.size()) || fd < 0)
+        FdCtx *ctx = _fds.Get(fd);
+        if (!ctx)
         {
             return;
         }
-        _fds[fd].reset();
+        // 正在重新初始化时等待完成再关闭 否则关闭标记会被init覆盖
+        uint8_t expected = FdCtx::OPEN;
+        while (!ctx->_state.compare_exchange_weak(expected, FdCtx::CLOSED, std::memory_order_acq_rel))
+        {
+            if (expected == FdCtx::CLOSED)
+            {
+                return;
+            }
+            expected = FdCtx::OPEN;
+            std::this_thread::yield();
+        }
+        ctx->_gen.fetch_add(1, std::memory_order_release);
     }
-}
\ No newline at end of file
+}
@@ -1,15 +1,14 @@
 #ifndef __XTEN_FDMANAGER_H__
 #define __XTEN_FDMANAGER_H__
-#include <memory>
-#include <vector>
-#include "mutex.h"
+#include <atomic>
+#include "segment_table.h"
 #include "singleton.hpp"
 namespace Xten
 {
-    class FdCtx : public std::enable_shared_from_this<FdCtx>
+    class FdCtx
     {
     public:
-        typedef std::shared_ptr<FdCtx> ptr;
+        friend class FdCtxMgr;
         FdCtx(int fd);
         ~FdCtx() = default;
         // 是否是socketfd
@@ -30,30 +29,50 @@ namespace Xten
         void SetTimeOut(int type, uint64_t time_ms);
         // 获取超时时间
         uint64_t GetTimeOut(int type);
+        // 是否使用io_uring multishot recv接收数据
+        bool GetUringMultishotRecv() { return _isUringMultishotRecv; }
+        // 设置使用io_uring multishot recv(数据由内核持续收进提供缓冲区 只能通过hook的读函数读取)
+        void SetUringMultishotRecv(bool v) { _isUringMultishotRecv = v; }
+        // 关闭次数 每次FdCtxMgr::Del加1 基于fd号的缓存(如epoll常驻注册)据此判断fd是否关闭复用过
+        uint32_t GetGeneration() const { return _gen.load(std::memory_order_acquire); }
+
+    private:
+        // 状态 对象不释放: FdCtxMgr::Del后为CLOSED fd复用时把CLOSED改成INITING的线程重新初始化
+        // 其他线程等待初始化完成 初始化写入的成员在OPEN发布后才对其他线程可见
+        enum State : uint8_t
+        {
+            CLOSED = 0,
+            INITING = 1,
+            OPEN = 2
+        };
+        // 初始化 只能在INITING状态下调用 完成后状态为OPEN
         bool init();
 
     private:
         bool _isInit;              // 是否初始化
         bool _isSocket;            // 是否是socket
-        bool _isClose;             // 是否关闭
+        std::atomic<uint8_t> _state; // 状态(State)
+        std::atomic<uint32_t> _gen{0}; // 关闭次数
         bool _isUserSetNoBlock;    // 是否用户设置非阻塞
         bool _isSysSetNoBlock;     // 是否系统设置非阻塞
+        bool _isUringMultishotRecv; // 是否使用io_uring multishot recv
         int _fd;                   // fd
         uint64_t _readTimeOut_ms;  // 读超时时间
         uint64_t _writeTimeOut_ms; // 写超时时间
     };
+    // fd上下文管理 按fd下标存放在分段数组中 查找不加锁
+    // 返回的指针在进程内一直有效(Del只标记关闭) 使用前检查IsClose
     class FdCtxMgr : public singleton<FdCtxMgr>
     {
     public:
-        FdCtxMgr();
-        //获取 不存在则创建
-        FdCtx::ptr Get(int fd,bool auto_create=false);
+        FdCtxMgr() = default;
+        //获取 auto_create为true时不存在(或已删除)则创建
+        FdCtx *Get(int fd, bool auto_create = false);
         //删除fdctx
         void Del(int fd);
-        ~FdCtxMgr()=default;
+        ~FdCtxMgr() = default;
     private:
-        RWMutex _mutex;
-        std::vector<FdCtx::ptr> _fds;
+        SegmentTable<FdCtx> _fds;
     };
 }
 #endif
\ No newline at end of file
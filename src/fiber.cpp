@@ -5,6 +5,13 @@
 #include "scheduler.h"
 #include "config.h"
 #include "macro.h"
+#include "mutex.h"
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+#include "util.h"
+#include "thread_cache.h"
 namespace Xten
 {
     static Xten::Logger::ptr g_logger = XTEN_LOG_NAME("system");
@@ -18,6 +25,10 @@ namespace Xten
     static thread_local Fiber::ptr t_main_fiber = nullptr; // 线程主协程
     static thread_local Fiber *t_cur_fiber = nullptr;      // 线程当前正在执行的协程
 
+    // 协程局部存储槽位析构函数表 槽位只增不减 读取无需加锁
+    static Fiber::LocalDtor s_local_dtors[Fiber::MAX_LOCAL_SLOTS];
+    static std::atomic<size_t> s_local_slots{0};
+
     // 协程栈空间开辟器
     class MallocStackAllocator
     {
@@ -44,27 +55,360 @@ namespace Xten
             munmap(ptr, size);
         }
     };
-    using StackAllocatorType = MmapStackAllocator; // 使用mmap开辟栈空间
+
+    static Xten::ConfigVar<bool>::ptr g_fiber_stack_pool =
+        Config::LookUp("fiber.stack_pool.enable", true, "fiber stack pool enable");
+    static Xten::ConfigVar<uint32_t>::ptr g_fiber_stack_pool_high =
+        Config::LookUp("fiber.stack_pool.high_watermark", (uint32_t)64, "fiber stack pool thread cache high watermark");
+    static Xten::ConfigVar<uint32_t>::ptr g_fiber_stack_pool_low =
+        Config::LookUp("fiber.stack_pool.low_watermark", (uint32_t)16, "fiber stack pool thread cache low watermark");
+    static Xten::ConfigVar<uint32_t>::ptr g_fiber_stack_pool_global_max =
+        Config::LookUp("fiber.stack_pool.global_max", (uint32_t)1024, "fiber stack pool global overflow pool max stacks");
+    static Xten::ConfigVar<bool>::ptr g_fiber_stack_pool_trim =
+        Config::LookUp("fiber.stack_pool.trim", true, "fiber stack pool madvise(MADV_DONTNEED) idle stacks in global pool");
+    static Xten::ConfigVar<bool>::ptr g_fiber_stack_guard =
+        Config::LookUp("fiber.stack_guard", false, "fiber stack guard page");
+
+    // 协程栈池配置(监听配置变更 避免每次分配都加配置读锁)
+    static bool s_pool_enable = true;
+    static uint32_t s_pool_high = 64;
+    static uint32_t s_pool_low = 16;
+    static uint32_t s_pool_global_max = 1024;
+    static bool s_pool_trim = true;
+    static bool s_stack_guard = false;
+    static size_t s_pool_stack_size = 128 * 1024; // 池中栈的大小(fiber.stack_size) 其他大小的栈不进池
+    static const size_t s_page_size = sysconf(_SC_PAGESIZE);
+
+    static std::atomic<uint64_t> s_pool_mmap = {0};   // mmap次数
+    static std::atomic<uint64_t> s_pool_munmap = {0}; // munmap次数
+    static std::atomic<uint64_t> s_pool_hit = {0};    // 从池中取到的次数
+    static std::atomic<uint64_t> s_pool_trim_num = {0}; // madvise次数
+
+    // 一块协程内存: [保护页][协程栈stack_size][Fiber对象]
+    // 栈从高地址向低地址增长 溢出时先碰到保护页(fiber.stack_guard开启时不可访问)
+    // 保护页的地址空间总是预留 开关只决定是否mprotect 释放时不需要知道开关状态
+    static inline size_t StackBlockSize(size_t stack_size)
+    {
+        return (s_page_size + stack_size + sizeof(Fiber) + s_page_size - 1) & ~(s_page_size - 1);
+    }
+    // 空闲块链表节点 放在Fiber对象的位置(栈所在页之上 不受madvise影响)
+    // 记录块的栈大小: fiber.stack_size重载后池中可能同时存在新旧两种大小的块
+    struct StackBlockNode
+    {
+        StackBlockNode *next;
+        char *block;
+        size_t stack_size;
+    };
+    static inline StackBlockNode *StackBlockToNode(char *block, size_t stack_size)
+    {
+        return (StackBlockNode *)(block + s_page_size + stack_size);
+    }
+
+    // 全局溢出池(线程缓存超过高水位时归还 不足时批量取)
+    static SpinLock s_stack_global_mtx;
+    static StackBlockNode *s_stack_global_list = nullptr;
+    static size_t s_stack_global_size = 0;
+
+    // 释放一块内存给系统
+    static void StackBlockUnmap(char *block, size_t stack_size)
+    {
+        s_pool_munmap.fetch_add(1, std::memory_order_relaxed);
+        MmapStackAllocator::Dealloc(block, StackBlockSize(stack_size));
+    }
+
+    // 线程本地栈缓存(ThreadCacheHolder)
+    struct FiberStackCache
+    {
+        StackBlockNode *head;
+        size_t size;
+        bool registered; // 是否已注册线程退出回调
+        bool dead;       // 线程退出后不再缓存
+
+        // 从全局池取到低水位
+        void fetchFromGlobal()
+        {
+            SpinLock::Lock lock(s_stack_global_mtx);
+            while (s_stack_global_list && size < s_pool_low)
+            {
+                StackBlockNode *node = s_stack_global_list;
+                s_stack_global_list = node->next;
+                s_stack_global_size--;
+                node->next = head;
+                head = node;
+                size++;
+            }
+        }
+        // 归还count个到全局池 全局池满的直接释放
+        void releaseToGlobal(size_t count)
+        {
+            while (head && count--)
+            {
+                StackBlockNode *node = head;
+                head = node->next;
+                size--;
+                char *block = node->block;
+                size_t stack_size = node->stack_size;
+                if (stack_size != s_pool_stack_size)
+                {
+                    // 栈大小已经变化 旧大小的块不再进入全局池
+                    StackBlockUnmap(block, stack_size);
+                    continue;
+                }
+                if (s_pool_trim)
+                {
+                    // 空闲栈的物理页还给系统 保留地址空间 下次使用时缺页重新分配零页
+                    s_pool_trim_num.fetch_add(1, std::memory_order_relaxed);
+                    madvise(block + s_page_size, stack_size & ~(s_page_size - 1), MADV_DONTNEED);
+                }
+                {
+                    SpinLock::Lock lock(s_stack_global_mtx);
+                    if (s_stack_global_size < s_pool_global_max)
+                    {
+                        node->next = s_stack_global_list;
+                        s_stack_global_list = node;
+                        s_stack_global_size++;
+                        continue;
+                    }
+                }
+                StackBlockUnmap(block, stack_size);
+            }
+        }
+        // 线程退出时全部归还全局池
+        void flush()
+        {
+            releaseToGlobal(size);
+        }
+    };
+    static inline FiberStackCache &GetStackCache()
+    {
+        return ThreadCacheHolder<FiberStackCache>::Get();
+    }
+
+    // 协程栈池: 线程本地缓存 + 全局溢出池 只缓存fiber.stack_size大小的栈
+    class PoolStackAllocator
+    {
+    public:
+        // 返回内存块起始地址
+        static char *Alloc(size_t stack_size)
+        {
+            if (s_pool_enable && stack_size == s_pool_stack_size)
+            {
+                FiberStackCache &cache = GetStackCache();
+                if (!cache.head && !cache.dead)
+                {
+                    cache.fetchFromGlobal();
+                }
+                StackBlockNode *node;
+                while ((node = cache.head))
+                {
+                    cache.head = node->next;
+                    cache.size--;
+                    if (XTEN_UNLIKELY(node->stack_size != stack_size))
+                    {
+                        // 栈大小变化前缓存的块 大小不符不能使用
+                        StackBlockUnmap(node->block, node->stack_size);
+                        continue;
+                    }
+                    s_pool_hit.fetch_add(1, std::memory_order_relaxed);
+                    return node->block;
+                }
+            }
+            void *ptr = MmapStackAllocator::Alloc(StackBlockSize(stack_size));
+            if (ptr == MAP_FAILED)
+            {
+                throw std::bad_alloc();
+            }
+            s_pool_mmap.fetch_add(1, std::memory_order_relaxed);
+            if (s_stack_guard)
+            {
+                mprotect(ptr, s_page_size, PROT_NONE);
+            }
+            return (char *)ptr;
+        }
+        static void Dealloc(char *block, size_t stack_size)
+        {
+            if (!s_pool_enable || stack_size != s_pool_stack_size)
+            {
+                StackBlockUnmap(block, stack_size);
+                return;
+            }
+            FiberStackCache &cache = GetStackCache();
+            StackBlockNode *node = StackBlockToNode(block, stack_size);
+            node->block = block;
+            node->stack_size = stack_size;
+            if (cache.dead)
+            {
+                // 线程已退出 直接放入全局池
+                node->next = nullptr;
+                FiberStackCache tmp = {node, 1, true, true};
+                tmp.releaseToGlobal(1);
+                return;
+            }
+            node->next = cache.head;
+            cache.head = node;
+            cache.size++;
+            if (cache.size > s_pool_high)
+            {
+                // 超过高水位 归还到低水位
+                cache.releaseToGlobal(cache.size - s_pool_low);
+            }
+        }
+    };
+    using StackAllocatorType = PoolStackAllocator; // 使用协程栈池开辟栈空间
+
+    struct __FiberStackPool_Init
+    {
+        __FiberStackPool_Init()
+        {
+            s_pool_enable = g_fiber_stack_pool->GetValue();
+            s_pool_high = g_fiber_stack_pool_high->GetValue();
+            s_pool_low = g_fiber_stack_pool_low->GetValue();
+            s_pool_global_max = g_fiber_stack_pool_global_max->GetValue();
+            s_pool_trim = g_fiber_stack_pool_trim->GetValue();
+            s_stack_guard = g_fiber_stack_guard->GetValue();
+            s_pool_stack_size = (g_fiber_stack_size->GetValue() + 15) & ~(size_t)15;
+            g_fiber_stack_pool->AddListener([](const bool &old, const bool &new_value)
+                                            { s_pool_enable = new_value; });
+            g_fiber_stack_pool_high->AddListener([](const uint32_t &old, const uint32_t &new_value)
+                                                 { s_pool_high = new_value; });
+            g_fiber_stack_pool_low->AddListener([](const uint32_t &old, const uint32_t &new_value)
+                                                { s_pool_low = new_value; });
+            g_fiber_stack_pool_global_max->AddListener([](const uint32_t &old, const uint32_t &new_value)
+                                                       { s_pool_global_max = new_value; });
+            g_fiber_stack_pool_trim->AddListener([](const bool &old, const bool &new_value)
+                                                 { s_pool_trim = new_value; });
+            g_fiber_stack_guard->AddListener([](const bool &old, const bool &new_value)
+                                             { s_stack_guard = new_value; });
+            // 栈大小变化后 全局池中旧大小的块全部释放
+            // 线程缓存中的旧块在该线程下次分配/归还时按块上记录的大小释放
+            g_fiber_stack_size->AddListener([](const uint32_t &old, const uint32_t &new_value)
+                                            {
+                s_pool_stack_size = (new_value + 15) & ~(size_t)15;
+                StackBlockNode *list = nullptr;
+                {
+                    SpinLock::Lock lock(s_stack_global_mtx);
+                    StackBlockNode **pnode = &s_stack_global_list;
+                    while (*pnode)
+                    {
+                        StackBlockNode *node = *pnode;
+                        if (node->stack_size == s_pool_stack_size)
+                        {
+                            pnode = &node->next;
+                            continue;
+                        }
+                        *pnode = node->next;
+                        s_stack_global_size--;
+                        node->next = list;
+                        list = node;
+                    }
+                }
+                while (list)
+                {
+                    StackBlockNode *node = list;
+                    list = node->next;
+                    StackBlockUnmap(node->block, node->stack_size);
+                } });
+        }
+    };
+    static __FiberStackPool_Init __fiberStackPoolInit;
+
+    static Xten::ConfigVar<uint32_t>::ptr g_fiber_shared_stack_count =
+        Config::LookUp("fiber.shared_stack.count", (uint32_t)4, "fiber shared stack count per thread");
+    static Xten::ConfigVar<uint32_t>::ptr g_fiber_shared_stack_size =
+        Config::LookUp("fiber.shared_stack.size", (uint32_t)1024 * 1024, "fiber shared stack size");
+    // 切出时记录的栈顶向下多保存的字节数(覆盖切换函数压栈的寄存器/返回地址)
+    static const size_t s_shared_stack_margin = 1024;
+
+    /// @brief 共享运行栈 同一时刻只有一个协程(occupy)的栈内容在上面
+    struct SharedStack
+    {
+        char *stack = nullptr;    // 栈空间(低地址)
+        size_t size = 0;          // 栈大小
+        SpinLock mutex;           // 保护occupy(协程可能在其他线程析构)
+        Fiber *occupy = nullptr;  // 当前占用运行栈的协程
+        ~SharedStack()
+        {
+            if (stack)
+            {
+                MmapStackAllocator::Dealloc(stack, size);
+            }
+        }
+    };
+    // 线程的共享运行栈(协程持有引用 线程退出后仍存活到协程释放)
+    struct SharedStackGroup
+    {
+        std::vector<std::shared_ptr<SharedStack>> stacks;
+        size_t next = 0; // 轮询分配
+    };
+    static thread_local SharedStackGroup t_shared_stacks;
+    static std::shared_ptr<SharedStack> GetSharedStack()
+    {
+        SharedStackGroup &group = t_shared_stacks;
+        if (XTEN_UNLIKELY(group.stacks.empty()))
+        {
+            uint32_t count = std::max(g_fiber_shared_stack_count->GetValue(), (uint32_t)1);
+            size_t size = (g_fiber_shared_stack_size->GetValue() + 15) & ~(size_t)15;
+            for (uint32_t i = 0; i < count; i++)
+            {
+                std::shared_ptr<SharedStack> share = std::make_shared<SharedStack>();
+                void *ptr = MmapStackAllocator::Alloc(size);
+                if (ptr == MAP_FAILED)
+                {
+                    throw std::bad_alloc();
+                }
+                share->stack = (char *)ptr;
+                share->size = size;
+                group.stacks.push_back(share);
+            }
+        }
+        return group.stacks[group.next++ % group.stacks.size()];
+    }
 
     Fiber *NewFiber()
     {
         return new Fiber();
     }
+    Fiber *NewSharedStackFiber(std::function<void()> func)
+    {
+        return new Fiber(func, Fiber::UseSharedStack());
+    }
     Fiber *NewFiber(size_t stack_size, std::function<void()> func, bool use_caller)
     {
         stack_size = stack_size ? stack_size : g_fiber_stack_size->GetValue();
-        // 将协程对象和协程栈空间开辟在同一连续区域
-        void *fiber_ptr = StackAllocatorType::Alloc(sizeof(Fiber) + stack_size);
-        return new (fiber_ptr) Fiber(stack_size, func, use_caller); // placement new
-        // 柔性数组自动指向尾部多余的栈空间起始地址
+        stack_size = (stack_size + 15) & ~(size_t)15; // 栈顶16字节对齐
+        // 将协程对象和协程栈空间开辟在同一连续区域 协程对象在栈顶之上
+        char *block = StackAllocatorType::Alloc(stack_size);
+        char *stack = block + s_page_size;
+        return new (stack + stack_size) Fiber(stack_size, func, use_caller, stack); // placement new
     }
     // 这个FreeFiber用于子协程的删除---子协程智能指针删除器不能使用delete Fiber  -----使用自定义删除器为这个
     // 子协程的空间是比Fiber的空间更大的 并且不是new出来的 而是用空间开辟器开出来的
     void FreeFiber(Fiber *ptr)
     {
+        if (ptr->_shared_stack)
+        {
+            // 共享栈协程只有协程对象是new出来的
+            delete ptr;
+            return;
+        }
         // 对于placement new创建的对象 需要手动调用析构函数并释放空间
+        size_t stack_size = ptr->_stack_size;
+        char *block = ptr->_stack - s_page_size;
         ptr->~Fiber();
-        StackAllocatorType::Dealloc(ptr, sizeof(Fiber) + ptr->_stack_size);
+        StackAllocatorType::Dealloc(block, stack_size);
+    }
+    std::string FiberStackPoolInfo()
+    {
+        size_t global_size = 0;
+        {
+            SpinLock::Lock lock(s_stack_global_mtx);
+            global_size = s_stack_global_size;
+        }
+        return "FiberStackPool hit:" + std::to_string(s_pool_hit) +
+               " mmap:" + std::to_string(s_pool_mmap) +
+               " munmap:" + std::to_string(s_pool_munmap) +
+               " trim:" + std::to_string(s_pool_trim_num) +
+               " global:" + std::to_string(global_size) + "\n";
     }
 
     // 线程主协程默认构造
@@ -88,8 +432,23 @@ namespace Xten
     }
 
     // 子协程构造函数
-    Fiber::Fiber(size_t stack_size, std::function<void()> func, bool use_caller)
-        : _fiber_id(++s_fiber_id), _stack_size(stack_size), _func(func), _user_caller(use_caller)
+    Fiber::Fiber(size_t stack_size, std::function<void()> func, bool use_caller, char *stack)
+        : _fiber_id(++s_fiber_id), _stack_size(stack_size), _func(func), _user_caller(use_caller),
+          _stack(stack ? stack : (char *)(this + 1))
+    {
+        makeContext();
+        s_total_num++;
+        XTEN_LOG_DEBUG(g_logger) << "Fiber::id=" << _fiber_id << " create success";
+    }
+    // 共享栈子协程构造函数
+    Fiber::Fiber(std::function<void()> func, UseSharedStack)
+        : _user_caller(false), _fiber_id(++s_fiber_id), _stack_size(0), _func(func), _shared_stack(true)
+    {
+        s_total_num++;
+        XTEN_LOG_DEBUG(g_logger) << "Fiber::id=" << _fiber_id << " create success (shared stack)";
+    }
+    // 根据栈空间创建协程上下文
+    void Fiber::makeContext()
     {
 #if FIBER_TYPE == FIBER_UCONTEXT
         if (getcontext(&_ctx))
@@ -128,14 +487,90 @@ namespace Xten
             coctx_make(&_ctx, &Fiber::MainFunc, 0, 0);
         }
 #endif
-        s_total_num++;
-        XTEN_LOG_DEBUG(g_logger) << "Fiber::id=" << _fiber_id << " create success";
+    }
+    // 共享栈协程切入前(在调度协程栈上执行)
+    void Fiber::sharedStackSwapIn()
+    {
+        if (XTEN_UNLIKELY(!_share))
+        {
+            // 第一次切入 绑定当前线程的一个运行栈
+            _share = GetSharedStack();
+            _bound_thread = Xten::ThreadUtil::GetThreadId();
+            _stack = _share->stack;
+            _stack_size = _share->size;
+        }
+        XTEN_ASSERTINFO(_bound_thread == Xten::ThreadUtil::GetThreadId(),
+                        "shared stack fiber must run on its bound thread");
+        SpinLock::Lock lock(_share->mutex);
+        Fiber *occupy = _share->occupy;
+        if (occupy == this)
+        {
+            // 栈内容还在运行栈上
+            return;
+        }
+        if (occupy && occupy->_status != Status::TERM && occupy->_status != Status::EXCEPT)
+        {
+            // 换出占用者 只保存它实际使用的部分
+            occupy->saveStack();
+        }
+        if (_status == Status::INIT)
+        {
+            // 初始上下文写在运行栈顶 必须在换出占用者之后创建
+            makeContext();
+        }
+        else if (_save_size)
+        {
+            memcpy(_stack_sp, _save_buf, _save_size);
+        }
+        _share->occupy = this;
+    }
+    // 记录切出时的栈顶(在协程自己的栈上执行)
+    void Fiber::recordStackTop()
+    {
+        char probe = 0;
+        char *sp = &probe - s_shared_stack_margin;
+        _stack_sp = sp < _stack ? _stack : sp;
+    }
+    // 保存栈内容到按需大小的缓冲区
+    void Fiber::saveStack()
+    {
+        size_t size = _stack + _stack_size - _stack_sp;
+        if (size > _save_cap || size < _save_cap / 2)
+        {
+            free(_save_buf);
+            _save_buf = (char *)malloc(size);
+            if (!_save_buf)
+            {
+                throw std::bad_alloc();
+            }
+            _save_cap = size;
+        }
+        memcpy(_save_buf, _stack_sp, size);
+        _save_size = size;
+    }
+    bool Fiber::IsCurSharedStack()
+    {
+        return t_cur_fiber && t_cur_fiber->_shared_stack;
     }
 
     Fiber::~Fiber()
     {
         --s_total_num;
-        if (_stack_size) // 子协程析构
+        if (_shared_stack)
+        {
+            if (_share)
+            {
+                // 可能在其他线程析构 加锁后再离开运行栈
+                SpinLock::Lock lock(_share->mutex);
+                if (_share->occupy == this)
+                {
+                    _share->occupy = nullptr;
+                }
+            }
+            free(_save_buf);
+        }
+        clearLocals();
+        if (_stack_size || _shared_stack) // 子协程析构
         {
             XTEN_ASSERT((_status == Status::EXCEPT ||
                          _status == Status::INIT ||
@@ -159,6 +594,10 @@ namespace Xten
     void Fiber::SwapIn() // 调度协程切到目标协程
     {
         XTEN_ASSERT((_status != Status::EXEC));
+        if (_shared_stack)
+        {
+            sharedStackSwapIn();
+        }
         SetThis(this);
         _status = Status::EXEC;
 #if FIBER_TYPE == FIBER_UCONTEXT
@@ -197,6 +636,10 @@ namespace Xten
     // 切出协程
     void Fiber::SwapOut() // 切回调度协程
     {
+        if (_shared_stack)
+        {
+            recordStackTop();
+        }
         SetThis(Scheduler::GetScheduleFiber());
 #if FIBER_TYPE == FIBER_UCONTEXT
         if (swapcontext(&_ctx, &Scheduler::GetScheduleFiber()->_ctx) == -1)
@@ -249,46 +692,60 @@ namespace Xten
     void Fiber::Reset(std::function<void()> func)
     {
         XTEN_ASSERT(_stack);
+        XTEN_ASSERT(!_shared_stack);
         XTEN_ASSERT((_status == Status::INIT ||
                      _status == Status::EXCEPT ||
                      _status == Status::TERM));
+        clearLocals();
         _func = func;
-#if FIBER_TYPE == FIBER_UCONTEXT
-        if (getcontext(&_ctx))
+        makeContext();
+        _status = Status::INIT;
+    }
+
+    size_t Fiber::RegisterLocalSlot(LocalDtor dtor)
+    {
+        size_t slot = s_local_slots.fetch_add(1, std::memory_order_acq_rel);
+        XTEN_ASSERTINFO(slot < MAX_LOCAL_SLOTS, "fiber local slots exhausted");
+        s_local_dtors[slot] = dtor;
+        return slot;
+    }
+    void *Fiber::GetLocal(size_t slot)
+    {
+        Fiber *cur = t_cur_fiber;
+        if (!cur)
         {
-            XTEN_ASSERTINFO(false, "getcontext error");
-        }
-        _ctx.uc_link = nullptr;
-        _ctx.uc_stack.ss_size = _stack_size;
-        _ctx.uc_stack.ss_sp = _stack;
-        if (_user_caller)
-        {                                                  // 加入调度
-            makecontext(&_ctx, &Fiber::CallerMainFunc, 0); // 创建子协程上下文
+            // 线程还没有协程 创建主协程
+            cur = GetThis().get();
         }
-        else
+        return slot < cur->_locals.size() ? cur->_locals[slot] : nullptr;
+    }
+    void Fiber::SetLocal(size_t slot, void *val)
+    {
+        XTEN_ASSERT(slot < s_local_slots.load(std::memory_order_acquire));
+        Fiber *cur = t_cur_fiber;
+        if (!cur)
         {
-            makecontext(&_ctx, &Fiber::MainFunc, 0);
+            cur = GetThis().get();
         }
-#elif FIBER_TYPE == FIBER_FCONTEXT
-        if (_user_caller)
-        {
-            _ctx = Xten::make_fcontext((char *)_stack + _stack_size, _stack_size, &Fiber::CallerMainFunc);
-        } // 这里栈空间的首地址是高地址
-        else
+        if (slot >= cur->_locals.size())
         {
-            _ctx = Xten::make_fcontext((char *)_stack + _stack_size, _stack_size, &Fiber::MainFunc);
+            // 一次扩到已注册的槽位数 之后都是下标访问
+            cur->_locals.resize(s_local_slots.load(std::memory_order_acquire), nullptr);
         }
-#elif FIBER_TYPE == FIBER_COCTX
-        if (_user_caller)
-        {
-            coctx_make(&_ctx, &Fiber::CallerMainFunc, 0, 0);
-        } // 这里栈空间的首地址是高地址
-        else
+        cur->_locals[slot] = val;
+    }
+    // 析构所有协程局部存储
+    void Fiber::clearLocals()
+    {
+        for (size_t i = 0; i < _locals.size(); ++i)
         {
-            coctx_make(&_ctx, &Fiber::MainFunc, 0, 0);
+            void *v = _locals[i];
+            if (v)
+            {
+                _locals[i] = nullptr;
+                s_local_dtors[i](v);
+            }
         }
-#endif
-        _status = Status::INIT;
     }
 
     // 获取协程状态
@@ -2,6 +2,8 @@
 #define __XTEN_FIBER_H__
 #include <memory>
 #include <functional>
+#include <string>
+#include <vector>
 #define FIBER_UCONTEXT 0 // ucontext
 #define FIBER_FCONTEXT 1 // fcontext
 #define FIBER_COCTX 2    // coctx
@@ -22,8 +24,17 @@ namespace Xten
         Fiber *NewFiber();
         Fiber *NewFiber(size_t stack_size, std::function<void()> func, bool use_caller);
         void FreeFiber(Fiber *ptr);
+        // 创建共享栈协程(由FreeFiber释放)
+        Fiber *NewSharedStackFiber(std::function<void()> func);
+        // 协程栈池状态信息
+        std::string FiberStackPoolInfo();
         class Scheduler;
+        struct SharedStack;
         // 封装有栈协程类
+        // 共享栈模式(copy-stack): 每个线程少量大的运行栈由多个协程共用 协程被换出运行栈时
+        // 只把实际使用的栈内容拷贝到按需大小的缓冲区 适合大量长期挂起的连接
+        // 限制: 1.第一次切入后绑定该线程 只能在该线程执行(调度时自动指定线程)
+        //       2.协程挂起期间其他协程/线程/内核不能访问它栈上的对象(栈上变量的地址只在运行时有效)
         class Fiber : public std::enable_shared_from_this<Fiber>
         {
         public:
@@ -31,6 +42,14 @@ namespace Xten
                 friend void FreeFiberToObjPool(Fiber *ptr);
                 friend class Scheduler;
                 typedef std::shared_ptr<Fiber> ptr;
+                // 协程局部存储槽位的析构函数
+                typedef void (*LocalDtor)(void *);
+                // 协程局部存储最大槽位数
+                static constexpr size_t MAX_LOCAL_SLOTS = 64;
+                // 共享栈协程构造标记
+                struct UseSharedStack
+                {
+                };
                 enum Status
                 {
                         INIT,  // 初始化
@@ -42,8 +61,10 @@ namespace Xten
                 };
                 // 线程主协程默认构造
                 Fiber();
-                // 子协程构造函数
-                Fiber(size_t stack_size, std::function<void()> func, bool use_caller);
+                // 子协程构造函数 stack为空时栈空间紧跟在协程对象之后
+                Fiber(size_t stack_size, std::function<void()> func, bool use_caller, char *stack = nullptr);
+                // 共享栈子协程构造函数 运行栈在第一次切入时绑定
+                Fiber(std::function<void()> func, UseSharedStack);
                 ~Fiber();
                 // 切入协程---由调度协程切入
                 void SwapIn();
@@ -61,6 +82,12 @@ namespace Xten
                 void Reset(std::function<void()> func);
                 // 获取协程状态
                 Fiber::Status GetStatus() const;
+                // 是否是共享栈协程
+                bool IsSharedStack() const { return _shared_stack; }
+                // 共享栈协程绑定的线程id 未绑定(或者不是共享栈协程)返回-1
+                int GetBoundThread() const { return _bound_thread; }
+                // 当前协程是否是共享栈协程
+                static bool IsCurSharedStack();
                 // 获取协程id
                 static size_t GetFiberId();
                 // 协程的真正入口函数--非用户传入
@@ -80,6 +107,24 @@ namespace Xten
                 static std::shared_ptr<Fiber> GetThis();
                 // 获取总协程数
                 static int64_t GetTotalFiberNums();
+                // 注册协程局部存储槽位 返回槽位下标(在启动阶段静态注册 一般通过FiberLocal<T>)
+                static size_t RegisterLocalSlot(LocalDtor dtor);
+                // 获取当前协程槽位的值 未设置返回nullptr
+                static void *GetLocal(size_t slot);
+                // 设置当前协程槽位的值(旧值不会析构) 协程Reset或释放时调用槽位析构函数
+                static void SetLocal(size_t slot, void *val);
+
+        private:
+                // 根据栈空间创建协程上下文
+                void makeContext();
+                // 共享栈协程切入前: 绑定运行栈 换出占用者 恢复自己的栈内容
+                void sharedStackSwapIn();
+                // 记录切出时的栈顶
+                void recordStackTop();
+                // 保存栈内容到缓冲区
+                void saveStack();
+                // 析构所有协程局部存储
+                void clearLocals();
 
         private:
                 bool _user_caller;           // 是否参与协程调度
@@ -94,7 +139,71 @@ namespace Xten
 #elif FIBER_TYPE == FIBER_COCTX
                 coctx_t _ctx;
 #endif
-                char _stack[]; // 柔性数组 指向协程栈空间
+                char *_stack = nullptr; // 协程栈空间(低地址)
+                bool _shared_stack = false;          // 是否使用共享栈
+                int _bound_thread = -1;              // 共享栈协程绑定的线程id
+                std::shared_ptr<SharedStack> _share; // 共享栈协程绑定的运行栈
+                char *_stack_sp = nullptr;           // 共享栈协程切出时的栈顶
+                char *_save_buf = nullptr;           // 共享栈协程被换出时保存的栈内容
+                size_t _save_size = 0;               // 保存的栈内容大小
+                size_t _save_cap = 0;                // 缓冲区容量
+                std::vector<void *> _locals;         // 协程局部存储(按槽位下标访问)
+        };
+
+        // 类型化的协程局部存储 定义为全局/静态变量 每个实例在启动时注册一个槽位
+        // 例: static FiberLocal<std::string> t_trace_id;  t_trace_id.Set("xxx");
+        // 值在协程Reset或释放时析构 没有协程时(线程主协程)同样可用
+        template <class T>
+        class FiberLocal
+        {
+        public:
+                FiberLocal()
+                    : _slot(Fiber::RegisterLocalSlot(&FiberLocal::destroy))
+                {
+                }
+                // 获取当前协程的值 未设置返回nullptr
+                T *Get() const
+                {
+                        return static_cast<T *>(Fiber::GetLocal(_slot));
+                }
+                // 获取当前协程的值 未设置则默认构造
+                T &GetOrCreate() const
+                {
+                        T *v = Get();
+                        if (!v)
+                        {
+                                v = new T();
+                                Fiber::SetLocal(_slot, v);
+                        }
+                        return *v;
+                }
+                // 设置当前协程的值
+                template <class... Args>
+                T &Set(Args &&...args) const
+                {
+                        T *v = new T(std::forward<Args>(args)...);
+                        T *old = Get();
+                        Fiber::SetLocal(_slot, v);
+                        delete old;
+                        return *v;
+                }
+                // 提前析构当前协程的值
+                void Clear() const
+                {
+                        T *old = Get();
+                        Fiber::SetLocal(_slot, nullptr);
+                        delete old;
+                }
+                T *operator->() const { return Get(); }
+
+        private:
+                static void destroy(void *v)
+                {
+                        delete static_cast<T *>(v);
+                }
+
+        private:
+                size_t _slot; // 槽位下标
         };
 }
 #endif
@@ -4,6 +4,7 @@
 #include "iomanager.h"
 #include "fdmanager.h"
 #include "timer.h"
+#include "objpool.h"
 #include <dlfcn.h>
 #include <time.h>
 #include <sys/types.h>
@@ -11,6 +12,10 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <sys/socket.h>
+#include <string.h>
+#include <algorithm>
+#include <unordered_map>
+#include <deque>
 #define HOOK_FUN(XX) \
     XX(sleep)        \
     XX(usleep)       \
@@ -90,9 +95,95 @@ struct timer_condition
 {
     int cancelled = 0;
 };
+#ifdef XTEN_IO_URING
+/// @brief 填充读写类sqe
+static void uring_prep_rw(io_uring_sqe *sqe, uint8_t opcode, int fd, const void *addr, size_t len, uint64_t off)
+{
+    sqe->opcode = opcode;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)addr;
+    sqe->len = len > UINT32_MAX ? UINT32_MAX : (uint32_t)len;
+    sqe->off = off;
+}
+/// @brief 没有对应io_uring操作的hook函数(只走epoll)
+static bool uring_wait(Xten::IOManager *, std::nullptr_t, uint64_t, const std::shared_ptr<timer_condition> &, ssize_t &)
+{
+    return false;
+}
+/// @brief 提交io_uring请求并挂起当前协程直到完成 提交失败返回false(由调用者回退epoll)
+/// 超时沿用条件定时器: 定时器触发后取消内核中的请求 没有超时时timecond可以为空
+template <class Prep>
+static bool uring_wait(Xten::IOManager *iom, Prep &prep, uint64_t timeout,
+                       const std::shared_ptr<timer_condition> &timecond, ssize_t &ret)
+{
+    if (Xten::Fiber::IsCurSharedStack())
+    {
+        // 共享栈协程挂起后栈内容会被换出 内核不能异步读写它栈上的请求和缓冲区 只走epoll
+        return false;
+    }
+    Xten::IOManager::UringRequest stack_req;
+    Xten::IOManager::UringRequest *preq = &stack_req;
+    std::shared_ptr<Xten::IOManager::UringRequest> shared_req;
+    Xten::Timer::ptr timer;
+    if (timeout != (uint64_t)-1)
+    {
+        // 请求的地址就是内核中取消用的标识 定时器可能与请求完成并发触发
+        // 有超时的请求放在堆上由定时器共同持有 取消时该地址不会被之后的请求复用(栈上的地址会)
+        shared_req = Xten::ObjPoolMakeShared<Xten::IOManager::UringRequest>();
+        preq = shared_req.get();
+        std::weak_ptr<timer_condition> wkcond(timecond);
+        timer = iom->addConditionTimer(timeout, [wkcond, iom, shared_req]()
+                                       {
+            std::shared_ptr<timer_condition> cond=wkcond.lock();
+            if(!cond || cond->cancelled)
+            {
+                return;
+            }
+            //超时取消内核中的请求
+            cond->cancelled=ETIMEDOUT;
+            iom->UringCancel(shared_req.get()); }, wkcond);
+    }
+    Xten::IOManager::UringRequest &req = *preq;
+    if (!iom->UringWait(req, prep))
+    {
+        if (timer)
+        {
+            timer->cancel();
+        }
+        return false;
+    }
+    if (timer)
+    {
+        timer->cancel();
+    }
+    if (req.res >= 0)
+    {
+        ret = req.res;
+        return true;
+    }
+    if (req.res == -ECANCELED)
+    {
+        // 超时取消 或者fd被关闭(CancelAll)
+        errno = timecond && timecond->cancelled ? timecond->cancelled : EBADF;
+    }
+    else
+    {
+        errno = -req.res;
+    }
+    ret = -1;
+    return true;
+}
+#endif
+#ifdef XTEN_IO_URING
+// hook函数中填充sqe的lambda
+#define URING_PREP(...) [&](io_uring_sqe * sqe) __VA_ARGS__
+#else
+#define URING_PREP(...) nullptr
+#endif
 /// @brief socket读写函数的模板hook函数
-template <class OriginFun, class... Args>
-static ssize_t do_io(int fd, OriginFun fun, const char *hook_name, uint32_t event, int timeout_type, Args &&...args)
+/// prep: 启用io_uring时fd未就绪 用prep填充sqe提交给内核(nullptr表示只走epoll)
+template <class OriginFun, class Prep, class... Args>
+static ssize_t do_io(int fd, OriginFun fun, const char *hook_name, uint32_t event, int timeout_type, Prep prep, Args &&...args)
 {
     // 1.未设置hook属性
     if (!Xten::is_hook_enable())
@@ -100,7 +191,7 @@ static ssize_t do_io(int fd, OriginFun fun, const char *hook_name, uint32_t even
         return fun(fd, std::forward<Args>(args)...);
     }
     // 2.设置了 先看fdMgr
-    Xten::FdCtx::ptr fdctx = Xten::FdCtxMgr::GetInstance()->Get(fd, false);
+    Xten::FdCtx *fdctx = Xten::FdCtxMgr::GetInstance()->Get(fd, false);
     // 框架层未管理该fdctx
     if (!fdctx)
     {
@@ -119,7 +210,6 @@ static ssize_t do_io(int fd, OriginFun fun, const char *hook_name, uint32_t even
     }
     // 是socket且是阻塞io
     uint64_t timeout = fdctx->GetTimeOut(timeout_type);
-    std::shared_ptr<timer_condition> timecond = std::make_shared<timer_condition>();
 retry: // 再次回来重试
     // 尝试读写
     ssize_t ret = fun(fd, std::forward<Args>(args)...);
@@ -131,49 +221,40 @@ retry: // 再次回来重试
     // 读写条件不就绪 ---给上层的感觉是阻塞 内部hook实现切换回调度协程 再由调度协程切换到其他工作协程或者idle协程
     if (ret == -1 && errno == EAGAIN)
     {
-        std::weak_ptr<timer_condition> wkcond(timecond);
         Xten::IOManager *iom = Xten::IOManager::GetThis();
-        Xten::Timer::ptr timer;
-        if (timeout != (uint64_t)-1)
+#ifdef XTEN_IO_URING
+        // io_uring后端: 直接提交请求 由完成事件唤醒 不需要epoll_ctl和再次系统调用
+        if (iom->IsUringEnabled())
         {
-            // 有超时时间--添加条件定时器
-            timer = iom->addConditionTimer(timeout, [wkcond, event, iom, fd]()
-                                           {
-                std::shared_ptr<timer_condition> cond=wkcond.lock();
-                //已經取消或者條件不存在(大概率不存在这种情况)
-                if(!cond || cond->cancelled)
-                {
-                    return;
-                }
-                //條件依然存在--超时取消事件
-                cond->cancelled=ETIMEDOUT;
-                iom->CancelEvent(fd,(Xten::IOManager::Event)(event)); }, wkcond);
+            // 只有设置了超时才需要条件定时器
+            std::shared_ptr<timer_condition> timecond;
+            if (timeout != (uint64_t)-1)
+            {
+                timecond = std::make_shared<timer_condition>();
+            }
+            if (uring_wait(iom, prep, timeout, timecond, ret))
+            {
+                return ret;
+            }
         }
-        // 向io调度器添加io事件
-        int rt = iom->AddEvent(fd, (Xten::IOManager::Event)(event)); // 不传入默认是当前协程
+#endif
+        // 向io调度器添加io事件 超时由io调度器的时间轮处理 不需要定时器
+        uint32_t token = 0;
+        int rt = iom->AddEventTimeout(fd, (Xten::IOManager::Event)(event), timeout, token); // 当前协程等待
         // 添加事件失败
         if (XTEN_UNLIKELY(rt))
         {
             XTEN_LOG_ERROR(g_logger) << hook_name << " addEvent("
                                      << fd << ", " << event << ")";
-            if (timer)
-            {
-                timer->cancel();
-            }
             return -1;
         }
         // 添加成功 --挂起当前协程
         Xten::Fiber::YieldToHold();
-        // 由于事件就绪 协程重新放回调度队列 再次由线程切入
-        if (timer)
-        {
-            // 取消超时器
-            timer->cancel();
-        }
-        if (timecond->cancelled)
+        // 由于事件就绪或超时 协程重新放回调度队列 再次由线程切入
+        if (timeout != (uint64_t)-1 && iom->IsEventTimedOut(fd, (Xten::IOManager::Event)(event), token))
         {
             // 超时返回
-            errno = timecond->cancelled;
+            errno = ETIMEDOUT;
             return -1;
         }
         // 未超时返回---重新继续读取数据
@@ -182,6 +263,717 @@ retry: // 再次回来重试
     return ret;
 }
 
+#ifdef XTEN_IO_URING
+/// @brief 监听socket上常驻的multishot accept请求 内核每接受一个连接产生一个完成事件
+struct uring_acceptor
+{
+    Xten::IOManager::UringRequest req;     // multishot请求
+    Xten::IOManager *iom = nullptr;         // 请求提交到的io调度器
+    Xten::SpinLock mutex;                   // 保护以下成员
+    std::deque<int> ready;                  // 已接受还未取走的连接fd(负数为-errno)
+    Xten::Scheduler *scheduler = nullptr;   // 等待连接的协程所属调度器
+    Xten::Fiber::ptr waiter;                // 等待连接的协程
+    bool armed = false;                     // 请求是否还在内核中
+    bool closed = false;                    // 监听fd已关闭
+    std::shared_ptr<uring_acceptor> self;   // 请求在内核中期间保持存活
+};
+static Xten::SpinLock s_acceptors_mutex;
+static std::unordered_map<int, std::shared_ptr<uring_acceptor>> s_acceptors;
+static std::atomic<bool> s_multishot_accept_unsupported{false}; // 内核不支持multishot accept
+
+/// @brief multishot accept完成事件回调(在收割线程中执行)
+static void uring_accept_complete(uring_acceptor *acc, int res, uint32_t flags)
+{
+    Xten::Scheduler *sche = nullptr;
+    Xten::Fiber::ptr fiber;
+    std::shared_ptr<uring_acceptor> self;
+    {
+        Xten::SpinLock::Lock lock(acc->mutex);
+        if (!(flags & IORING_CQE_F_MORE))
+        {
+            // 请求结束 回调返回后可以释放
+            acc->armed = false;
+            self.swap(acc->self);
+            if (res == -EINVAL && acc->ready.empty())
+            {
+                s_multishot_accept_unsupported = true;
+            }
+        }
+        if (acc->closed)
+        {
+            // 监听fd已关闭 之后接受的连接没有人取走
+            if (res >= 0)
+            {
+                close_f(res);
+            }
+        }
+        else if (!s_multishot_accept_unsupported)
+        {
+            acc->ready.push_back(res);
+        }
+        sche = acc->scheduler;
+        fiber.swap(acc->waiter);
+        acc->scheduler = nullptr;
+    }
+    if (fiber)
+    {
+        sche->Schedule(std::move(fiber));
+    }
+}
+
+/// @brief 使用multishot accept接受连接 不适用(非阻塞/有超时/不支持)返回false
+static bool uring_accept(int sockfd, struct sockaddr *addr, socklen_t *addrlen, int &ret)
+{
+    if (!Xten::is_hook_enable() || s_multishot_accept_unsupported)
+    {
+        return false;
+    }
+    Xten::IOManager *iom = Xten::IOManager::GetThis();
+    if (!iom || !iom->IsUringEnabled())
+    {
+        return false;
+    }
+    Xten::FdCtx *fdctx = Xten::FdCtxMgr::GetInstance()->Get(sockfd, false);
+    if (!fdctx || fdctx->IsClose() || !fdctx->IsSocket() || fdctx->GetUserNoBlock() ||
+        fdctx->GetTimeOut(SO_RCVTIMEO) != (uint64_t)-1)
+    {
+        return false;
+    }
+    std::shared_ptr<uring_acceptor> acc;
+    {
+        Xten::SpinLock::Lock lock(s_acceptors_mutex);
+        std::shared_ptr<uring_acceptor> &slot = s_acceptors[sockfd];
+        if (!slot)
+        {
+            slot = std::make_shared<uring_acceptor>();
+        }
+        acc = slot;
+    }
+    while (true)
+    {
+        Xten::SpinLock::Lock lock(acc->mutex);
+        if (!acc->ready.empty())
+        {
+            int res = acc->ready.front();
+            acc->ready.pop_front();
+            lock.unlock();
+            if (res < 0)
+            {
+                errno = -res;
+                ret = -1;
+                return true;
+            }
+            if (addr && addrlen)
+            {
+                getpeername(res, addr, addrlen);
+            }
+            ret = res;
+            return true;
+        }
+        if (acc->closed || acc->waiter)
+        {
+            // 已关闭 或者已经有其他协程在等待 走原来的方式
+            return false;
+        }
+        if (!acc->armed)
+        {
+            if (s_multishot_accept_unsupported)
+            {
+                return false;
+            }
+            // 先尝试一次 连接已经就绪时不需要提交请求
+            int fd = accept_f(sockfd, addr, addrlen);
+            if (fd >= 0)
+            {
+                ret = fd;
+                return true;
+            }
+            if (errno != EAGAIN)
+            {
+                ret = -1;
+                return true;
+            }
+            acc->armed = true;
+            acc->iom = iom;
+            acc->self = acc;
+            // 请求结束时收割线程会移走回调 每次提交重新设置
+            uring_acceptor *raw = acc.get();
+            acc->req.cb = [raw](int res, uint32_t flags)
+            { uring_accept_complete(raw, res, flags); };
+            lock.unlock();
+            auto prep = [sockfd](io_uring_sqe *sqe)
+            {
+                uring_prep_rw(sqe, IORING_OP_ACCEPT, sockfd, nullptr, 0, 0);
+                sqe->ioprio |= IORING_ACCEPT_MULTISHOT;
+            };
+            if (!iom->UringSubmit(&acc->req, [](io_uring_sqe *sqe, void *arg)
+                                  { (*(decltype(prep) *)arg)(sqe); },
+                                  &prep))
+            {
+                lock.lock();
+                acc->armed = false;
+                acc->self.reset();
+                return false;
+            }
+            continue;
+        }
+        // 等待下一个连接
+        acc->scheduler = Xten::Scheduler::GetThis();
+        acc->waiter = Xten::Fiber::GetThis();
+        lock.unlock();
+        Xten::Fiber::YieldToHold();
+    }
+}
+
+/// @brief 监听fd关闭 丢弃multishot accept状态并取消内核中的请求
+static void uring_accept_close(int fd)
+{
+    std::shared_ptr<uring_acceptor> acc;
+    {
+        Xten::SpinLock::Lock lock(s_acceptors_mutex);
+        auto it = s_acceptors.find(fd);
+        if (it == s_acceptors.end())
+        {
+            return;
+        }
+        acc = it->second;
+        s_acceptors.erase(it);
+    }
+    Xten::Scheduler *sche = nullptr;
+    Xten::Fiber::ptr fiber;
+    Xten::IOManager *iom = nullptr;
+    {
+        Xten::SpinLock::Lock lock(acc->mutex);
+        acc->closed = true;
+        iom = acc->armed ? acc->iom : nullptr;
+        // 已接受但没有被取走的连接直接关闭
+        for (int res : acc->ready)
+        {
+            if (res >= 0)
+            {
+                close_f(res);
+            }
+        }
+        acc->ready.clear();
+        acc->ready.push_back(-EBADF);
+        sche = acc->scheduler;
+        fiber.swap(acc->waiter);
+        acc->scheduler = nullptr;
+    }
+    // 关闭fd的线程不一定属于提交请求的io调度器(CancelAll取消不到) 请求留在内核中调度器无法停止
+    if (iom)
+    {
+        iom->UringCancel(&acc->req);
+    }
+    if (fiber)
+    {
+        sche->Schedule(std::move(fiber));
+    }
+}
+
+/// @brief 连接socket上常驻的multishot recv请求 内核收到数据就放进提供缓冲区并产生一个完成事件
+struct uring_receiver
+{
+    Xten::IOManager::UringRequest req;                 // multishot请求
+    Xten::IOManager *iom = nullptr;                    // 请求提交到的io调度器
+    Xten::IoUring *uring = nullptr;                    // 提供缓冲区所属的io_uring
+    Xten::SpinLock mutex;                              // 保护以下成员
+    std::deque<std::pair<int, uint16_t>> ready;        // 已收到还未取走的数据(长度,缓冲区id) 0为对端关闭 负数为-errno
+    size_t offset = 0;                                 // 队头缓冲区已取走的字节数
+    Xten::Scheduler *scheduler = nullptr;              // 等待数据的协程所属调度器
+    Xten::Fiber::ptr waiter;                           // 等待数据的协程
+    bool armed = false;                                // 请求是否还在内核中
+    bool closed = false;                               // fd已关闭
+    bool nobufs = false;                               // 请求因为提供缓冲区耗尽而结束
+    bool timedout = false;                             // 等待超时
+    std::shared_ptr<uring_receiver> self;              // 请求在内核中期间保持存活
+};
+static Xten::SpinLock s_receivers_mutex;
+static std::unordered_map<int, std::shared_ptr<uring_receiver>> s_receivers;
+
+/// @brief multishot recv完成事件回调(在收割线程中执行)
+static void uring_recv_complete(uring_receiver *rcv, int res, uint32_t flags)
+{
+    Xten::Scheduler *sche = nullptr;
+    Xten::Fiber::ptr fiber;
+    std::shared_ptr<uring_receiver> self;
+    {
+        Xten::SpinLock::Lock lock(rcv->mutex);
+        if (!(flags & IORING_CQE_F_MORE))
+        {
+            // 请求结束 回调返回后可以释放
+            rcv->armed = false;
+            self.swap(rcv->self);
+        }
+        if (rcv->closed)
+        {
+            // fd已关闭 数据没有人取走 直接归还缓冲区
+            if (flags & IORING_CQE_F_BUFFER)
+            {
+                rcv->uring->RecycleRecvBuffer(flags >> IORING_CQE_BUFFER_SHIFT);
+            }
+        }
+        else if (res > 0)
+        {
+            rcv->ready.push_back(std::make_pair(res, (uint16_t)(flags >> IORING_CQE_BUFFER_SHIFT)));
+        }
+        else if (res == -ENOBUFS)
+        {
+            // 提供缓冲区耗尽 下次读取时回退普通recv
+            rcv->nobufs = true;
+        }
+        else if (res != -ECANCELED)
+        {
+            rcv->ready.push_back(std::make_pair(res, (uint16_t)0));
+        }
+        sche = rcv->scheduler;
+        fiber.swap(rcv->waiter);
+        rcv->scheduler = nullptr;
+    }
+    if (fiber)
+    {
+        sche->Schedule(std::move(fiber));
+    }
+}
+
+/// @brief 从已收到的数据中拷贝到iov ---需持有rcv->mutex
+/// MSG_PEEK只拷贝不取走 MSG_TRUNC只取走不拷贝(流式socket丢弃数据)
+static ssize_t uring_recv_consume(uring_receiver *rcv, const struct iovec *iov, int iovcnt, int flags)
+{
+    bool peek = flags & MSG_PEEK;
+    bool discard = flags & MSG_TRUNC;
+    size_t copied = 0;
+    size_t iov_off = 0;
+    size_t offset = rcv->offset;
+    int i = 0;
+    auto it = rcv->ready.begin();
+    while (it != rcv->ready.end() && i < iovcnt)
+    {
+        if (it->first <= 0)
+        {
+            break;
+        }
+        size_t n = std::min((size_t)it->first - offset, iov[i].iov_len - iov_off);
+        if (!discard)
+        {
+            memcpy((char *)iov[i].iov_base + iov_off,
+                   (char *)rcv->uring->GetRecvBufferAddr(it->second) + offset, n);
+        }
+        copied += n;
+        iov_off += n;
+        offset += n;
+        if (offset == (size_t)it->first)
+        {
+            offset = 0;
+            if (peek)
+            {
+                ++it;
+            }
+            else
+            {
+                // 缓冲区数据取完 还给内核
+                rcv->uring->RecycleRecvBuffer(it->second);
+                rcv->ready.pop_front();
+                it = rcv->ready.begin();
+            }
+        }
+        if (iov_off == iov[i].iov_len)
+        {
+            i++;
+            iov_off = 0;
+        }
+    }
+    if (!peek)
+    {
+        rcv->offset = offset;
+    }
+    if (copied > 0)
+    {
+        return copied;
+    }
+    // 没有数据 队头是对端关闭或者错误
+    int res = rcv->ready.front().first;
+    if (res == 0)
+    {
+        // 对端关闭保留在队列中 之后的读取都返回0
+        return 0;
+    }
+    if (!peek)
+    {
+        rcv->ready.pop_front();
+    }
+    errno = -res;
+    return -1;
+}
+
+/// @brief 跳过iov中已经填充的n个字节(MSG_WAITALL分多次读取)
+static void uring_recv_advance(std::vector<struct iovec> &iov, size_t n)
+{
+    size_t i = 0;
+    while (i < iov.size() && n >= iov[i].iov_len)
+    {
+        n -= iov[i].iov_len;
+        i++;
+    }
+    iov.erase(iov.begin(), iov.begin() + i);
+    if (!iov.empty())
+    {
+        iov[0].iov_base = (char *)iov[0].iov_base + n;
+        iov[0].iov_len -= n;
+    }
+}
+
+/// @brief 使用multishot recv读取数据 返回false时调用方直接读取fd
+/// fd一旦开启了multishot recv 之后的读取(不论flags/是否非阻塞)都必须经过接收器:
+/// 已缓存的数据比内核中的数据更早 直接recv会导致乱序 只有缓存为空且请求不在内核中时才能回退
+static bool uring_recv(int fd, const struct iovec *iov, int iovcnt, int flags, ssize_t &ret)
+{
+    if (flags & (MSG_OOB | MSG_ERRQUEUE))
+    {
+        // 带外数据/错误队列不属于数据流
+        return false;
+    }
+    size_t total = 0;
+    for (int i = 0; i < iovcnt; i++)
+    {
+        total += iov[i].iov_len;
+    }
+    if (total == 0)
+    {
+        return false;
+    }
+    Xten::IOManager *iom = Xten::IOManager::GetThis();
+    bool can_arm = iom && iom->IsUringEnabled() && iom->GetUring()->HasRecvBufRing();
+    std::shared_ptr<uring_receiver> rcv;
+    {
+        Xten::SpinLock::Lock lock(s_receivers_mutex);
+        auto it = s_receivers.find(fd);
+        if (it != s_receivers.end())
+        {
+            rcv = it->second;
+        }
+    }
+    Xten::FdCtx *fdctx = Xten::FdCtxMgr::GetInstance()->Get(fd, false);
+    if (!rcv)
+    {
+        // 第一次读取 符合条件才开启multishot recv
+        if (!Xten::is_hook_enable() || !can_arm || !fdctx || fdctx->IsClose() || !fdctx->IsSocket() ||
+            fdctx->GetUserNoBlock() || !fdctx->GetUringMultishotRecv())
+        {
+            return false;
+        }
+        Xten::SpinLock::Lock lock(s_receivers_mutex);
+        std::shared_ptr<uring_receiver> &slot = s_receivers[fd];
+        if (!slot)
+        {
+            slot = std::make_shared<uring_receiver>();
+            slot->uring = iom->GetUring();
+        }
+        rcv = slot;
+    }
+    // 不能挂起协程等待时按非阻塞处理
+    bool nonblock = (flags & MSG_DONTWAIT) || (fdctx && fdctx->GetUserNoBlock()) ||
+                    !Xten::is_hook_enable() || !iom;
+    bool waitall = (flags & MSG_WAITALL) && !(flags & MSG_PEEK) && !nonblock;
+    std::vector<struct iovec> rest;
+    size_t done = 0;
+    if (waitall)
+    {
+        rest.assign(iov, iov + iovcnt);
+    }
+    uint64_t timeout = fdctx ? fdctx->GetTimeOut(SO_RCVTIMEO) : (uint64_t)-1;
+    std::weak_ptr<uring_receiver> wkrcv(rcv);
+    while (true)
+    {
+        Xten::SpinLock::Lock lock(rcv->mutex);
+        if (!rcv->ready.empty())
+        {
+            rcv->timedout = false;
+            if (!waitall)
+            {
+                ret = uring_recv_consume(rcv.get(), iov, iovcnt, flags);
+                return true;
+            }
+            ssize_t n = uring_recv_consume(rcv.get(), rest.data(), rest.size(), flags);
+            if (n <= 0)
+            {
+                // 对端关闭或者出错 返回已读取的部分
+                ret = done > 0 ? (ssize_t)done : n;
+                return true;
+            }
+            done += n;
+            if (done == total)
+            {
+                ret = done;
+                return true;
+            }
+            uring_recv_advance(rest, n);
+            continue;
+        }
+        if (rcv->closed)
+        {
+            // fd已关闭 走原来的方式(返回EBADF)
+            return false;
+        }
+        if (rcv->timedout)
+        {
+            rcv->timedout = false;
+            if (done > 0)
+            {
+                ret = done;
+                return true;
+            }
+            errno = ETIMEDOUT;
+            ret = -1;
+            return true;
+        }
+        if (!rcv->armed)
+        {
+            if (rcv->nobufs || !can_arm)
+            {
+                // 请求不在内核中且没有缓存数据 直接读取不会乱序
+                // 缓冲区耗尽时内核中没有该fd的数据 这次直接读取 下次再提交请求
+                rcv->nobufs = false;
+                if (done > 0)
+                {
+                    ret = done;
+                    return true;
+                }
+                return false;
+            }
+            rcv->armed = true;
+            rcv->iom = iom;
+            rcv->self = rcv;
+            // 请求结束时收割线程会移走回调 每次提交重新设置
+            uring_receiver *raw = rcv.get();
+            rcv->req.cb = [raw](int res, uint32_t flags)
+            { uring_recv_complete(raw, res, flags); };
+            lock.unlock();
+            auto prep = [fd](io_uring_sqe *sqe)
+            {
+                uring_prep_rw(sqe, IORING_OP_RECV, fd, nullptr, 0, 0);
+                sqe->ioprio |= IORING_RECV_MULTISHOT;
+                sqe->flags |= IOSQE_BUFFER_SELECT;
+                sqe->buf_group = Xten::IoUring::RECV_BUF_GROUP;
+            };
+            if (!iom->UringSubmit(&rcv->req, [](io_uring_sqe *sqe, void *arg)
+                                  { (*(decltype(prep) *)arg)(sqe); },
+                                  &prep))
+            {
+                lock.lock();
+                rcv->armed = false;
+                rcv->self.reset();
+                if (rcv->ready.empty())
+                {
+                    if (done > 0)
+                    {
+                        ret = done;
+                        return true;
+                    }
+                    return false;
+                }
+            }
+            continue;
+        }
+        // 请求在内核中 数据会先进入接收器 不能直接读取
+        if (nonblock)
+        {
+            if (done > 0)
+            {
+                ret = done;
+                return true;
+            }
+            errno = EAGAIN;
+            ret = -1;
+            return true;
+        }
+        if (rcv->waiter)
+        {
+            // 已经有其他协程在等待 让出后重试
+            lock.unlock();
+            Xten::Fiber::YieldToReady();
+            continue;
+        }
+        // 等待数据
+        rcv->scheduler = Xten::Scheduler::GetThis();
+        rcv->waiter = Xten::Fiber::GetThis();
+        lock.unlock();
+        Xten::Timer::ptr timer;
+        if (timeout != (uint64_t)-1)
+        {
+            timer = iom->addTimer(timeout, [wkrcv]()
+                                  {
+                std::shared_ptr<uring_receiver> r=wkrcv.lock();
+                if(!r)
+                {
+                    return;
+                }
+                Xten::Scheduler *sche=nullptr;
+                Xten::Fiber::ptr fiber;
+                {
+                    Xten::SpinLock::Lock lock(r->mutex);
+                    if(!r->waiter)
+                    {
+                        //数据已经到达
+                        return;
+                    }
+                    r->timedout=true;
+                    sche=r->scheduler;
+                    fiber.swap(r->waiter);
+                    r->scheduler=nullptr;
+                }
+                sche->Schedule(std::move(fiber)); });
+        }
+        Xten::Fiber::YieldToHold();
+        if (timer)
+        {
+            timer->cancel();
+        }
+    }
+}
+
+/// @brief fd关闭 丢弃multishot recv状态并取消内核中的请求
+static void uring_recv_close(int fd)
+{
+    std::shared_ptr<uring_receiver> rcv;
+    {
+        Xten::SpinLock::Lock lock(s_receivers_mutex);
+        auto it = s_receivers.find(fd);
+        if (it == s_receivers.end())
+        {
+            return;
+        }
+        rcv = it->second;
+        s_receivers.erase(it);
+    }
+    Xten::Scheduler *sche = nullptr;
+    Xten::Fiber::ptr fiber;
+    Xten::IOManager *iom = nullptr;
+    {
+        Xten::SpinLock::Lock lock(rcv->mutex);
+        rcv->closed = true;
+        iom = rcv->armed ? rcv->iom : nullptr;
+        // 没有被取走的数据直接归还缓冲区
+        for (auto &i : rcv->ready)
+        {
+            if (i.first > 0)
+            {
+                rcv->uring->RecycleRecvBuffer(i.second);
+            }
+        }
+        rcv->ready.clear();
+        rcv->offset = 0;
+        rcv->ready.push_back(std::make_pair(-EBADF, (uint16_t)0));
+        sche = rcv->scheduler;
+        fiber.swap(rcv->waiter);
+        rcv->scheduler = nullptr;
+    }
+    // 同uring_accept_close
+    if (iom)
+    {
+        iom->UringCancel(&rcv->req);
+    }
+    if (fiber)
+    {
+        sche->Schedule(std::move(fiber));
+    }
+}
+
+namespace Xten
+{
+    bool uring_read_fixed(int fd, void *buf, size_t len, ssize_t &ret)
+    {
+        if (!is_hook_enable() || len == 0)
+        {
+            return false;
+        }
+        IOManager *iom = IOManager::GetThis();
+        if (!iom || !iom->IsUringEnabled() || !iom->GetUring()->GetFixedBufferSize())
+        {
+            return false;
+        }
+        FdCtx *fdctx = FdCtxMgr::GetInstance()->Get(fd, false);
+        if (!fdctx || fdctx->IsClose() || !fdctx->IsSocket() || fdctx->GetUserNoBlock() ||
+            fdctx->GetUringMultishotRecv())
+        {
+            return false;
+        }
+        // 先直接读取 数据已就绪时不需要提交请求
+        ssize_t n = read_f(fd, buf, len);
+        while (n == -1 && errno == EINTR)
+        {
+            n = read_f(fd, buf, len);
+        }
+        if (n >= 0 || errno != EAGAIN)
+        {
+            ret = n;
+            return true;
+        }
+        IoUring *uring = iom->GetUring();
+        int index = uring->GetFixedBuffer();
+        if (index < 0)
+        {
+            return false;
+        }
+        void *fixed = uring->GetFixedBufferAddr(index);
+        size_t size = std::min(len, uring->GetFixedBufferSize());
+        auto prep = URING_PREP({ uring_prep_rw(sqe, IORING_OP_READ_FIXED, fd, fixed, size, 0);
+                                 sqe->buf_index = index; });
+        std::shared_ptr<timer_condition> timecond = std::make_shared<timer_condition>();
+        bool ok = uring_wait(iom, prep, fdctx->GetTimeOut(SO_RCVTIMEO), timecond, ret);
+        if (ok && ret > 0)
+        {
+            memcpy(buf, fixed, ret);
+        }
+        uring->PutFixedBuffer(index);
+        return ok;
+    }
+    bool uring_write_fixed(int fd, const void *buf, size_t len, ssize_t &ret)
+    {
+        if (!is_hook_enable() || len == 0)
+        {
+            return false;
+        }
+        IOManager *iom = IOManager::GetThis();
+        if (!iom || !iom->IsUringEnabled() || !iom->GetUring()->GetFixedBufferSize())
+        {
+            return false;
+        }
+        FdCtx *fdctx = FdCtxMgr::GetInstance()->Get(fd, false);
+        if (!fdctx || fdctx->IsClose() || !fdctx->IsSocket() || fdctx->GetUserNoBlock())
+        {
+            return false;
+        }
+        // 先直接写 发送缓冲区有空间时不需要提交请求
+        ssize_t n = write_f(fd, buf, len);
+        while (n == -1 && errno == EINTR)
+        {
+            n = write_f(fd, buf, len);
+        }
+        if (n >= 0 || errno != EAGAIN)
+        {
+            ret = n;
+            return true;
+        }
+        IoUring *uring = iom->GetUring();
+        int index = uring->GetFixedBuffer();
+        if (index < 0)
+        {
+            return false;
+        }
+        void *fixed = uring->GetFixedBufferAddr(index);
+        size_t size = std::min(len, uring->GetFixedBufferSize());
+        memcpy(fixed, buf, size);
+        auto prep = URING_PREP({ uring_prep_rw(sqe, IORING_OP_WRITE_FIXED, fd, fixed, size, 0);
+                                 sqe->buf_index = index; });
+        std::shared_ptr<timer_condition> timecond = std::make_shared<timer_condition>();
+        bool ok = uring_wait(iom, prep, fdctx->GetTimeOut(SO_SNDTIMEO), timecond, ret);
+        uring->PutFixedBuffer(index);
+        return ok;
+    }
+}
+#endif
+
 extern "C"
 {
 #define XX(name) name##_fun name##_f = nullptr;
@@ -211,8 +1003,8 @@ extern "C"
         }
         Xten::IOManager *iom = Xten::IOManager::GetThis();
         Xten::Fiber::ptr fiber = Xten::Fiber::GetThis();
-        iom->addTimer(usec / 1000, [iom, fiber]()
-                      { iom->Schedule(fiber, -1); });
+        iom->addTimerUs(usec, [iom, fiber]()
+                        { iom->Schedule(fiber, -1); });
         Xten::Fiber::YieldToHold();
         return 0;
     }
@@ -223,11 +1015,11 @@ extern "C"
         {
             return nanosleep_f(req, rem);
         }
-        int timeout_ms = req->tv_sec * 1000 + req->tv_nsec / 1000 / 1000;
+        uint64_t timeout_us = req->tv_sec * 1000000ull + req->tv_nsec / 1000;
         Xten::IOManager *iom = Xten::IOManager::GetThis();
         Xten::Fiber::ptr fiber = Xten::Fiber::GetThis();
-        iom->addTimer(timeout_ms, [iom, fiber]()
-                      { iom->Schedule(fiber, -1); });
+        iom->addTimerUs(timeout_us, [iom, fiber]()
+                        { iom->Schedule(fiber, -1); });
         Xten::Fiber::YieldToHold();
         return 0;
     }
@@ -247,7 +1039,21 @@ extern "C"
     }
     int accept(int sockfd, struct sockaddr *addr, socklen_t *addrlen)
     {
-        int ret = do_io(sockfd, accept_f, "accept", Xten::IOManager::Event::READ, SO_RCVTIMEO, addr, addrlen);
+        int ret = -1;
+#ifdef XTEN_IO_URING
+        // 阻塞且不超时的accept使用常驻的multishot accept
+        if (uring_accept(sockfd, addr, addrlen, ret))
+        {
+            if (ret >= 0)
+            {
+                Xten::FdCtxMgr::GetInstance()->Get(ret, true);
+            }
+            return ret;
+        }
+#endif
+        ret = do_io(sockfd, accept_f, "accept", Xten::IOManager::Event::READ, SO_RCVTIMEO, URING_PREP(
+                        { uring_prep_rw(sqe, IORING_OP_ACCEPT, sockfd, addr, 0, (uint64_t)(uintptr_t)addrlen); }),
+                    addr, addrlen);
         if (ret >= 0)
         {
             // 接收成功---在框架层面管理这个accept返回的socketfd
@@ -264,7 +1070,7 @@ extern "C"
             setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, len);
             return connect_f(fd, addr, addrlen);
         }
-        Xten::FdCtx::ptr fdctx = Xten::FdCtxMgr::GetInstance()->Get(fd);
+        Xten::FdCtx *fdctx = Xten::FdCtxMgr::GetInstance()->Get(fd);
         if (!fdctx || fdctx->IsClose())
         {
             errno = EBADF;
@@ -275,6 +1081,20 @@ extern "C"
             return connect_f(fd, addr, addrlen);
         }
         // 是socket且是阻塞connect
+#ifdef XTEN_IO_URING
+        Xten::IOManager *uiom = Xten::IOManager::GetThis();
+        if (uiom->IsUringEnabled())
+        {
+            // 连接过程完全交给内核 完成后唤醒
+            std::shared_ptr<timer_condition> tmcond = std::make_shared<timer_condition>();
+            auto prep = URING_PREP({ uring_prep_rw(sqe, IORING_OP_CONNECT, fd, addr, 0, addrlen); });
+            ssize_t ret = -1;
+            if (uring_wait(uiom, prep, timeout_ms, tmcond, ret))
+            {
+                return (int)ret;
+            }
+        }
+#endif
         // 尝试连接
         int ret = connect_f(fd, addr, addrlen);
         while (ret == -1 && errno == EINTR)
@@ -356,65 +1176,134 @@ extern "C"
     // read
     ssize_t read(int fd, void *buf, size_t count)
     {
-        return do_io(fd, read_f, "read", Xten::IOManager::Event::READ, SO_RCVTIMEO, buf, count);
+#ifdef XTEN_IO_URING
+        ssize_t ret = -1;
+        struct iovec iov = {buf, count};
+        if (uring_recv(fd, &iov, 1, 0, ret))
+        {
+            return ret;
+        }
+#endif
+        return do_io(fd, read_f, "read", Xten::IOManager::Event::READ, SO_RCVTIMEO, URING_PREP(
+                         { uring_prep_rw(sqe, IORING_OP_RECV, fd, buf, count, 0); }),
+                     buf, count);
     }
 
     ssize_t readv(int fd, const struct iovec *iov, int iovcnt)
     {
-        return do_io(fd, readv_f, "readv", Xten::IOManager::Event::READ, SO_RCVTIMEO, iov, iovcnt);
+#ifdef XTEN_IO_URING
+        ssize_t ret = -1;
+        if (uring_recv(fd, iov, iovcnt, 0, ret))
+        {
+            return ret;
+        }
+#endif
+        struct msghdr msg;
+        memset(&msg, 0, sizeof msg);
+        msg.msg_iov = (struct iovec *)iov;
+        msg.msg_iovlen = iovcnt;
+        return do_io(fd, readv_f, "readv", Xten::IOManager::Event::READ, SO_RCVTIMEO, URING_PREP(
+                         { uring_prep_rw(sqe, IORING_OP_RECVMSG, fd, &msg, 1, 0); }),
+                     iov, iovcnt);
     }
 
     ssize_t recv(int sockfd, void *buf, size_t len, int flags)
     {
-        return do_io(sockfd, recv_f, "recv", Xten::IOManager::Event::READ, SO_RCVTIMEO, buf, len, flags);
+#ifdef XTEN_IO_URING
+        ssize_t ret = -1;
+        struct iovec iov = {buf, len};
+        if (uring_recv(sockfd, &iov, 1, flags, ret))
+        {
+            return ret;
+        }
+#endif
+        return do_io(sockfd, recv_f, "recv", Xten::IOManager::Event::READ, SO_RCVTIMEO, URING_PREP(
+                         { uring_prep_rw(sqe, IORING_OP_RECV, sockfd, buf, len, 0);
+                           sqe->msg_flags = flags; }),
+                     buf, len, flags);
     }
 
     ssize_t recvfrom(int sockfd, void *buf, size_t len, int flags, struct sockaddr *src_addr, socklen_t *addrlen)
     {
-        return do_io(sockfd, recvfrom_f, "recvfrom", Xten::IOManager::Event::READ, SO_RCVTIMEO, buf, len, flags, src_addr, addrlen);
+        return do_io(sockfd, recvfrom_f, "recvfrom", Xten::IOManager::Event::READ, SO_RCVTIMEO, nullptr, buf, len, flags, src_addr, addrlen);
     }
 
     ssize_t recvmsg(int sockfd, struct msghdr *msg, int flags)
     {
-        return do_io(sockfd, recvmsg_f, "recvmsg", Xten::IOManager::Event::READ, SO_RCVTIMEO, msg, flags);
+#ifdef XTEN_IO_URING
+        ssize_t ret = -1;
+        if (uring_recv(sockfd, msg->msg_iov, msg->msg_iovlen, flags, ret))
+        {
+            // 连接的流式socket没有地址 辅助数据不经过multishot recv
+            msg->msg_namelen = 0;
+            msg->msg_controllen = 0;
+            msg->msg_flags = 0;
+            return ret;
+        }
+#endif
+        return do_io(sockfd, recvmsg_f, "recvmsg", Xten::IOManager::Event::READ, SO_RCVTIMEO, URING_PREP(
+                         { uring_prep_rw(sqe, IORING_OP_RECVMSG, sockfd, msg, 1, 0);
+                           sqe->msg_flags = flags; }),
+                     msg, flags);
     }
     int recvmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen,
                  int flags, struct timespec *timeout)
     {
-        return do_io(sockfd, recvmmsg_f, "recvmmsg", Xten::IOManager::Event::READ, SO_RCVTIMEO, msgvec, vlen, flags, timeout);
+        return do_io(sockfd, recvmmsg_f, "recvmmsg", Xten::IOManager::Event::READ, SO_RCVTIMEO, nullptr, msgvec, vlen, flags, timeout);
     }
     // write
     ssize_t write(int fd, const void *buf, size_t count)
     {
-        return do_io(fd, write_f, "write", Xten::IOManager::Event::WRITE, SO_SNDTIMEO, buf, count);
+        return do_io(fd, write_f, "write", Xten::IOManager::Event::WRITE, SO_SNDTIMEO, URING_PREP(
+                         { uring_prep_rw(sqe, IORING_OP_SEND, fd, buf, count, 0); }),
+                     buf, count);
     }
 
     ssize_t writev(int fd, const struct iovec *iov, int iovcnt)
     {
-        return do_io(fd, writev_f, "writev", Xten::IOManager::Event::WRITE, SO_SNDTIMEO, iov, iovcnt);
+        struct msghdr msg;
+        memset(&msg, 0, sizeof msg);
+        msg.msg_iov = (struct iovec *)iov;
+        msg.msg_iovlen = iovcnt;
+        return do_io(fd, writev_f, "writev", Xten::IOManager::Event::WRITE, SO_SNDTIMEO, URING_PREP(
+                         { uring_prep_rw(sqe, IORING_OP_SENDMSG, fd, &msg, 1, 0); }),
+                     iov, iovcnt);
     }
 
     ssize_t send(int s, const void *msg, size_t len, int flags)
     {
-        return do_io(s, send_f, "send", Xten::IOManager::Event::WRITE, SO_SNDTIMEO, msg, len, flags);
+        return do_io(s, send_f, "send", Xten::IOManager::Event::WRITE, SO_SNDTIMEO, URING_PREP(
+                         { uring_prep_rw(sqe, IORING_OP_SEND, s, msg, len, 0);
+                           sqe->msg_flags = flags; }),
+                     msg, len, flags);
     }
 
     ssize_t sendto(int s, const void *msg, size_t len, int flags, const struct sockaddr *to, socklen_t tolen)
     {
-        return do_io(s, sendto_f, "sendto", Xten::IOManager::Event::WRITE, SO_SNDTIMEO, msg, len, flags, to, tolen);
+        return do_io(s, sendto_f, "sendto", Xten::IOManager::Event::WRITE, SO_SNDTIMEO, nullptr, msg, len, flags, to, tolen);
     }
 
     ssize_t sendmsg(int s, const struct msghdr *msg, int flags)
     {
-        return do_io(s, sendmsg_f, "sendmsg", Xten::IOManager::Event::WRITE, SO_SNDTIMEO, msg, flags);
+        return do_io(s, sendmsg_f, "sendmsg", Xten::IOManager::Event::WRITE, SO_SNDTIMEO, URING_PREP(
+                         { uring_prep_rw(sqe, IORING_OP_SENDMSG, s, msg, 1, 0);
+                           sqe->msg_flags = flags; }),
+                     msg, flags);
     }
     int close(int fd)
     {
+#ifdef XTEN_IO_URING
+        // 内核中的multishot请求持有文件引用 不论当前线程是否hook都要取消 否则fd关闭后监听/连接依然存在
+        uring_accept_close(fd);
+        uring_recv_close(fd);
+#endif
         if (!Xten::is_hook_enable())
         {
+            // 非hook线程关闭也要标记 fd复用时各调度器据此重新注册epoll
+            Xten::FdCtxMgr::GetInstance()->Del(fd);
             return close_f(fd);
         }
-        Xten::FdCtx::ptr fdctx = Xten::FdCtxMgr::GetInstance()->Get(fd);
+        Xten::FdCtx *fdctx = Xten::FdCtxMgr::GetInstance()->Get(fd);
         if (fdctx)
         {
             Xten::IOManager *iom = Xten::IOManager::GetThis();
@@ -439,7 +1328,7 @@ extern "C"
         {
             int arg = va_arg(va, int);
             va_end(va);
-            Xten::FdCtx::ptr ctx = Xten::FdCtxMgr::GetInstance()->Get(fd);
+            Xten::FdCtx *ctx = Xten::FdCtxMgr::GetInstance()->Get(fd);
             if (!ctx || ctx->IsClose() || !ctx->IsSocket())
             {
                 return fcntl_f(fd, cmd, arg);
@@ -460,7 +1349,7 @@ extern "C"
         {
             va_end(va);
             int arg = fcntl_f(fd, cmd);
-            Xten::FdCtx::ptr ctx = Xten::FdCtxMgr::GetInstance()->Get(fd);
+            Xten::FdCtx *ctx = Xten::FdCtxMgr::GetInstance()->Get(fd);
             if (!ctx || ctx->IsClose() || !ctx->IsSocket())
             {
                 return arg;
@@ -536,7 +1425,7 @@ extern "C"
         if (FIONBIO == request)
         {
             bool user_nonblock = !!*(int *)arg;
-            Xten::FdCtx::ptr ctx = Xten::FdCtxMgr::GetInstance()->Get(d);
+            Xten::FdCtx *ctx = Xten::FdCtxMgr::GetInstance()->Get(d);
             if (!ctx || ctx->IsClose() || !ctx->IsSocket())
             {
                 return ioctl_f(d, request, arg);
@@ -560,7 +1449,7 @@ extern "C"
         {
             if (optname == SO_SNDTIMEO || optname == SO_RCVTIMEO)
             {
-                Xten::FdCtx::ptr fdctx = Xten::FdCtxMgr::GetInstance()->Get(sockfd);
+                Xten::FdCtx *fdctx = Xten::FdCtxMgr::GetInstance()->Get(sockfd);
                 if (fdctx)
                 {
                     // 在框架层面设置超时时间
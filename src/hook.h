@@ -23,6 +23,12 @@ namespace Xten
     bool is_hook_enable();
     // 设置当前线程接口是否hook
     void set_hook_enable(bool ishook);
+#ifdef XTEN_IO_URING
+    // 经io_uring固定缓冲区读取(READ_FIXED) 不适用返回false 由调用者走普通读取
+    bool uring_read_fixed(int fd, void *buf, size_t len, ssize_t &ret);
+    // 经io_uring固定缓冲区写入(WRITE_FIXED) 一次最多写入一个固定缓冲区大小
+    bool uring_write_fixed(int fd, const void *buf, size_t len, ssize_t &ret);
+#endif
 }
 // 防止c++函数名修饰
 // 声明原始函数指针--当外部想使用原始接口时 供外部直接使用
@@ -1,5 +1,6 @@
 #include "http.h"
 #include"util.h"
+#include "objpool.h"
 #include<unicode/unistr.h>
 namespace Xten
 {
@@ -60,20 +61,50 @@ namespace Xten
             }
         }
 
-        bool CaseInsensitiveLess::operator()(const std::string &lhs, const std::string &rhs) const
+        bool CaseInsensitiveLess::operator()(std::string_view lhs, std::string_view rhs) const
         {
-            return strcasecmp(lhs.c_str(), rhs.c_str()) < 0;
+            int ret = strncasecmp(lhs.data(), rhs.data(), std::min(lhs.size(), rhs.size()));
+            return ret != 0 ? ret < 0 : lhs.size() < rhs.size();
         }
 
-        HttpRequest::HttpRequest(uint8_t version, bool close)
-            : m_method(HttpMethod::GET), m_version(version), m_close(close), m_websocket(false), m_parserParamFlag(0), m_streamId(0), m_path("/")
+        // MAP使用的内存资源
+        static std::pmr::memory_resource *MapResource(const Arena::ptr &arena)
+        {
+            return arena ? (std::pmr::memory_resource *)arena.get() : std::pmr::get_default_resource();
+        }
+        // 设置MAP中key的值 key/value在MAP的内存资源中构造
+        static void SetMapValue(HttpRequest::MapType &m, std::string_view key, std::string_view val)
+        {
+            auto it = m.find(key);
+            if (it != m.end())
+            {
+                it->second = val;
+            }
+            else
+            {
+                m.emplace(key, val);
+            }
+        }
+        // 删除MAP中的key
+        static void DelMapValue(HttpRequest::MapType &m, std::string_view key)
+        {
+            auto it = m.find(key);
+            if (it != m.end())
+            {
+                m.erase(it);
+            }
+        }
+
+        HttpRequest::HttpRequest(uint8_t version, bool close, Arena::ptr arena)
+            : m_method(HttpMethod::GET), m_version(version), m_close(close), m_websocket(false), m_parserParamFlag(0), m_streamId(0), m_path("/"),
+              m_arena(arena), m_headers(MapResource(arena)), m_params(MapResource(arena)), m_cookies(MapResource(arena))
         {
         }
 
         std::string HttpRequest::getHeader(const std::string &key, const std::string &def) const
         {
             auto it = m_headers.find(key);
-            return it == m_headers.end() ? def : it->second;
+            return it == m_headers.end() ? def : std::string(it->second);
         }
 
         void HttpRequest::setUri(const std::string &uri)
@@ -117,7 +148,7 @@ namespace Xten
 
         std::shared_ptr<HttpResponse> HttpRequest::createResponse()
         {
-            return std::make_shared<HttpResponse>(getVersion(), isClose());
+            return ObjPoolMakeShared<HttpResponse>(getVersion(), isClose(), m_arena);
         }
 
         std::string HttpRequest::getParam(const std::string &key, const std::string &def)
@@ -125,44 +156,44 @@ namespace Xten
             initQueryParam();
             initBodyParam();
             auto it = m_params.find(key);
-            return it == m_params.end() ? def : it->second;
+            return it == m_params.end() ? def : std::string(it->second);
         }
 
         std::string HttpRequest::getCookie(const std::string &key, const std::string &def)
         {
             initCookies();
             auto it = m_cookies.find(key);
-            return it == m_cookies.end() ? def : it->second;
+            return it == m_cookies.end() ? def : std::string(it->second);
         }
 
-        void HttpRequest::setHeader(const std::string &key, const std::string &val)
+        void HttpRequest::setHeader(std::string_view key, std::string_view val)
         {
-            m_headers[key] = val;
+            SetMapValue(m_headers, key, val);
         }
 
-        void HttpRequest::setParam(const std::string &key, const std::string &val)
+        void HttpRequest::setParam(std::string_view key, std::string_view val)
         {
-            m_params[key] = val;
+            SetMapValue(m_params, key, val);
         }
 
-        void HttpRequest::setCookie(const std::string &key, const std::string &val)
+        void HttpRequest::setCookie(std::string_view key, std::string_view val)
         {
-            m_cookies[key] = val;
+            SetMapValue(m_cookies, key, val);
         }
 
         void HttpRequest::delHeader(const std::string &key)
         {
-            m_headers.erase(key);
+            DelMapValue(m_headers, key);
         }
 
         void HttpRequest::delParam(const std::string &key)
         {
-            m_params.erase(key);
+            DelMapValue(m_params, key);
         }
 
         void HttpRequest::delCookie(const std::string &key)
         {
-            m_cookies.erase(key);
+            DelMapValue(m_cookies, key);
         }
 
         bool HttpRequest::hasHeader(const std::string &key, std::string *val)
@@ -315,8 +346,8 @@ namespace Xten
         }                                                                                           \
         size_t key = pos;                                                                           \
         pos = str.find(flag, pos);                                                                  \
-        m.insert(std::make_pair(trim(str.substr(last, key - last)),                                 \
-                                Xten::StringUtil::UrlDecode(str.substr(key + 1, pos - key - 1)))); \
+        m.emplace(trim(str.substr(last, key - last)),                                               \
+                  Xten::StringUtil::UrlDecode(str.substr(key + 1, pos - key - 1)));                \
         if (pos == std::string::npos)                                                               \
         {                                                                                           \
             break;                                                                                  \
@@ -368,8 +399,9 @@ namespace Xten
              m_query = Xten::MapJoin(m_params.begin(), m_params.end());
         }
 
-        HttpResponse::HttpResponse(uint8_t version, bool close)
-            : m_status(HttpStatus::OK), m_version(version), m_close(close), m_websocket(false)
+        HttpResponse::HttpResponse(uint8_t version, bool close, Arena::ptr arena)
+            : m_status(HttpStatus::OK), m_version(version), m_close(close), m_websocket(false),
+              m_arena(arena), m_headers(MapResource(arena))
         {
         }
 
@@ -392,17 +424,17 @@ namespace Xten
         std::string HttpResponse::getHeader(const std::string &key, const std::string &def) const
         {
             auto it = m_headers.find(key);
-            return it == m_headers.end() ? def : it->second;
+            return it == m_headers.end() ? def : std::string(it->second);
         }
 
-        void HttpResponse::setHeader(const std::string &key, const std::string &val)
+        void HttpResponse::setHeader(std::string_view key, std::string_view val)
         {
-            m_headers[key] = val;
+            SetMapValue(m_headers, key, val);
         }
 
         void HttpResponse::delHeader(const std::string &key)
         {
-            m_headers.erase(key);
+            DelMapValue(m_headers, key);
         }
 
         void HttpResponse::setRedirect(const std::string &uri)
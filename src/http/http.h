@@ -4,10 +4,13 @@
 #include <memory>
 #include <string>
 #include <map>
+#include <string_view>
+#include <memory_resource>
 #include <vector>
 #include <iostream>
 #include <sstream>
 #include <boost/lexical_cast.hpp>
+#include "../arena.h"
 
 //-----------------------------http请求-------------------------------------
 // POST /api/user?id=123#info HTTP/1.1
@@ -202,10 +205,12 @@ namespace Xten
          */
         struct CaseInsensitiveLess
         {
+            /// 支持不构造key直接查找
+            typedef void is_transparent;
             /**
              * @brief 忽略大小写比较字符串
              */
-            bool operator()(const std::string &lhs, const std::string &rhs) const;
+            bool operator()(std::string_view lhs, std::string_view rhs) const;
         };
 
         /**
@@ -273,14 +278,15 @@ namespace Xten
         public:
             /// HTTP请求的智能指针
             typedef std::shared_ptr<HttpRequest> ptr;
-            /// MAP结构
-            typedef std::map<std::string, std::string, CaseInsensitiveLess> MapType;
+            /// MAP结构(结点和字符串从请求的内存池分配 没有内存池时使用默认内存资源)
+            typedef std::pmr::map<std::pmr::string, std::pmr::string, CaseInsensitiveLess> MapType;
             /**
              * @brief 构造函数
              * @param[in] version 版本
              * @param[in] close 是否keepalive
+             * @param[in] arena 请求级内存池(头部/参数/cookie MAP使用 为空使用默认内存资源)
              */
-            HttpRequest(uint8_t version = 0x11, bool close = true);
+            HttpRequest(uint8_t version = 0x11, bool close = true, Arena::ptr arena = nullptr);
             // 创建请求对应的响应【版本+是否长连接对应】
             std::shared_ptr<HttpResponse> createResponse();
             // path?query#fragment
@@ -389,6 +395,11 @@ namespace Xten
 
             // 这个streamid用在http2协议中
             uint32_t getStreamId() const { return m_streamId; }
+
+            /**
+             * @brief 返回请求级内存池(可能为空) 处理请求时的临时对象可以从中分配
+             */
+            const Arena::ptr &getArena() const { return m_arena; }
             void setStreamId(uint32_t v) { m_streamId = v; }
 
             /**
@@ -438,7 +449,7 @@ namespace Xten
              * @param[in] key 关键字
              * @param[in] val 值
              */
-            void setHeader(const std::string &key, const std::string &val);
+            void setHeader(std::string_view key, std::string_view val);
 
             /**
              * @brief 设置HTTP请求的请求参数
@@ -446,13 +457,13 @@ namespace Xten
              * @param[in] val 值
              */
 
-            void setParam(const std::string &key, const std::string &val);
+            void setParam(std::string_view key, std::string_view val);
             /**
              * @brief 设置HTTP请求的Cookie参数
              * @param[in] key 关键字
              * @param[in] val 值
              */
-            void setCookie(const std::string &key, const std::string &val);
+            void setCookie(std::string_view key, std::string_view val);
 
             /**
              * @brief 删除HTTP请求的头部参数
@@ -627,6 +638,8 @@ namespace Xten
             std::string m_fragment;
             /// 请求消息体
             std::string m_body;
+            /// 请求级内存池(保证MAP使用期间存活)
+            Arena::ptr m_arena;
             /// 请求头部MAP
             MapType m_headers;
             /// 请求参数MAP
@@ -643,14 +656,15 @@ namespace Xten
         public:
             /// HTTP响应结构智能指针
             typedef std::shared_ptr<HttpResponse> ptr;
-            /// MapType
-            typedef std::map<std::string, std::string, CaseInsensitiveLess> MapType;
+            /// MapType(结点和字符串从请求的内存池分配 没有内存池时使用默认内存资源)
+            typedef std::pmr::map<std::pmr::string, std::pmr::string, CaseInsensitiveLess> MapType;
             /**
              * @brief 构造函数
              * @param[in] version 版本
              * @param[in] close 是否自动关闭
+             * @param[in] arena 请求级内存池(头部MAP使用 为空使用默认内存资源)
              */
-            HttpResponse(uint8_t version = 0x11, bool close = true);
+            HttpResponse(uint8_t version = 0x11, bool close = true, Arena::ptr arena = nullptr);
 
             /**
              * @brief 返回响应状态
@@ -744,7 +758,7 @@ namespace Xten
              * @param[in] key 关键字
              * @param[in] val 值
              */
-            void setHeader(const std::string &key, const std::string &val);
+            void setHeader(std::string_view key, std::string_view val);
 
             /**
              * @brief 删除响应头部参数
@@ -820,6 +834,8 @@ namespace Xten
             std::string m_body;
             /// 响应原因
             std::string m_reason;
+            /// 请求级内存池(保证MAP使用期间存活)
+            Arena::ptr m_arena;
             /// 响应头部MAP
             MapType m_headers;
             //服务端cookie可以设置多组
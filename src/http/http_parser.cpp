@@ -1,6 +1,7 @@
 #include "http/http_parser.h"
 #include "log.h"
 #include "config.h"
+#include "objpool.h"
 namespace Xten
 {
     namespace http
@@ -125,12 +126,12 @@ namespace Xten
                 // parser->setError(1002);
                 return;
             }
-            parser->GetRequest()->setHeader(std::string(field, flen), std::string(value, vlen));
+            parser->GetRequest()->setHeader(std::string_view(field, flen), std::string_view(value, vlen));
         }
-        HttpRequestParser::HttpRequestParser()
+        HttpRequestParser::HttpRequestParser(Arena::ptr arena)
             : _errno(0)
         {
-            _request = std::make_shared<HttpRequest>();
+            _request = ObjPoolMakeShared<HttpRequest>(0x11, true, arena);
             http_parser_init(&_parser);
             _parser.request_uri = on_request_uri;
             _parser.request_path = on_request_path;
@@ -218,12 +219,12 @@ namespace Xten
                 // parser->setError(1002);
                 return;
             }
-            parser->GetResponse()->setHeader(std::string(field, flen), std::string(value, vlen));
+            parser->GetResponse()->setHeader(std::string_view(field, flen), std::string_view(value, vlen));
         }
         HttpResponseParser::HttpResponseParser()
             : _errno(0)
         {
-            _response = std::make_shared<HttpResponse>();
+            _response = ObjPoolMakeShared<HttpResponse>();
             httpclient_parser_init(&_parser);
             _parser.data = (void *)this;
             _parser.reason_phrase = on_response_reason;
@@ -12,7 +12,8 @@ namespace Xten
         {
         public:
             typedef std::shared_ptr<HttpRequestParser> ptr;
-            HttpRequestParser();
+            // arena: 请求级内存池 解析出的请求从中分配头部MAP
+            HttpRequestParser(Arena::ptr arena = nullptr);
             // 开始解析(返回值是本次解析长度)
             size_t Execute(char *data, size_t len,size_t std_len);
             // 判断是否解析完成
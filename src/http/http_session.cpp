@@ -1,4 +1,5 @@
 #include "http_session.h"
+#include "../objpool.h"
 namespace Xten
 {
     namespace http
@@ -31,12 +32,22 @@ namespace Xten
         // 接受一个完整http请求并生成http请求结构体
         HttpRequest::ptr HttpSession::RecvRequest()
         {
-            // 创建解析请求结构
-            HttpRequestParser::ptr parser = std::make_shared<HttpRequestParser>();
             uint32_t buffer_size = HttpRequestParser::GetHttpReqMaxBufferSize();
-            std::shared_ptr<char> buffer = std::shared_ptr<char>(new char[buffer_size], [](char *ptr)
-                                                                 { delete[] ptr; });
-            char *data = buffer.get();
+            // 请求级内存池: 上一个请求的请求/响应都已释放则整体回收复用 否则(仍被业务持有)新建一个
+            // 块大小取两倍读缓冲区加余量: 读缓冲区不超过半块 落在Reset保留的第一块中 不会每个请求重新申请
+            size_t block_size = 2 * (size_t)buffer_size + 4 * 1024;
+            if (!_arena || _arena.use_count() > 1 || _arena->GetBlockSize() < block_size)
+            {
+                _arena = std::make_shared<Arena>(block_size);
+            }
+            else
+            {
+                _arena->Reset();
+            }
+            // 创建解析请求结构
+            HttpRequestParser::ptr parser = ObjPoolMakeShared<HttpRequestParser>(_arena);
+            // 读缓冲区也从内存池分配 随请求一起回收
+            char *data = (char *)_arena->allocate(buffer_size);
             uint32_t offset = 0;
             // 解析http请求头
             do
@@ -17,6 +17,9 @@ namespace Xten
             HttpRequest::ptr RecvRequest();
             // 发送一个完整http响应(ret<0失败)
             int SendResponse(HttpResponse::ptr response);
+
+        private:
+            Arena::ptr _arena; // 请求级内存池(上一个请求的请求/响应都释放后复用)
         };
     }
 }
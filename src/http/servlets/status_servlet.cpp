@@ -1,5 +1,6 @@
 #include "status_servlet.h"
 #include "../../Xten.h"
+#include "../../objpool.h"
 #include <iomanip>
 #include <ios>
 #ifndef FIBER_TYPE
@@ -113,6 +114,9 @@ namespace Xten
             ss << "<<Worker>>" << std::endl;
             WorkerManager::GetInstance()->dump(ss) << std::endl;
             ss << "======================================================" << std::endl;
+            ss << "<<ObjPool>>" << std::endl;
+            ss << FiberObjPoolInfo();
+            ss << "======================================================" << std::endl;
 
             std::unordered_map<std::string, std::vector<TcpServer::ptr>> servers;
             Application::GetInstance()->GetAllServers(servers);
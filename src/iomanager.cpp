@@ -2,11 +2,204 @@
 #include <sys/epoll.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
 #include "log.h"
 #include "macro.h"
+#include "config.h"
+#include "util.h"
+#include "fdmanager.h"
 namespace Xten
 {
     static Xten::Logger::ptr g_logger = XTEN_LOG_NAME("system");
+    // 每个线程独立epoll实例(reactor-per-core) 默认所有线程共享一个epoll
+    static Xten::ConfigVar<bool>::ptr g_iomanager_per_thread_epoll =
+        Xten::Config::LookUp("iomanager.per_thread_epoll", false, "iomanager every thread owns an epoll instance");
+    // fd第一次等待时以EPOLLIN|EPOLLOUT|EPOLLET常驻注册 之后的等待/唤醒不再调用epoll_ctl
+    static Xten::ConfigVar<bool>::ptr g_iomanager_persistent_epoll =
+        Xten::Config::LookUp("iomanager.persistent_epoll", false, "iomanager register fd to epoll once with EPOLLIN|EPOLLOUT|EPOLLET");
+    // 定时器使用多层时间轮(O(1)添加/取消) 默认红黑树
+    static Xten::ConfigVar<bool>::ptr g_iomanager_timer_wheel =
+        Xten::Config::LookUp("iomanager.timer_wheel", false, "iomanager use hierarchical timing wheel as timer manager");
+    // 定时器微秒精度: idle使用epoll_pwait2等待(内核不支持时退回毫秒精度的epoll_wait)
+    static Xten::ConfigVar<bool>::ptr g_iomanager_timer_high_resolution =
+        Xten::Config::LookUp("iomanager.timer_high_resolution", false, "iomanager wait timers with microsecond resolution(epoll_pwait2)");
+    // 定时器按工作线程分片 每个线程只过期自己添加的定时器 其他线程添加的经无锁队列移交
+    static Xten::ConfigVar<bool>::ptr g_iomanager_timer_shard =
+        Xten::Config::LookUp("iomanager.timer_shard", false, "iomanager shard timers per worker thread");
+#ifdef XTEN_IO_URING
+    // 使用io_uring后端(hook的socket读写/accept/connect直接提交sqe) 内核不支持时回退epoll
+    static Xten::ConfigVar<bool>::ptr g_iomanager_io_uring =
+        Xten::Config::LookUp("iomanager.io_uring", false, "iomanager use io_uring backend for hooked socket io");
+    static Xten::ConfigVar<uint32_t>::ptr g_iomanager_io_uring_entries =
+        Xten::Config::LookUp("iomanager.io_uring_entries", (uint32_t)4096, "iomanager io_uring submission queue entries");
+    static Xten::ConfigVar<uint32_t>::ptr g_iomanager_io_uring_fixed_buffers =
+        Xten::Config::LookUp("iomanager.io_uring_fixed_buffers", (uint32_t)256, "iomanager io_uring registered buffer count(0 disable)");
+    static Xten::ConfigVar<uint32_t>::ptr g_iomanager_io_uring_fixed_buffer_size =
+        Xten::Config::LookUp("iomanager.io_uring_fixed_buffer_size", (uint32_t)16384, "iomanager io_uring registered buffer size");
+    static Xten::ConfigVar<uint32_t>::ptr g_iomanager_io_uring_recv_buffers =
+        Xten::Config::LookUp("iomanager.io_uring_recv_buffers", (uint32_t)1024, "iomanager io_uring multishot recv buffer count(power of 2, 0 disable)");
+    static Xten::ConfigVar<uint32_t>::ptr g_iomanager_io_uring_recv_buffer_size =
+        Xten::Config::LookUp("iomanager.io_uring_recv_buffer_size", (uint32_t)4096, "iomanager io_uring multishot recv buffer size");
+#endif
+    static thread_local IOManager *t_reactor_iom = nullptr; // 当前线程reactor所属的IOManager
+
+    /// @brief 等待epoll事件 超时时间单位微秒
+    /// 高精度模式使用epoll_pwait2(timespec超时) 否则向上取整到毫秒使用epoll_wait
+    static int epollWait(int epfd, struct epoll_event *events, int max_events, uint64_t timeout_us, bool high_res)
+    {
+#ifdef SYS_epoll_pwait2
+        static std::atomic<bool> s_pwait2_unsupported = {false};
+        if (high_res && !s_pwait2_unsupported.load(std::memory_order_relaxed))
+        {
+            struct timespec ts;
+            ts.tv_sec = timeout_us / 1000000;
+            ts.tv_nsec = (timeout_us % 1000000) * 1000;
+            int ret = syscall(SYS_epoll_pwait2, epfd, events, max_events, &ts, nullptr, 0);
+            if (ret != -1 || errno != ENOSYS)
+            {
+                return ret;
+            }
+            s_pwait2_unsupported = true;
+            XTEN_LOG_WARN(g_logger) << "epoll_pwait2 not supported, timer resolution falls back to millisecond";
+        }
+#endif
+        return epoll_wait(epfd, events, max_events, (int)((timeout_us + 999) / 1000));
+    }
+
+    /// @brief 每线程的io超时时间轮 按fd记录 等待结束不删除记录(惰性取消 到期时检查)
+    /// 每个(fd,事件)最多只有一条有效记录 记录存放在槽的vector中 复用内存 等待时不申请堆内存
+    struct IoDeadlineWheel
+    {
+        static const size_t SLOTS = 512;   // 槽数
+        static const uint64_t TICK_MS = 10; // 每个槽的时间跨度
+        struct Entry
+        {
+            IOManager *iom;
+            int fd;
+            IOManager::Event event;
+            uint64_t deadline;
+        };
+        // 添加超时记录
+        void Add(const Entry &entry, uint64_t now)
+        {
+            if (count == 0)
+            {
+                tick = now / TICK_MS;
+            }
+            uint64_t t = std::max(entry.deadline / TICK_MS, tick);
+            slots[t % SLOTS].push_back(entry);
+            count++;
+        }
+        // 收集到期的记录到expired
+        void Expire(uint64_t now)
+        {
+            expired.clear();
+            if (count == 0)
+            {
+                return;
+            }
+            uint64_t now_tick = now / TICK_MS;
+            if (now_tick >= tick + SLOTS)
+            {
+                // 落后超过一圈 所有槽各检查一次
+                tick = now_tick - SLOTS + 1;
+            }
+            // 当前时间片的槽保留到下次继续检查(其中的记录可能还没到期)
+            for (; tick <= now_tick; tick++)
+            {
+                std::vector<Entry> &slot = slots[tick % SLOTS];
+                size_t keep = 0;
+                for (size_t i = 0; i < slot.size(); i++)
+                {
+                    if (slot[i].deadline <= now)
+                    {
+                        expired.push_back(slot[i]);
+                    }
+                    else
+                    {
+                        slot[keep++] = slot[i];
+                    }
+                }
+                slot.resize(keep);
+                if (tick == now_tick)
+                {
+                    break;
+                }
+            }
+            count -= expired.size();
+        }
+        // 到下一条记录可能到期的时间(毫秒) 没有记录返回~0ull
+        uint64_t NextTimeout(uint64_t now) const
+        {
+            if (count == 0)
+            {
+                return ~0ull;
+            }
+            // 当前槽中还有超过一圈之后才到期的记录 只取落在当前时间片内的最小值
+            uint64_t later = ~0ull;
+            for (size_t i = 0; i < SLOTS; i++)
+            {
+                const std::vector<Entry> &slot = slots[(tick + i) % SLOTS];
+                if (slot.empty())
+                {
+                    continue;
+                }
+                if (i == 0)
+                {
+                    uint64_t min = ~0ull;
+                    for (auto &entry : slot)
+                    {
+                        if (entry.deadline / TICK_MS <= tick)
+                        {
+                            min = std::min(min, entry.deadline);
+                        }
+                        else
+                        {
+                            later = std::min(later, entry.deadline);
+                        }
+                    }
+                    if (min != ~0ull)
+                    {
+                        return min > now ? min - now : 0;
+                    }
+                    continue;
+                }
+                uint64_t start = (tick + i) * TICK_MS;
+                return start > now ? start - now : 0;
+            }
+            // 只剩当前槽中一圈之后的记录
+            if (later != ~0ull)
+            {
+                return later > now ? later - now : 0;
+            }
+            return ~0ull;
+        }
+        // 删除某个IOManager的所有记录
+        void Remove(IOManager *iom)
+        {
+            for (auto &slot : slots)
+            {
+                size_t keep = 0;
+                for (size_t i = 0; i < slot.size(); i++)
+                {
+                    if (slot[i].iom != iom)
+                    {
+                        slot[keep++] = slot[i];
+                    }
+                }
+                count -= slot.size() - keep;
+                slot.resize(keep);
+            }
+        }
+
+        std::vector<Entry> slots[SLOTS]; // 时间轮
+        std::vector<Entry> expired;      // 本次到期的记录
+        uint64_t tick = 0;               // 当前时间片
+        size_t count = 0;                // 记录数
+    };
+    static thread_local IoDeadlineWheel t_deadline_wheel;
+    static thread_local int t_reactor_index = -1;           // 当前线程的reactor下标
 
     enum EpollCtlOp
     {
@@ -81,6 +274,7 @@ namespace Xten
         evctx.cb = nullptr;
         evctx.fiber.reset();
         evctx.scheduler = nullptr;
+        evctx.deadline = 0;
     }
     // 触发事件上下文
     void IOManager::FdContext::triggerEvent(IOManager::Event ev)
@@ -108,76 +302,129 @@ namespace Xten
             sche->Schedule(std::move(evctx.fiber));
         }
         evctx.scheduler = nullptr;
+        evctx.deadline = 0;
         XTEN_ASSERT(!evctx.fiber &&
                     !evctx.cb &&
                     !evctx.scheduler);
     }
 
     IOManager::IOManager(int threadNum, bool userCaller, const std::string &name)
-        : Scheduler(threadNum, userCaller, name)
-    {
-        // 创建eventpoll结构
-        _epfd = epoll_create(1);
-        XTEN_ASSERT(_epfd >= 0);
-        // 创建通知管道
-        int ret = pipe(_pipeTicklefd);
-        XTEN_ASSERT(!ret);
-        // 将管道读事件设置非阻塞并放入epoll
-        int flags = fcntl(_pipeTicklefd[0], F_GETFL);
-        int ret2 = fcntl(_pipeTicklefd[0], F_SETFL, flags | O_NONBLOCK);
-        XTEN_ASSERT(!ret2);
-        struct epoll_event ev;
-        bzero(&ev, sizeof ev);
-        ev.events = EPOLLIN | EPOLLET;
-        // 联合体的所有成员从相同的内存地址开始存储，但一次只能存储其中一个成员的值---联合体的大小由其最大成员的大小决定
-        ev.data.fd = _pipeTicklefd[0]; // 参数传入fd---->data是一个联合体
-        int ret3 = epoll_ctl(_epfd, EPOLL_CTL_ADD, _pipeTicklefd[0], &ev);
-        XTEN_ASSERT(!ret3);
-        // 初始化fdcontexts
-        FdContextsResize(32);
-        Scheduler::Start();
-        //开启定时器 定期进行多任务队列的负载均衡
-#if OPTIMIZE==ON
-        // addTimer(150,std::bind(&Scheduler::autoLoadBalance,this),true);
+        : Scheduler(threadNum, userCaller, name),
+          TimerManager(g_iomanager_timer_wheel->GetValue(),
+#if OPTIMIZE == ON
+                       g_iomanager_timer_shard->GetValue() ? threadNum : 1
+#else
+                       1
 #endif
+          )
+    {
+        // 创建eventpoll结构 共享模式只有一个 每线程模式每个线程一个
+        _perThreadEpoll = g_iomanager_per_thread_epoll->GetValue();
+        _persistentEpoll = g_iomanager_persistent_epoll->GetValue();
+        _highResTimer = g_iomanager_timer_high_resolution->GetValue();
+        int reactor_num = _perThreadEpoll ? threadNum : 1;
+        for (int i = 0; i < reactor_num; i++)
+        {
+            std::unique_ptr<Reactor> reactor(new Reactor());
+            reactor->epfd = epoll_create(1);
+            XTEN_ASSERT(reactor->epfd >= 0);
+            // 创建通知eventfd(计数器语义 多次写入只需一次读取清零)
+            reactor->tickleFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+            XTEN_ASSERT(reactor->tickleFd >= 0);
+            struct epoll_event ev;
+            bzero(&ev, sizeof ev);
+            ev.events = EPOLLIN | EPOLLET;
+            // data是联合体 使用Reactor地址作为通知事件标识 不会和FdContext指针冲突
+            ev.data.ptr = reactor.get();
+            int ret = epoll_ctl(reactor->epfd, EPOLL_CTL_ADD, reactor->tickleFd, &ev);
+            XTEN_ASSERT(!ret);
+            _reactors.push_back(std::move(reactor));
+        }
+#ifdef XTEN_IO_URING
+        if (g_iomanager_io_uring->GetValue())
+        {
+            std::unique_ptr<IoUring> uring(new IoUring());
+            if (uring->Init(g_iomanager_io_uring_entries->GetValue()))
+            {
+                // io_uring有完成事件时fd可读 放入每个epoll实例 由idle协程统一收割
+                for (auto &reactor : _reactors)
+                {
+                    struct epoll_event ev;
+                    bzero(&ev, sizeof ev);
+                    ev.events = EPOLLIN | EPOLLET;
+                    ev.data.ptr = uring.get();
+                    int ret = epoll_ctl(reactor->epfd, EPOLL_CTL_ADD, uring->GetFd(), &ev);
+                    XTEN_ASSERT(!ret);
+                }
+                // 缓冲区注册失败不影响使用 只是不走固定缓冲区/multishot recv
+                if (g_iomanager_io_uring_fixed_buffers->GetValue() > 0)
+                {
+                    uring->RegisterFixedBuffers(g_iomanager_io_uring_fixed_buffers->GetValue(),
+                                                g_iomanager_io_uring_fixed_buffer_size->GetValue());
+                }
+                if (g_iomanager_io_uring_recv_buffers->GetValue() > 0)
+                {
+                    uring->RegisterRecvBufRing(g_iomanager_io_uring_recv_buffers->GetValue(),
+                                               g_iomanager_io_uring_recv_buffer_size->GetValue());
+                }
+                _uring = std::move(uring);
+            }
+            else
+            {
+                XTEN_LOG_WARN(g_logger) << "io_uring unavailable, iomanager fallback to epoll";
+            }
+        }
+#endif
+        Scheduler::Start();
     }
     IOManager::~IOManager()
     {
         // 调用调度器的stop函数
         Scheduler::Stop();
-        close(_pipeTicklefd[0]);
-        close(_pipeTicklefd[1]);
-        close(_epfd);
-        for (int i = 0; i < _fdContexts.size(); i++)
+        for (auto &reactor : _reactors)
         {
-            if (_fdContexts[i])
-            {
-                delete _fdContexts[i];
-            }
+            close(reactor->tickleFd);
+            close(reactor->epfd);
         }
+#ifdef XTEN_IO_URING
+        _uring.reset();
+#endif
+        if (t_reactor_iom == this)
+        {
+            t_reactor_iom = nullptr;
+            t_reactor_index = -1;
+        }
+        // 创建线程的时间轮中可能还有本调度器的超时记录
+        t_deadline_wheel.Remove(this);
+        // _fdContexts析构时释放所有fd上下文
     }
 
     // 添加事件
     int IOManager::AddEvent(int fd, Event ev, std::function<void()> func)
     {
-        FdContext *fd_ctx = nullptr;
-        // 在这个范围访问共享的fds数组----加大粒度锁
+        return addEvent(fd, ev, std::move(func), (uint64_t)-1, nullptr);
+    }
+    int IOManager::AddEventTimeout(int fd, Event ev, uint64_t timeout_ms, uint32_t &token)
+    {
+        return addEvent(fd, ev, nullptr, timeout_ms, &token);
+    }
+    bool IOManager::IsEventTimedOut(int fd, Event ev, uint32_t token)
+    {
+        FdContext *fd_ctx = getFdContext(fd, false);
+        if (!fd_ctx)
         {
-            RWMutex::ReadLock rlock(_mutex);
-            // fd大于数组的最大下标
-            if (fd > (_fdContexts.size() - 1))
-            {
-                rlock.unlock();
-                RWMutex::WriteLock wlock(_mutex);
-                // 扩容
-                FdContextsResize(fd * 2);
-                fd_ctx = _fdContexts[fd];
-            }
-            else
-            {
-                fd_ctx = _fdContexts[fd];
-                rlock.unlock();
-            }
+            return false;
+        }
+        SpinLock::Lock lock(fd_ctx->mutex);
+        return fd_ctx->getEvContext(ev).timedOutGen == token;
+    }
+    int IOManager::addEvent(int fd, Event ev, std::function<void()> func, uint64_t timeout_ms, uint32_t *token)
+    {
+        FdContext *fd_ctx = getFdContext(fd, true);
+        if (XTEN_UNLIKELY(!fd_ctx))
+        {
+            XTEN_LOG_ERROR(g_logger) << "addEvent fd=" << fd << " over fd table capacity";
+            return -1;
         }
         // 在这个范围拿到了fd上下文结构----加每个fd上下文结构的内部锁（小粒度）
         {
@@ -190,21 +437,73 @@ namespace Xten
                                          << " fd_ctx.event=" << (EPOLL_EVENTS)fd_ctx->events;
                 XTEN_ASSERT(false);
             }
+            // 常驻注册只用于FdCtxMgr管理的fd: 任何线程close都会增加FdCtx的关闭次数 据此判断注册是否随fd关闭失效
+            FdCtx *fdctx = _persistentEpoll ? FdCtxMgr::GetInstance()->Get(fd) : nullptr;
+            bool reregister = false;
+            if (fd_ctx->persistent && (!fdctx || fd_ctx->persistentGen != fdctx->GetGeneration()))
+            {
+                // fd已经关闭(可能是其他线程/其他调度器关闭的) 内核已从epoll中移除 需要重新注册
+                fd_ctx->persistent = false;
+                fd_ctx->ready = Event::NONE;
+                reregister = true;
+            }
             // 1.对epoll中进行事件的设置
-            //  操作类型
-            int opt = fd_ctx->events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
-            struct epoll_event st_ev;
-            // 设置ET触发----减少多线程epoll_wait一个eventpoll时产生惊群现象对性能的影响
-            st_ev.events = EPOLLET | fd_ctx->events | ev;
-            st_ev.data.ptr = (void *)fd_ctx; // 参数设置成fd_ctx指针 便于触发事件时进行处理事件
-            int rt = epoll_ctl(_epfd, opt, fd_ctx->fd, &st_ev);
-            if (XTEN_UNLIKELY(rt))
-            {
-                XTEN_LOG_ERROR(g_logger) << "epoll_ctl(" << _epfd << ", "
-                                         << (EpollCtlOp)opt << ", " << fd << ", " << (EPOLL_EVENTS)st_ev.events << "):"
-                                         << rt << " (" << errno << ") (" << strerror(errno) << ") fd_ctx->events="
-                                         << (EPOLL_EVENTS)fd_ctx->events;
-                return -1;
+            if (fdctx)
+            {
+                // 常驻注册模式: 只在第一次等待时注册 之后只修改fd_ctx
+                if (!fd_ctx->persistent)
+                {
+                    if (!reregister)
+                    {
+                        fd_ctx->owner = selectReactor();
+                    }
+                    int epfd = _reactors[fd_ctx->owner]->epfd;
+                    struct epoll_event st_ev;
+                    st_ev.events = EPOLLET | EPOLLIN | EPOLLOUT;
+                    st_ev.data.ptr = (void *)fd_ctx;
+                    uint32_t gen = fdctx->GetGeneration();
+                    int rt = epoll_ctl(epfd, EPOLL_CTL_ADD, fd_ctx->fd, &st_ev);
+                    if (rt && errno == EEXIST && reregister)
+                    {
+                        // 关闭前dup过 同一文件的注册还在
+                        rt = epoll_ctl(epfd, EPOLL_CTL_MOD, fd_ctx->fd, &st_ev);
+                    }
+                    if (XTEN_UNLIKELY(rt))
+                    {
+                        XTEN_LOG_ERROR(g_logger) << "epoll_ctl(" << epfd << ", "
+                                                 << (EpollCtlOp)EPOLL_CTL_ADD << ", " << fd << ", " << (EPOLL_EVENTS)st_ev.events << "):"
+                                                 << rt << " (" << errno << ") (" << strerror(errno) << ") fd_ctx->events="
+                                                 << (EPOLL_EVENTS)fd_ctx->events;
+                        return -1;
+                    }
+                    fd_ctx->persistent = true;
+                    fd_ctx->persistentGen = gen;
+                    fd_ctx->ready = Event::NONE;
+                }
+            }
+            else
+            {
+                //  操作类型
+                int opt = fd_ctx->events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+                if (opt == EPOLL_CTL_ADD)
+                {
+                    // 首次注册时确定fd所属的reactor(其他线程添加的事件直接注册到所属线程的epoll)
+                    fd_ctx->owner = selectReactor();
+                }
+                int epfd = _reactors[fd_ctx->owner]->epfd;
+                struct epoll_event st_ev;
+                // 设置ET触发----减少多线程epoll_wait一个eventpoll时产生惊群现象对性能的影响
+                st_ev.events = EPOLLET | fd_ctx->events | ev;
+                st_ev.data.ptr = (void *)fd_ctx; // 参数设置成fd_ctx指针 便于触发事件时进行处理事件
+                int rt = epoll_ctl(epfd, opt, fd_ctx->fd, &st_ev);
+                if (XTEN_UNLIKELY(rt))
+                {
+                    XTEN_LOG_ERROR(g_logger) << "epoll_ctl(" << epfd << ", "
+                                             << (EpollCtlOp)opt << ", " << fd << ", " << (EPOLL_EVENTS)st_ev.events << "):"
+                                             << rt << " (" << errno << ") (" << strerror(errno) << ") fd_ctx->events="
+                                             << (EPOLL_EVENTS)fd_ctx->events;
+                    return -1;
+                }
             }
             // 待处理事件++
             _pendingEventNum++;
@@ -226,22 +525,43 @@ namespace Xten
                 evctx.fiber = Xten::Fiber::GetThis();
                 XTEN_ASSERTINFO(evctx.fiber->GetStatus() == Fiber::Status::EXEC, "fiber state != EXEC");
             }
+            if (token)
+            {
+                // 0保留给没有超时的情况
+                if (++evctx.waitGen == 0)
+                {
+                    ++evctx.waitGen;
+                }
+                *token = evctx.waitGen;
+            }
+            if (timeout_ms != (uint64_t)-1)
+            {
+                // 记录超时 时间轮中已有更早的记录时不再添加(到期时按最新的超时时间重新放入)
+                uint64_t now = Xten::TimeUitl::GetCurrentMS();
+                evctx.deadline = now + timeout_ms;
+                if (!evctx.wheelDeadline || evctx.deadline < evctx.wheelDeadline)
+                {
+                    t_deadline_wheel.Add({this, fd, ev, evctx.deadline}, now);
+                    evctx.wheelDeadline = evctx.deadline;
+                }
+            }
+            // 3.常驻注册时等待前已经就绪(边缘已经触发过) 直接唤醒
+            if (fd_ctx->ready & ev)
+            {
+                fd_ctx->ready &= ~ev;
+                fd_ctx->triggerEvent(ev);
+                _pendingEventNum--;
+            }
         }
         return 0;
     }
     // 删除事件
     bool IOManager::DelEvent(int fd, Event ev)
     {
-        FdContext *fd_ctx = nullptr;
+        FdContext *fd_ctx = getFdContext(fd, false);
+        if (XTEN_UNLIKELY(!fd_ctx))
         {
-            RWMutex::ReadLock rlock(_mutex);
-            if (XTEN_UNLIKELY(fd > _fdContexts.size() - 1))
-            {
-                XTEN_LOG_ERROR(g_logger) << "delEvent assert fd=" << fd
-                                         << " over range event=" << (EPOLL_EVENTS)ev;
-                return false;
-            }
-            fd_ctx = _fdContexts[fd];
+            return false;
         }
         {
             SpinLock::Lock lock(fd_ctx->mutex);
@@ -249,16 +569,17 @@ namespace Xten
             {
                 return false;
             }
-            // 1.epoll中删除事件
+            // 1.epoll中删除事件(常驻注册不修改epoll)
             Event new_events = (Event)(fd_ctx->events & (~ev));
             struct epoll_event epev;
             epev.data.ptr = (void *)fd_ctx;
             epev.events = new_events | EPOLLET;
             int opt = new_events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
-            int ret = epoll_ctl(_epfd, opt, fd_ctx->fd, &epev);
+            int epfd = _reactors[fd_ctx->owner]->epfd;
+            int ret = fd_ctx->persistent ? 0 : epoll_ctl(epfd, opt, fd_ctx->fd, &epev);
             if (XTEN_UNLIKELY(ret))
             {
-                XTEN_LOG_ERROR(g_logger) << "epoll_ctl(" << _epfd << ", "
+                XTEN_LOG_ERROR(g_logger) << "epoll_ctl(" << epfd << ", "
                                          << (EpollCtlOp)opt << ", " << fd << ", " << (EPOLL_EVENTS)epev.events << "):"
                                          << ret << " (" << errno << ") (" << strerror(errno) << ") fd_ctx->events="
                                          << (EPOLL_EVENTS)fd_ctx->events;
@@ -275,71 +596,105 @@ namespace Xten
     // 取消事件
     bool IOManager::CancelEvent(int fd, Event ev)
     {
-        FdContext *fd_ctx = nullptr;
+        FdContext *fd_ctx = getFdContext(fd, false);
+        if (XTEN_UNLIKELY(!fd_ctx))
         {
-            RWMutex::ReadLock rlock(_mutex);
-            if (XTEN_UNLIKELY(fd >= _fdContexts.size()))
-            {
-                XTEN_LOG_ERROR(g_logger) << "cancel event assert fd=" << fd
-                                         << " over range event=" << (EPOLL_EVENTS)ev;
-                return false;
-            }
-            fd_ctx = _fdContexts[fd];
+            return false;
         }
+        SpinLock::Lock lock(fd_ctx->mutex);
+        return cancelEvent(fd_ctx, ev);
+    }
+    bool IOManager::cancelEvent(FdContext *fd_ctx, Event ev)
+    {
+        // 1.epoll中取消
+        if (XTEN_UNLIKELY(!(fd_ctx->events & ev)))
         {
-            // 1.epoll中取消
-            SpinLock::Lock lock(fd_ctx->mutex);
-            if (XTEN_UNLIKELY(!(fd_ctx->events & ev)))
-            {
-                return false;
-            }
-            Event new_event = (Event)(fd_ctx->events & ~ev);
-            int opt = new_event ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
-            struct epoll_event epev;
-            epev.data.ptr = (void *)fd_ctx;
-            epev.events = EPOLLET | new_event;
-            int ret = epoll_ctl(_epfd, opt, fd_ctx->fd, &epev);
-            if (XTEN_UNLIKELY(ret))
-            {
-                XTEN_LOG_ERROR(g_logger) << "epoll_ctl(" << _epfd << ", "
-                                         << (EpollCtlOp)opt << ", " << fd << ", " << (EPOLL_EVENTS)epev.events << "):"
-                                         << ret << " (" << errno << ") (" << strerror(errno) << ") fd_ctx->events="
-                                         << (EPOLL_EVENTS)fd_ctx->events;
-                return false;
-            }
-            // 2.fdcontext直接触发这个事件
-            fd_ctx->triggerEvent(ev);
-            _pendingEventNum--;
+            return false;
         }
+        Event new_event = (Event)(fd_ctx->events & ~ev);
+        int opt = new_event ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
+        struct epoll_event epev;
+        epev.data.ptr = (void *)fd_ctx;
+        epev.events = EPOLLET | new_event;
+        int epfd = _reactors[fd_ctx->owner]->epfd;
+        int ret = fd_ctx->persistent ? 0 : epoll_ctl(epfd, opt, fd_ctx->fd, &epev);
+        if (XTEN_UNLIKELY(ret))
+        {
+            XTEN_LOG_ERROR(g_logger) << "epoll_ctl(" << epfd << ", "
+                                     << (EpollCtlOp)opt << ", " << fd_ctx->fd << ", " << (EPOLL_EVENTS)epev.events << "):"
+                                     << ret << " (" << errno << ") (" << strerror(errno) << ") fd_ctx->events="
+                                     << (EPOLL_EVENTS)fd_ctx->events;
+            return false;
+        }
+        // 2.fdcontext直接触发这个事件
+        fd_ctx->triggerEvent(ev);
+        _pendingEventNum--;
         return true;
     }
+    void IOManager::expireDeadline(int fd, Event ev, uint64_t deadline, uint64_t now)
+    {
+        FdContext *fd_ctx = getFdContext(fd, false);
+        if (!fd_ctx)
+        {
+            return;
+        }
+        SpinLock::Lock lock(fd_ctx->mutex);
+        FdContext::EventContext &evctx = fd_ctx->getEvContext(ev);
+        if (deadline != evctx.wheelDeadline)
+        {
+            // 已被更早的记录取代
+            return;
+        }
+        evctx.wheelDeadline = 0;
+        if (!(fd_ctx->events & ev) || !evctx.deadline)
+        {
+            // 等待已经结束或者没有超时
+            return;
+        }
+        if (evctx.deadline > now)
+        {
+            // 记录之后又重新等待 按最新的超时时间放回时间轮
+            t_deadline_wheel.Add({this, fd, ev, evctx.deadline}, now);
+            evctx.wheelDeadline = evctx.deadline;
+            return;
+        }
+        evctx.timedOutGen = evctx.waitGen;
+        cancelEvent(fd_ctx, ev);
+    }
     // 取消fd上所有事件
     bool IOManager::CancelAll(int fd)
     {
-        FdContext *fd_ctx = nullptr;
+#ifdef XTEN_IO_URING
+        if (_uring)
         {
-            RWMutex::ReadLock rlock(_mutex);
-            if (XTEN_UNLIKELY(fd >= _fdContexts.size()))
-            {
-                XTEN_LOG_DEBUG(g_logger) << "cancel all event assert fd=" << fd<<" size="<<_fdContexts.size();
-                return true;
-            }
-            fd_ctx = _fdContexts[fd];
+            // fd上还在内核中的io_uring请求一并取消
+            UringCancelFd(fd);
+        }
+#endif
+        FdContext *fd_ctx = getFdContext(fd, false);
+        if (!fd_ctx)
+        {
+            // 没有在该fd上等待过
+            return true;
         }
         {
             SpinLock::Lock lock(fd_ctx->mutex);
-            if (!fd_ctx->events)
+            if (!fd_ctx->events && !fd_ctx->persistent)
             {
                 return false;
             }
+            // 常驻注册随fd关闭解除 fd复用时重新注册
+            fd_ctx->persistent = false;
+            fd_ctx->ready = Event::NONE;
             int opt = EPOLL_CTL_DEL;
             struct epoll_event epev;
             epev.data.ptr = (void *)fd_ctx;
             epev.events = 0;
-            int ret = epoll_ctl(_epfd, opt, fd_ctx->fd, &epev);
+            int epfd = _reactors[fd_ctx->owner]->epfd;
+            int ret = epoll_ctl(epfd, opt, fd_ctx->fd, &epev);
             if (XTEN_UNLIKELY(ret))
             {
-                XTEN_LOG_ERROR(g_logger) << "epoll_ctl(" << _epfd << ", "
+                XTEN_LOG_ERROR(g_logger) << "epoll_ctl(" << epfd << ", "
                                          << (EpollCtlOp)opt << ", " << fd << ", " << (EPOLL_EVENTS)epev.events << "):"
                                          << ret << " (" << errno << ") (" << strerror(errno) << ") fd_ctx->events="
                                          << (EPOLL_EVENTS)fd_ctx->events;
@@ -361,6 +716,15 @@ namespace Xten
         }
         return true;
     }
+    // 输出调度器状态信息(包含定时器统计)
+    std::ostream &IOManager::dump(std::ostream &os) const
+    {
+        Scheduler::dump(os);
+        os << std::endl
+           << "    [Timer shard: " << getShardNum() << " wheel: " << isWheel()
+           << " ] [Timer coalesced wakeup saved Sum: " << getCoalescedWakeups() << " ]";
+        return os;
+    }
     // 获取当前调度器指针
     IOManager *IOManager::GetThis() // 重定义
     {
@@ -369,17 +733,99 @@ namespace Xten
     // 通知线程有任务
     void IOManager::Tickle() // override
     {
-        // 无空闲线程--无需通知
-        if (!Scheduler::HasIdleThread())
+        // 与Idle中 parkedNum++ 之后的检查配对 保证任务入队和阻塞判断不会互相错过
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (XTEN_UNLIKELY(_stopping))
         {
+            // 停止时需要唤醒所有线程 不合并
+            for (auto &reactor : _reactors)
+            {
+                wakeReactor(*reactor);
+            }
             return;
         }
-        int ret = write(_pipeTicklefd[1], "T", 1);
-        if (XTEN_UNLIKELY(ret != 1))
+        // 只唤醒一个阻塞在epoll_wait的线程(每线程模式从轮询位置开始找)
+        size_t num = _reactors.size();
+        size_t start = num > 1 ? _tickleCursor++ % num : 0;
+        for (size_t i = 0; i < num; i++)
+        {
+            Reactor &reactor = *_reactors[(start + i) % num];
+            // 没有线程阻塞在epoll_wait---运行中的线程阻塞前会重新检查任务队列 无需通知
+            if (reactor.parkedNum == 0)
+            {
+                continue;
+            }
+            // 已经有未被处理的通知 合并本次通知
+            if (!reactor.tickled.exchange(true))
+            {
+                wakeReactor(reactor);
+            }
+            return;
+        }
+    }
+    void IOManager::wakeReactor(Reactor &reactor)
+    {
+        reactor.tickled = true;
+        // 边缘触发+多线程epoll_wait同一个epfd 一次写入只唤醒一个阻塞线程
+        uint64_t one = 1;
+        int ret = write(reactor.tickleFd, &one, sizeof one);
+        if (XTEN_UNLIKELY(ret != sizeof one))
         {
             XTEN_ASSERTINFO(false, "Tickle failed");
         }
     }
+    int IOManager::currentReactor()
+    {
+        if (!_perThreadEpoll)
+        {
+            return 0;
+        }
+        if (t_reactor_iom == this)
+        {
+            return t_reactor_index;
+        }
+        if (Scheduler::GetThis() != this)
+        {
+            // 不是本调度器的线程
+            return -1;
+        }
+        // 本调度器线程首次使用 分配reactor(创建线程固定使用最后一个)
+        int index = 0;
+        if (Xten::ThreadUtil::GetThreadId() == _root_threadId)
+        {
+            index = (int)_reactors.size() - 1;
+        }
+        else
+        {
+            index = (int)_reactorClaimed++;
+            XTEN_ASSERTINFO(index < _threads_num, "reactor index over threads num");
+        }
+        t_reactor_iom = this;
+        t_reactor_index = index;
+        return index;
+    }
+    int IOManager::selectReactor()
+    {
+        if (!_perThreadEpoll)
+        {
+            return 0;
+        }
+        // 只有创建线程参与调度
+        if (_threads_num == 0)
+        {
+            return (int)_reactors.size() - 1;
+        }
+        // 工作线程添加的fd归属自己 其他线程(包括只在Stop时参与调度的创建线程)轮询分配给工作线程
+        if (Xten::ThreadUtil::GetThreadId() != _root_threadId)
+        {
+            int index = currentReactor();
+            if (index != -1)
+            {
+                return index;
+            }
+        }
+        return (int)(_reactorCursor++ % (uint32_t)_threads_num);
+    }
     // 返回是否可以终止
     bool IOManager::IsStopping() // override
     {
@@ -390,6 +836,8 @@ namespace Xten
     void IOManager::Idle() // override
     {
         // XTEN_LOG_DEBUG(g_logger) << "idle";
+        // 当前线程等待的epoll实例
+        Reactor &reactor = *_reactors[currentReactor()];
         int MAX_EVENT = 256; // 一次epoll_wait返回的最大事件数
         struct epoll_event *epevs = new epoll_event[MAX_EVENT];
         std::shared_ptr<epoll_event> shared_epevs = std::shared_ptr<epoll_event>(epevs, [](epoll_event *ptr)
@@ -400,25 +848,37 @@ namespace Xten
             // 判断idle协程是否满足终止条件---满足则idle协程退出循环
             if (XTEN_UNLIKELY(IsStopping(timeout)))
             {
+                // 唤醒其他还阻塞在epoll_wait的线程一起退出
+                Tickle();
                 break;
             }
+            // 标记当前线程即将阻塞在epoll_wait 之后重新检查定时器和任务队列
+            // 在此之前放入的任务/定时器一定能被看到 在此之后放入的会通过Tickle唤醒
+            reactor.parkedNum++;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            // 分片时只看当前线程的分片(同时接收移交的定时器)
+            int timer_shard = getShardNum() > 1 ? Scheduler::GetQueueIndex() : 0;
+            // 单位微秒
+            timeout = TimerManager::getNextTimerUs(timer_shard);
+            uint64_t io_timeout = t_deadline_wheel.NextTimeout(Xten::TimeUitl::GetCurrentMS());
+            if (io_timeout != ~0ull)
+            {
+                timeout = std::min(timeout, io_timeout * 1000);
+            }
+            if (Scheduler::HasPendingTask())
+            {
+                // 已经有任务 只收集就绪事件不阻塞
+                timeout = 0;
+            }
             // 拿到定时器中最早过期时间
             int ret = 0;
             do
             {
-                static const int MAX_TIMEOUT = 3000; // 3s
-                uint64_t next_time = 0;
+                static const uint64_t MAX_TIMEOUT = 3000 * 1000; // 3s
                 // 超时时间由定时器最早过期时间和MAX_TIMEOUT的较小值决定
-                if (timeout != ~0ull)
-                {
-                    next_time = timeout < MAX_TIMEOUT ? timeout : MAX_TIMEOUT;
-                }
-                else
-                {
-                    next_time = MAX_TIMEOUT;
-                }
+                uint64_t next_time = timeout < MAX_TIMEOUT ? timeout : MAX_TIMEOUT;
                 // 多线程epoll_wait该epfd ------可能产生惊群现象
-                ret = epoll_wait(_epfd, epevs, MAX_EVENT, (int)(next_time));
+                ret = epollWait(reactor.epfd, epevs, MAX_EVENT, next_time, _highResTimer);
                 if (ret == -1 && errno == EINTR)
                 { // epoll被信号中断返回
                     continue;
@@ -428,34 +888,76 @@ namespace Xten
                     break;
                 }
             } while (true);
+            reactor.parkedNum--;
             // 1.处理超时事件------多线程安全
             std::vector<std::function<void()>> expire_funcS;
-            TimerManager::listExpiredCb(expire_funcS);
+            TimerManager::listExpiredCb(timer_shard, expire_funcS);
             if (!expire_funcS.empty())
             {
                 Schedule(expire_funcS.begin(), expire_funcS.end());
                 expire_funcS.clear();
             }
+            // 1.1.处理io超时
+            uint64_t now = Xten::TimeUitl::GetCurrentMS();
+            t_deadline_wheel.Expire(now);
+            for (auto &entry : t_deadline_wheel.expired)
+            {
+                entry.iom->expireDeadline(entry.fd, entry.event, entry.deadline, now);
+            }
             // 2.处理就绪事件
             for (int i = 0; i < ret; i++)
             {
                 struct epoll_event epev = epevs[i];
                 // 2.1.tickle通知事件------不做多线程同步机制
-                if (epev.data.fd == _pipeTicklefd[0])
+                if (epev.data.ptr == &reactor)
                 {
-                    char dummy[256];
-                    while (read(_pipeTicklefd[0], dummy, sizeof dummy) > 0)
-                    {
-                        continue;
-                    }
+                    // 先清除通知标志再读eventfd 保证之后的通知不会丢失
+                    reactor.tickled = false;
+                    uint64_t dummy;
+                    // eventfd一次读取即可清零计数器
+                    int rt = read(reactor.tickleFd, &dummy, sizeof dummy);
+                    (void)rt;
                     // 是tickle事件处理完后再处理下一个fd
                     continue;
                 }
-                // 2.2.处理注册的io事件-------多线程安全
-                FdContext *fd_ctx = (FdContext *)epev.data.ptr; // 如果tickle事件走到这 由于data是联合体 导致ptr得出来是0x04-----段错误
+#ifdef XTEN_IO_URING
+                // 2.2.io_uring完成事件
+                if (_uring && epev.data.ptr == _uring.get())
+                {
+                    uringReap();
+                    continue;
+                }
+#endif
+                // 2.3.处理注册的io事件-------多线程安全
+                FdContext *fd_ctx = (FdContext *)epev.data.ptr;
                 {
                     // 同一个事件只能同时被一个线程处理
                     SpinLock::Lock lock(fd_ctx->mutex);
+                    if (fd_ctx->persistent)
+                    {
+                        // 常驻注册: 唤醒等待者 没有等待者的事件锁存起来 不修改epoll注册
+                        int ready_event = Event::NONE;
+                        if (epev.events & (EPOLLIN | EPOLLERR | EPOLLHUP))
+                        {
+                            ready_event |= Event::READ;
+                        }
+                        if (epev.events & (EPOLLOUT | EPOLLERR | EPOLLHUP))
+                        {
+                            ready_event |= Event::WRITE;
+                        }
+                        fd_ctx->ready |= (ready_event & ~fd_ctx->events);
+                        if (ready_event & fd_ctx->events & Event::READ)
+                        {
+                            fd_ctx->triggerEvent(Event::READ);
+                            _pendingEventNum--;
+                        }
+                        if (ready_event & fd_ctx->events & Event::WRITE)
+                        {
+                            fd_ctx->triggerEvent(Event::WRITE);
+                            _pendingEventNum--;
+                        }
+                        continue;
+                    }
                     if (epev.events & (EPOLLERR | EPOLLHUP)) // 异常事件转化成读写事件进行处理
                     {
                         epev.events |= ((EPOLLIN | EPOLLOUT) & fd_ctx->events);
@@ -480,10 +982,11 @@ namespace Xten
                     int opt = leave_event ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
                     // 重新设置epoll
                     epev.events = EPOLLET | leave_event;
-                    int ret2 = epoll_ctl(_epfd, opt, fd_ctx->fd, &epev);
+                    int epfd = _reactors[fd_ctx->owner]->epfd;
+                    int ret2 = epoll_ctl(epfd, opt, fd_ctx->fd, &epev);
                     if (XTEN_UNLIKELY(ret2))
                     {
-                        XTEN_LOG_ERROR(g_logger) << "epoll_ctl(" << _epfd << ", "
+                        XTEN_LOG_ERROR(g_logger) << "epoll_ctl(" << epfd << ", "
                                                  << (EpollCtlOp)opt << ", " << fd_ctx->fd << ", " << (EPOLL_EVENTS)epev.events << "):"
                                                  << ret2 << " (" << errno << ") (" << strerror(errno) << ") fd_ctx->events="
                                                  << (EPOLL_EVENTS)fd_ctx->events;
@@ -512,23 +1015,152 @@ namespace Xten
         }
         // while(true)循环退出---->调度器的终止条件就绪了
     }
+#ifdef XTEN_IO_URING
+    io_uring_sqe *IOManager::uringGetSqe()
+    {
+        io_uring_sqe *sqe = _uring->GetSqe();
+        if (XTEN_UNLIKELY(!sqe))
+        {
+            // 提交队列满(内核还没消费) 先提交一次再重试
+            _uring->Submit();
+            sqe = _uring->GetSqe();
+        }
+        return sqe;
+    }
+    bool IOManager::UringSubmit(UringRequest *req, void (*prep)(io_uring_sqe *, void *), void *arg)
+    {
+        if (XTEN_UNLIKELY(!_uring))
+        {
+            return false;
+        }
+        IoUring::MutexType::Lock lock(_uring->GetSqMutex());
+        io_uring_sqe *sqe = uringGetSqe();
+        if (XTEN_UNLIKELY(!sqe))
+        {
+            return false;
+        }
+        prep(sqe, arg);
+        sqe->user_data = (uint64_t)(uintptr_t)req;
+        // 请求未完成前调度器不能终止
+        _pendingEventNum++;
+        int ret = _uring->Submit();
+        if (XTEN_UNLIKELY(ret < 0))
+        {
+            _pendingEventNum--;
+            return false;
+        }
+        return true;
+    }
+    bool IOManager::UringCancel(UringRequest *req)
+    {
+        if (!_uring)
+        {
+            return false;
+        }
+        IoUring::MutexType::Lock lock(_uring->GetSqMutex());
+        io_uring_sqe *sqe = uringGetSqe();
+        if (XTEN_UNLIKELY(!sqe))
+        {
+            return false;
+        }
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = (uint64_t)(uintptr_t)req;
+        sqe->user_data = 0; // 取消请求本身的完成事件忽略
+        return _uring->Submit() >= 0;
+    }
+    bool IOManager::UringCancelFd(int fd)
+    {
+        if (!_uring)
+        {
+            return false;
+        }
+        IoUring::MutexType::Lock lock(_uring->GetSqMutex());
+        io_uring_sqe *sqe = uringGetSqe();
+        if (XTEN_UNLIKELY(!sqe))
+        {
+            return false;
+        }
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = fd;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+        sqe->user_data = 0;
+        return _uring->Submit() >= 0;
+    }
+    void IOManager::uringReap()
+    {
+        static const size_t MAX_CQE = 256;
+        io_uring_cqe cqes[MAX_CQE];
+        SpinLock::Lock lock(_uringReapMutex);
+        while (true)
+        {
+            size_t num = _uring->Reap(cqes, MAX_CQE);
+            for (size_t i = 0; i < num; i++)
+            {
+                UringRequest *req = (UringRequest *)(uintptr_t)cqes[i].user_data;
+                if (!req)
+                {
+                    // 取消请求的完成事件
+                    continue;
+                }
+                bool more = cqes[i].flags & IORING_CQE_F_MORE;
+                if (req->cb)
+                {
+                    if (more)
+                    {
+                        req->cb(cqes[i].res, cqes[i].flags);
+                    }
+                    else
+                    {
+                        // multishot请求结束 回调移出后再执行(回调中发起者可以释放req)
+                        std::function<void(int, uint32_t)> cb = std::move(req->cb);
+                        _pendingEventNum--;
+                        cb(cqes[i].res, cqes[i].flags);
+                    }
+                    continue;
+                }
+                req->res = cqes[i].res;
+                Scheduler *sche = req->scheduler;
+                Fiber::ptr fiber = std::move(req->fiber);
+                req->scheduler = nullptr;
+                _pendingEventNum--;
+                // 唤醒之后req所在的协程栈随时可能失效 不再访问req
+                XTEN_ASSERTINFO(sche && fiber, "UringRequest dont have Scheduler or Fiber");
+                sche->Schedule(std::move(fiber));
+            }
+            if (num < MAX_CQE)
+            {
+                break;
+            }
+        }
+    }
+#endif
     // 有更早过期任务
     void IOManager::onTimerInsertedAtFront() // override
     {
         Tickle();
     }
-    //_fdContexts扩容
-    void IOManager::FdContextsResize(int size)
+    int IOManager::currentTimerShard() // override
     {
-        _fdContexts.resize(size);
-        for (int i = 0; i < _fdContexts.size(); i++)
+        // 只在Stop时参与调度的创建线程不一定会进入idle 它添加的定时器交给工作线程
+        if (Scheduler::GetThis() != this ||
+            (_threads_num > 0 && Xten::ThreadUtil::GetThreadId() == _root_threadId))
         {
-            if (_fdContexts[i] == nullptr)
-            {
-                _fdContexts[i] = new FdContext();
-                _fdContexts[i]->fd = i; // 下标值就是fd
-            }
+            return -1;
+        }
+        return Scheduler::GetQueueIndex();
+    }
+    IOManager::FdContext *IOManager::getFdContext(int fd, bool create)
+    {
+        if (!create)
+        {
+            return _fdContexts.Get(fd);
         }
+        return _fdContexts.GetOrCreate(fd, [](int fd)
+                                       {
+            FdContext *fd_ctx = new FdContext();
+            fd_ctx->fd = fd; // 下标值就是fd
+            return fd_ctx; });
     }
     bool IOManager::IsStopping(uint64_t &timeout)
     {
@@ -538,8 +1170,8 @@ namespace Xten
                Scheduler::IsStopping();
     }
 
-    Timer::ptr AddTimerToIOManager(uint64_t ms, std::function<void()> cb, bool recurring)
+    Timer::ptr AddTimerToIOManager(uint64_t ms, std::function<void()> cb, bool recurring, uint64_t slack_ms)
     {
-        return Xten::IOManager::GetThis()->addTimer(ms, cb, recurring);
+        return Xten::IOManager::GetThis()->addTimer(ms, cb, recurring, slack_ms);
     }
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 #define __XTEN_IOMANAGER_H__
 #include "scheduler.h"
 #include "timer.h"
+#include "uring.h"
+#include "segment_table.h"
 namespace Xten
 {
     // 基于 epoll_wait+红黑树定时器 封装的io协程调度器
@@ -22,14 +24,62 @@ namespace Xten
         };
         // 添加io事件
         int AddEvent(int fd, Event ev, std::function<void()> func = nullptr);
+        // 当前协程等待io事件 timeout_ms后超时唤醒(-1不超时) token用于唤醒后查询是否超时
+        // 超时记录在线程本地时间轮中(由Idle驱动 惰性取消) 不创建定时器
+        int AddEventTimeout(int fd, Event ev, uint64_t timeout_ms, uint32_t &token);
+        // AddEventTimeout的等待是否因超时被唤醒
+        bool IsEventTimedOut(int fd, Event ev, uint32_t token);
         // 删除io事件
         bool DelEvent(int fd, Event ev);
         // 取消io事件
         bool CancelEvent(int fd, Event ev);
         // 取消fd上所有io事件
         bool CancelAll(int fd);
+        // 输出调度器状态信息(包含定时器统计)
+        virtual std::ostream &dump(std::ostream &os) const override;
         // 获取当前调度器指针
         static IOManager *GetThis();
+#ifdef XTEN_IO_URING
+        // 一次io_uring请求(由发起者持有 直到完成事件处理完毕)
+        struct UringRequest
+        {
+            // 完成后唤醒协程所属的调度器
+            Scheduler *scheduler = nullptr;
+            // 完成后唤醒的协程
+            Fiber::ptr fiber;
+            // multishot请求 每个完成事件都在收割线程直接回调(res,cqe flags) 回调中不能阻塞
+            std::function<void(int, uint32_t)> cb;
+            // 完成结果(失败为-errno)
+            int res = 0;
+        };
+        // 是否启用了io_uring后端
+        bool IsUringEnabled() const { return (bool)_uring; }
+        // io_uring实例(固定缓冲区/提供缓冲区) 未启用为nullptr
+        IoUring *GetUring() const { return _uring.get(); }
+        // 提交io_uring请求 prep在持有提交队列锁时填充sqe 提交失败返回false
+        bool UringSubmit(UringRequest *req, void (*prep)(io_uring_sqe *, void *), void *arg);
+        // 在当前协程提交请求并挂起 直到完成(结果在req.res) 提交失败返回false
+        template <class Prep>
+        bool UringWait(UringRequest &req, Prep &prep)
+        {
+            req.scheduler = Scheduler::GetThis();
+            req.fiber = Fiber::GetThis();
+            if (!UringSubmit(&req, [](io_uring_sqe *sqe, void *arg)
+                             { (*(Prep *)arg)(sqe); },
+                             &prep))
+            {
+                req.scheduler = nullptr;
+                req.fiber.reset();
+                return false;
+            }
+            Fiber::YieldToHold();
+            return true;
+        }
+        // 取消一个未完成的请求
+        bool UringCancel(UringRequest *req);
+        // 取消fd上所有未完成的请求
+        bool UringCancelFd(int fd);
+#endif
         //fd上下文结构
         struct FdContext
         {
@@ -42,6 +92,14 @@ namespace Xten
                 Fiber::ptr fiber;
                 // 事件触发后执行回调
                 std::function<void()> cb;
+                // 本次等待的超时时间(绝对毫秒 0表示没有)
+                uint64_t deadline = 0;
+                // 时间轮中该事件最早的超时记录(0表示没有)
+                uint64_t wheelDeadline = 0;
+                // 等待序号
+                uint32_t waitGen = 0;
+                // 超时唤醒的等待序号
+                uint32_t timedOutGen = 0;
             };
             //获取事件对应上下文
             EventContext& getEvContext(Event ev);
@@ -53,6 +111,10 @@ namespace Xten
             EventContext write; // 写上下文
             Event events;       // 当前fd的事件
             int fd;             // fd句柄
+            int owner = 0;      // fd注册所在的reactor下标
+            bool persistent = false;   // 是否常驻注册(EPOLLIN|EPOLLOUT|EPOLLET 等待/唤醒不修改epoll)
+            int ready = Event::NONE;   // 常驻注册时没有等待者的就绪事件(锁存 下次等待直接唤醒)
+            uint32_t persistentGen = 0; // 常驻注册时fd的关闭次数(FdCtx::GetGeneration) 变化说明fd已关闭过
             SpinLock mutex;     // 自旋锁
         };
 
@@ -65,19 +127,59 @@ namespace Xten
         virtual void Idle() override;
         //有更早过期任务
         virtual void onTimerInsertedAtFront() override;
-        //_fdContexts扩容
-        void FdContextsResize(int size);
+        // 当前线程添加定时器使用的分片
+        virtual int currentTimerShard() override;
+        // 获取fd上下文 create为true时不存在则创建 超出容量返回nullptr
+        FdContext *getFdContext(int fd, bool create);
+        // 添加io事件 timeout_ms不为-1时记录超时
+        int addEvent(int fd, Event ev, std::function<void()> func, uint64_t timeout_ms, uint32_t *token);
+        // 取消事件并触发 ---需持有fd_ctx锁
+        bool cancelEvent(FdContext *fd_ctx, Event ev);
+    public:
+        // 时间轮中的io超时记录到期(Idle中调用)
+        void expireDeadline(int fd, Event ev, uint64_t deadline, uint64_t now);
+    protected:
         bool IsStopping(uint64_t& timeout);
     private:
-        int _epfd;                            // eventpoll结构对应的fd
-        int _pipeTicklefd[2];                 // 用于通知操作的管道读写fd
-        std::atomic<int> _pendingEventNum{0}; // 要处理的任务数量
-        RWMutex _mutex;                       // 读写锁（保护事件队列的线程安全性）
-        std::vector<FdContext *> _fdContexts; // io事件上下文
+        // 一个epoll实例 共享模式只有一个(所有线程共同epoll_wait) 每线程模式每个线程一个
+        struct Reactor
+        {
+            int epfd = -1;                     // eventpoll结构对应的fd
+            int tickleFd = -1;                 // 用于通知操作的eventfd
+            std::atomic<int> parkedNum{0};     // 阻塞在epoll_wait中的线程数量
+            std::atomic<bool> tickled{false};  // 是否有未被处理的通知(合并多次通知)
+        };
+        // 写eventfd唤醒阻塞在该reactor上的一个线程
+        void wakeReactor(Reactor &reactor);
+        // 当前线程的reactor下标 不是本调度器线程返回-1
+        int currentReactor();
+        // 为新注册的fd选择所属reactor
+        int selectReactor();
+#ifdef XTEN_IO_URING
+        // 获取一个空闲sqe ---需持有提交队列锁
+        io_uring_sqe *uringGetSqe();
+        // 收割io_uring完成事件 唤醒等待协程/执行multishot回调
+        void uringReap();
+#endif
+
+    private:
+        bool _perThreadEpoll = false;                      // 是否每个线程独立epoll
+        bool _persistentEpoll = false;                     // fd是否常驻注册到epoll
+        bool _highResTimer = false;                        // 定时器是否微秒精度等待
+        std::vector<std::unique_ptr<Reactor>> _reactors;   // epoll实例
+        std::atomic<uint32_t> _reactorClaimed{0};          // 已分配reactor的工作线程数
+        std::atomic<uint32_t> _reactorCursor{0};           // 外部线程注册fd的轮询位置
+        std::atomic<uint32_t> _tickleCursor{0};            // 唤醒线程的轮询位置
+        std::atomic<int> _pendingEventNum{0};              // 要处理的任务数量
+        SegmentTable<FdContext> _fdContexts;               // io事件上下文(按fd下标 查找不加锁 扩容不移动)
+#ifdef XTEN_IO_URING
+        std::unique_ptr<IoUring> _uring;                   // io_uring实例(未启用为空)
+        SpinLock _uringReapMutex;                          // 串行化完成事件的处理(保证同一multishot请求的完成事件有序)
+#endif
     };
 
     //封装添加定时器接口----给业务module.so使用 [因为unknown错误无法直接使用addTimer接口]
-    Timer::ptr AddTimerToIOManager(uint64_t ms, std::function<void()> cb, bool recurring = false);
+    Timer::ptr AddTimerToIOManager(uint64_t ms, std::function<void()> cb, bool recurring = false, uint64_t slack_ms = 0);
     
 }
 #endif
\ No newline at end of file
@@ -81,7 +81,7 @@ namespace Xten
                            {
                 auto lis=wklistener.lock();
                 if(lis)
-                    lis->cleanupBlacklist(); }, true);
+                    lis->cleanupBlacklist(); }, true, 1000);
             return true;
         }
 
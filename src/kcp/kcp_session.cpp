@@ -75,8 +75,9 @@ namespace Xten
             Timer::ptr timer;
             if (_read_timeout_ms > 0)
                 // 启动超时定时器
+                // 读超时允许延后1/8 与其他会话的读超时合并唤醒
                 timer = Xten::IOManager::GetThis()->addTimer(_read_timeout_ms,
-                                                             std::bind(&KcpSession::notifyReadTimeout, this));
+                                                             std::bind(&KcpSession::notifyReadTimeout, this), false, _read_timeout_ms / 8);
             do
             {
                 MutexType::Lock lock(_kcpcb_mtx);
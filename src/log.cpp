@@ -1,6 +1,13 @@
 #include "log.h"
+#include "binlog.h"
 #include "system/env.h"
 #include "config.h"
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <limits.h>
+#include <algorithm>
+#include <thread>
+#include <charconv>
 namespace Xten
 {
     static Logger::ptr g_logger = XTEN_LOG_NAME("system");
@@ -64,7 +71,7 @@ namespace Xten
     {
         return _level;
     }
-    std::string LogEvent::FileName()
+    const std::string &LogEvent::FileName()
     {
         return _file;
     }
@@ -93,7 +100,7 @@ namespace Xten
     {
         return _fiber_id;
     }
-    std::string LogEvent::GetThreadName()
+    const std::string &LogEvent::GetThreadName()
     {
         return _thread_name;
     }
@@ -135,18 +142,20 @@ namespace Xten
     }
     void Logger::log(LogLevel::Level level, LogEvent::ptr ev)
     {
-        auto self = shared_from_this();
-        // std::cout<<_sinkers.size()<<std::endl;
-        if (level >= _level_limit)
-        {                                // 到达指定日志级别则输出
-            SpinLock::Lock lock(_mutex); // 多线程同一logger输出安全性
-            if (!_sinkers.empty())
+        if (IsLevelEnabled(level))
+        { // 到达指定日志级别则输出
+            auto self = shared_from_this();
+            std::shared_ptr<std::vector<Logsinker::ptr>> sinkers;
+            {
+                // 锁内只拷贝快照 各个sink自己保证并发安全(异步sink落地时不持有logger的锁)
+                SpinLock::Lock lock(_mutex);
+                sinkers = _sinkersSnapshot;
+            }
+            if (sinkers && !sinkers->empty())
             { // 这个logger有落地对象
-                for (auto &sink : _sinkers)
+                for (auto &sink : *sinkers)
                 {
-                    sink.second->log(self, level, ev); // 每个sinks又有自己的日志级别
-                    // std::cout<<sink.second->toYamlString();
-                    // std::cout<<"logger 的log调用"<<std::endl;
+                    sink->log(self, level, ev); // 每个sinks又有自己的日志级别
                 }
             }
             // 无落地对象 让主logger进行输出
@@ -159,10 +168,58 @@ namespace Xten
             }
         }
     }
+    void Logger::logBinary(const LogSite &site, const char *data, size_t len)
+    {
+        if (!IsLevelEnabled(site.level))
+        {
+            return;
+        }
+        std::shared_ptr<std::vector<Logsinker::ptr>> sinkers;
+        {
+            SpinLock::Lock lock(_mutex);
+            sinkers = _sinkersSnapshot;
+        }
+        if (sinkers && !sinkers->empty())
+        {
+            auto self = shared_from_this();
+            for (auto &sink : *sinkers)
+            {
+                sink->logBinary(self, site, data, len);
+            }
+        }
+        else if (_root_logger)
+        {
+            _root_logger->logBinary(site, data, len);
+        }
+    }
+    uint32_t Logger::GetNameId()
+    {
+        uint32_t id = _nameId.load(std::memory_order_acquire);
+        if (id == 0)
+        {
+            id = LogSiteRegistry::GetInstance()->InternName(_name);
+            _nameId.store(id, std::memory_order_release);
+        }
+        return id;
+    }
+    // 非二进制落地类: 在当前线程还原成文本日志
+    void Logsinker::logBinary(Logger::ptr logger, const LogSite &site, const char *data, size_t len)
+    {
+        if (site.level < _level_limit)
+        {
+            return;
+        }
+        LogEvent::ptr ev = std::make_shared<LogEvent>(logger, site.level, site.file, site.line, 0,
+                                                      ThreadUtil::GetThreadId(), (uint32_t)FiberUtil::GetFiberId(),
+                                                      time(nullptr), Thread::GetName());
+        ev->GetSStream() << LogBinaryFormat(site.fmt, site.types.data(), site.types.size(), data, len);
+        log(logger, site.level, ev);
+    }
     void Logger::SetLevelLimit(LogLevel::Level lv)
     {
         SpinLock::Lock lock(_mutex); // 多线程同一logger输出安全性
         _level_limit = lv;
+        updateLevelCache();
     }
     LogLevel::Level Logger::GetLevelLimit()
     {
@@ -178,7 +235,13 @@ namespace Xten
             sinker->SetFormatter(_formatter);
         }
         // 如果 unordered_map 中的 key 已经存在，调用 insert 操作时将不会插入新的键值对
-        _sinkers.insert(std::make_pair(sink_name, sinker));
+        if (_sinkers.insert(std::make_pair(sink_name, sinker)).second)
+        {
+            // 落地类级别变化时刷新本logger的生效级别
+            SpinLock::Lock sink_lock(sinker->_mutex);
+            sinker->_owners.push_back(weak_from_this());
+        }
+        rebuildSnapshot();
     }
     void Logger::DelSinkers(const std::string &sink_name)
     {
@@ -187,6 +250,7 @@ namespace Xten
         {
             if (iter->first == sink_name)
             { // 找到了目标sink
+                iter->second->delOwner(this);
                 iter = _sinkers.erase(iter);
             }
             else
@@ -194,13 +258,52 @@ namespace Xten
                 ++iter; // 防止迭代器失效
             }
         }
+        rebuildSnapshot();
     }
     void Logger::ClearSinkers()
     {
         SpinLock::Lock lock(_mutex); // 多线程同一logger输出安全性
+        for (auto &sink : _sinkers)
+        {
+            sink.second->delOwner(this);
+        }
         _sinkers.clear();
+        rebuildSnapshot();
     }
-    std::string Logger::GetName()
+    // 重建落地类快照(调用方持有_mutex)
+    void Logger::rebuildSnapshot()
+    {
+        auto sinkers = std::make_shared<std::vector<Logsinker::ptr>>();
+        sinkers->reserve(_sinkers.size());
+        for (auto &sink : _sinkers)
+        {
+            sinkers->push_back(sink.second);
+        }
+        _sinkersSnapshot = sinkers;
+        updateLevelCache();
+    }
+    void Logger::RefreshLevelCache()
+    {
+        SpinLock::Lock lock(_mutex);
+        updateLevelCache();
+    }
+    // 生效级别 = max(日志器级别, 所有落地类中最低的级别)
+    // 没有落地类时交给主logger输出 只按日志器自己的级别(主logger输出时还会按它自己的级别过滤)
+    void Logger::updateLevelCache()
+    {
+        int level = _level_limit;
+        if (!_sinkers.empty())
+        {
+            int min_sink = LogLevel::FATAL;
+            for (auto &sink : _sinkers)
+            {
+                min_sink = std::min<int>(min_sink, sink.second->GetLevelLimit());
+            }
+            level = std::max(level, min_sink);
+        }
+        _effectiveLevel.store(level, std::memory_order_relaxed);
+    }
+    const std::string &Logger::GetName()
     {
         return _name;
     }
@@ -253,6 +356,40 @@ namespace Xten
     {
         _root_logger = root_logger;
     }
+    void Logsinker::SetLevelLimit(LogLevel::Level level)
+    {
+        std::vector<std::weak_ptr<Logger>> owners;
+        {
+            SpinLock::Lock lock(_mutex);
+            _level_limit = level;
+            owners = _owners;
+        }
+        // 锁外刷新 Logger持有自己的锁时会读取落地类级别
+        for (auto &owner : owners)
+        {
+            Logger::ptr logger = owner.lock();
+            if (logger)
+            {
+                logger->RefreshLevelCache();
+            }
+        }
+    }
+    void Logsinker::delOwner(Logger *logger)
+    {
+        SpinLock::Lock lock(_mutex);
+        for (auto iter = _owners.begin(); iter != _owners.end();)
+        {
+            Logger::ptr owner = iter->lock();
+            if (!owner || owner.get() == logger)
+            {
+                iter = _owners.erase(iter); // 已经析构的顺便清理
+            }
+            else
+            {
+                ++iter;
+            }
+        }
+    }
     // 标准输出
     void StdoutLogsinker::log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr ev)
     {
@@ -313,184 +450,333 @@ namespace Xten
         }
         return FileUtil::OpenForWrite(_file_stream, _log_filename, std::ios_base::out | std::ios_base::app); // 以追加方式写入文件
     }
-    // 格式化items
-    // 1.日志内容输出
-    class MessageFormatterItem : public Formatter::FormatterItem // 基类
+    // 异步sink的唯一id
+    static std::atomic<uint64_t> s_async_sinker_id{0};
+    // 线程缓冲区 单生产者(日志线程)单消费者(刷盘线程)的环形字节缓冲区
+    struct AsyncFileLogsinker::Buffer
     {
-    public:
-        typedef std::shared_ptr<MessageFormatterItem> ptr;
-        MessageFormatterItem(const std::string &str = "") {}
-        virtual void format(std::ostream &osm, Logger::ptr logger, LogLevel::Level lv, LogEvent::ptr ev)
+        Buffer(size_t sz)
+            : data((char *)malloc(sz)), size(sz)
         {
-            osm << ev->GetContent();
         }
-
-    private:
-    };
-    // 2.日志级别输出
-    class LevelFormatterItem : public Formatter::FormatterItem // 基类
-    {
-    public:
-        typedef std::shared_ptr<LevelFormatterItem> ptr;
-        LevelFormatterItem(const std::string &str = "") {}
-        virtual void format(std::ostream &osm, Logger::ptr logger, LogLevel::Level lv, LogEvent::ptr ev)
+        ~Buffer()
         {
-            osm << LogLevel::ToString(lv);
+            free(data);
         }
-
-    private:
+        char *data;
+        size_t size;
+        alignas(64) std::atomic<uint64_t> head{0}; // 已刷盘位置 刷盘线程更新
+        alignas(64) std::atomic<uint64_t> tail{0}; // 已写入位置 日志线程更新
+        std::atomic<bool> exited{false};           // 所属线程已退出
+        std::atomic<bool> closed{false};           // 所属sink已析构
     };
-    // 3.离程序启动时间输出
-    class ElapseFormatterItem : public Formatter::FormatterItem // 基类
-    {
-    public:
-        typedef std::shared_ptr<ElapseFormatterItem> ptr;
-        ElapseFormatterItem(const std::string &str = "") {}
-        virtual void format(std::ostream &osm, Logger::ptr logger, LogLevel::Level lv, LogEvent::ptr ev)
+    AsyncFileLogsinker::AsyncFileLogsinker(const std::string &filename, uint32_t flush_interval,
+                                           size_t buffer_size, bool drop_when_full)
+        : Logsinker(),
+          _log_filename(filename),
+          _flushInterval(flush_interval == 0 ? 1 : flush_interval),
+          _bufferSize(4096),
+          _dropWhenFull(drop_when_full),
+          _id(++s_async_sinker_id)
+    {
+        while (_bufferSize < buffer_size)
         {
-            osm << std::to_string(ev->GetElapse());
+            _bufferSize <<= 1;
         }
-
-    private:
-    };
-    // 4.日志器名字输出
-    class LoggerNameFormatterItem : public Formatter::FormatterItem // 基类
+        reopen();
+        _thread.reset(new Thread(std::bind(&AsyncFileLogsinker::flushLoop, this), "log_flush"));
+    }
+    AsyncFileLogsinker::~AsyncFileLogsinker()
     {
-    public:
-        typedef std::shared_ptr<LoggerNameFormatterItem> ptr;
-        LoggerNameFormatterItem(const std::string &str = "") {}
-        virtual void format(std::ostream &osm, Logger::ptr logger, LogLevel::Level lv, LogEvent::ptr ev)
+        stop();
+        if (_fd >= 0)
         {
-            osm << ev->GetLogger()->GetName();
+            ::close(_fd);
         }
-
-    private:
-    };
-    // 5.线程id输出
-    class ThreadIdFormatterItem : public Formatter::FormatterItem // 基类
+        std::lock_guard<std::mutex> lock(_buffersMutex);
+        for (auto &buf : _buffers)
+        {
+            buf->closed = true;
+        }
+    }
+    void AsyncFileLogsinker::stop()
     {
-    public:
-        typedef std::shared_ptr<ThreadIdFormatterItem> ptr;
-        ThreadIdFormatterItem(const std::string &str = "") {}
-        virtual void format(std::ostream &osm, Logger::ptr logger, LogLevel::Level lv, LogEvent::ptr ev)
+        if (_stop.exchange(true))
         {
-            osm << ev->GetThreaId();
+            return;
         }
-
-    private:
-    };
-    // 6.协程id输出
-    class FiberIdFormatterItem : public Formatter::FormatterItem // 基类
+        {
+            std::lock_guard<std::mutex> lock(_waitMutex);
+            _cond.notify_all();
+        }
+        // 刷盘线程退出前会把剩余数据写完
+        _thread->join();
+    }
+    AsyncFileLogsinker::Buffer *AsyncFileLogsinker::getBuffer()
     {
-    public:
-        typedef std::shared_ptr<FiberIdFormatterItem> ptr;
-        FiberIdFormatterItem(const std::string &str = "") {}
-        virtual void format(std::ostream &osm, Logger::ptr logger, LogLevel::Level lv, LogEvent::ptr ev)
+        // 线程局部缓存 线程退出时标记缓冲区 由刷盘线程写完后回收
+        struct Holder
+        {
+            std::vector<std::pair<uint64_t, std::shared_ptr<Buffer>>> buffers;
+            ~Holder()
+            {
+                for (auto &buf : buffers)
+                {
+                    buf.second->exited = true;
+                }
+            }
+        };
+        static thread_local Holder t_holder;
+        for (auto &buf : t_holder.buffers)
         {
-            osm << ev->GetFiberId();
+            if (buf.first == _id)
+            {
+                return buf.second.get();
+            }
         }
-
-    private:
-    };
-    // 7.线程名字输出
-    class ThreadNameFormatterItem : public Formatter::FormatterItem // 基类
+        // 顺便清理已析构sink的缓冲区
+        auto &bufs = t_holder.buffers;
+        bufs.erase(std::remove_if(bufs.begin(), bufs.end(), [](const std::pair<uint64_t, std::shared_ptr<Buffer>> &buf)
+                                  { return buf.second->closed.load(); }),
+                   bufs.end());
+        auto buf = std::make_shared<Buffer>(_bufferSize);
+        {
+            std::lock_guard<std::mutex> lock(_buffersMutex);
+            _buffers.push_back(buf);
+        }
+        bufs.emplace_back(_id, buf);
+        return buf.get();
+    }
+    // 异步文件输出
+    void AsyncFileLogsinker::log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr ev)
     {
-    public:
-        typedef std::shared_ptr<ThreadNameFormatterItem> ptr;
-        ThreadNameFormatterItem(const std::string &str = "") {}
-        virtual void format(std::ostream &osm, Logger::ptr logger, LogLevel::Level lv, LogEvent::ptr ev)
+        if (level < _level_limit)
         {
-            osm << ev->GetThreadName();
+            return;
         }
-
-    private:
-    };
-    // 8.时间日期输出
-    class DateTimeFormatterItem : public Formatter::FormatterItem // 基类
+        if (!_b_has_formatter)
+        {
+            // 还没初始化formatter
+            SetFormatter(logger->GetFormatter());
+        }
+        Formatter::ptr formatter;
+        {
+            // 格式化器可能被SetFormatter(配置重载)替换 锁内拷贝一份 格式化在锁外进行
+            SpinLock::Lock lock(_mutex);
+            formatter = _formatter;
+        }
+        // 格式化到线程局部缓冲区 避免每条日志分配string
+        static thread_local std::string t_msg;
+        t_msg.clear();
+        formatter->formatTo(t_msg, logger, level, ev);
+        append(t_msg.data(), t_msg.size());
+    }
+    bool AsyncFileLogsinker::append(const char *data, size_t len)
     {
-    public:
-        typedef std::shared_ptr<DateTimeFormatterItem> ptr;
-        DateTimeFormatterItem(const std::string &str = "") : _date_time_pattern(str) {}
-        virtual void format(std::ostream &osm, Logger::ptr logger, LogLevel::Level lv, LogEvent::ptr ev)
-        {
-            // 对日期时间格式做处理
-            struct tm tm;
-            time_t time = ev->GetTime();
-            localtime_r(&time, &tm);
-            char buf[64];
-            strftime(buf, sizeof(buf), _date_time_pattern.c_str(), &tm);
-            osm << buf; // buf是格式化处理后的时间日期
+        Buffer *buf = getBuffer();
+        if (len > buf->size)
+        {
+            _dropped++;
+            return false;
         }
-
-    private:
-        std::string _date_time_pattern; // 日期时间输出的格式
-    };
-    // 9.file名字输出
-    class FileNameFormatterItem : public Formatter::FormatterItem // 基类
+        uint64_t tail = buf->tail.load(std::memory_order_relaxed);
+        while (buf->size - (tail - buf->head.load(std::memory_order_acquire)) < len)
+        {
+            // 缓冲区满
+            if (_dropWhenFull || _stop)
+            {
+                _dropped++;
+                return false;
+            }
+            wakeup();
+            std::this_thread::yield();
+        }
+        size_t pos = tail & (buf->size - 1);
+        size_t first = std::min(len, buf->size - pos);
+        memcpy(buf->data + pos, data, first);
+        if (first < len)
+        {
+            memcpy(buf->data, data + first, len - first);
+        }
+        buf->tail.store(tail + len, std::memory_order_release);
+        // 超过一半提前唤醒刷盘线程
+        if (tail + len - buf->head.load(std::memory_order_relaxed) > buf->size / 2)
+        {
+            wakeup();
+        }
+        return true;
+    }
+    void AsyncFileLogsinker::wakeup()
     {
-    public:
-        typedef std::shared_ptr<FileNameFormatterItem> ptr;
-        FileNameFormatterItem(const std::string &str = "") {}
-        virtual void format(std::ostream &osm, Logger::ptr logger, LogLevel::Level lv, LogEvent::ptr ev)
+        if (!_wakeup.exchange(true))
         {
-            osm << ev->FileName();
+            std::lock_guard<std::mutex> lock(_waitMutex);
+            _cond.notify_one();
         }
-
-    private:
-    };
-    // 10.行号输出
-    class LineFormatterItem : public Formatter::FormatterItem // 基类
+    }
+    void AsyncFileLogsinker::flushLoop()
     {
-    public:
-        typedef std::shared_ptr<LineFormatterItem> ptr;
-        LineFormatterItem(const std::string &str = "") {}
-        virtual void format(std::ostream &osm, Logger::ptr logger, LogLevel::Level lv, LogEvent::ptr ev)
+        while (!_stop)
         {
-            osm << ev->GetLine();
+            {
+                std::unique_lock<std::mutex> lock(_waitMutex);
+                _cond.wait_for(lock, std::chrono::milliseconds(_flushInterval), [this]()
+                               { return _wakeup.load() || _stop.load(); });
+            }
+            _wakeup = false;
+            flush();
         }
-
-    private:
-    };
-    // 11.换行输出
-    class NewLineFormatterItem : public Formatter::FormatterItem // 基类
+        flush();
+    }
+    size_t AsyncFileLogsinker::flush()
     {
-    public:
-        typedef std::shared_ptr<NewLineFormatterItem> ptr;
-        NewLineFormatterItem(const std::string &str = "") {}
-        virtual void format(std::ostream &osm, Logger::ptr logger, LogLevel::Level lv, LogEvent::ptr ev)
+        uint64_t now = TimeUitl::NowTime_to_uint64();
+        if (_fd < 0 || now - _lastOpenTime > 3)
         {
-            osm << std::endl;
+            // 定期重新打开文件防止文件被删除 只在刷盘线程中进行
+            reopen();
         }
-
-    private:
-    };
-    // 12.普通字符输出
-    class StringFormatterItem : public Formatter::FormatterItem // 基类
+        std::vector<std::shared_ptr<Buffer>> buffers;
+        {
+            std::lock_guard<std::mutex> lock(_buffersMutex);
+            buffers = _buffers;
+        }
+        // 收集所有线程缓冲区的可读数据 每个缓冲区最多两段
+        std::vector<iovec> iovs;
+        std::vector<uint64_t> tails(buffers.size());
+        size_t total = 0;
+        for (size_t i = 0; i < buffers.size(); i++)
+        {
+            Buffer *buf = buffers[i].get();
+            uint64_t head = buf->head.load(std::memory_order_relaxed);
+            uint64_t tail = buf->tail.load(std::memory_order_acquire);
+            tails[i] = tail;
+            size_t len = tail - head;
+            if (len == 0)
+            {
+                continue;
+            }
+            size_t pos = head & (buf->size - 1);
+            size_t first = std::min(len, buf->size - pos);
+            iovs.push_back({buf->data + pos, first});
+            if (first < len)
+            {
+                iovs.push_back({buf->data, len - first});
+            }
+            total += len;
+        }
+        // 子类的前置数据(在读取各缓冲区写入位置之后生成 能覆盖这些数据引用到的内容)
+        std::string prefix;
+        if (total > 0)
+        {
+            prepareFlush(prefix, _newFile);
+            _newFile = false;
+            if (!prefix.empty())
+            {
+                iovs.insert(iovs.begin(), {(void *)prefix.data(), prefix.size()});
+            }
+        }
+        size_t idx = 0;
+        while (_fd >= 0 && idx < iovs.size())
+        {
+            ssize_t n = ::writev(_fd, &iovs[idx], std::min<size_t>(iovs.size() - idx, IOV_MAX));
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                std::cout << "async log writev failed errno=" << errno << " errstr=" << strerror(errno) << std::endl;
+                break;
+            }
+            _writeCount++;
+            _writtenBytes += n;
+            // 部分写入 跳过已写完的段
+            while (n > 0 && idx < iovs.size())
+            {
+                if ((size_t)n >= iovs[idx].iov_len)
+                {
+                    n -= iovs[idx].iov_len;
+                    idx++;
+                }
+                else
+                {
+                    iovs[idx].iov_base = (char *)iovs[idx].iov_base + n;
+                    iovs[idx].iov_len -= n;
+                    n = 0;
+                }
+            }
+        }
+        if (_fd < 0 && total > 0)
+        {
+            std::cout << "log file open failed" << std::endl;
+        }
+        // 写入失败的数据也一并丢弃 避免日志线程一直阻塞
+        for (size_t i = 0; i < buffers.size(); i++)
+        {
+            buffers[i]->head.store(tails[i], std::memory_order_release);
+        }
+        // 回收已退出线程的缓冲区
+        std::lock_guard<std::mutex> lock(_buffersMutex);
+        _buffers.erase(std::remove_if(_buffers.begin(), _buffers.end(), [](const std::shared_ptr<Buffer> &buf)
+                                      { return buf->exited.load() &&
+                                               buf->head.load() == buf->tail.load(); }),
+                       _buffers.end());
+        return total;
+    }
+    bool AsyncFileLogsinker::reopen()
     {
-    public:
-        typedef std::shared_ptr<StringFormatterItem> ptr;
-        StringFormatterItem(const std::string &str = "") : _string(str) {}
-        virtual void format(std::ostream &osm, Logger::ptr logger, LogLevel::Level lv, LogEvent::ptr ev)
+        if (_fd >= 0)
         {
-            osm << _string;
+            ::close(_fd);
         }
-
-    private:
-        std::string _string;
-    };
-    // 13.Table输出
-    class TabFormatterItem : public Formatter::FormatterItem // 基类
+        _lastOpenTime = TimeUitl::NowTime_to_uint64();
+        std::string dir = FileUtil::DirName(_log_filename);
+        FileUtil::MakeDir(dir);
+        _fd = ::open(_log_filename.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+        struct stat st;
+        if (_fd >= 0 && fstat(_fd, &st) == 0 && st.st_size == 0)
+        {
+            _newFile = true;
+        }
+        return _fd >= 0;
+    }
+    // 格式化操作码的执行辅助函数
+    // 追加无符号整数
+    static inline void AppendUint(std::string &out, uint64_t val)
     {
-    public:
-        typedef std::shared_ptr<TabFormatterItem> ptr;
-        TabFormatterItem(const std::string &str = "") {}
-        virtual void format(std::ostream &osm, Logger::ptr logger, LogLevel::Level lv, LogEvent::ptr ev)
+        char buf[24];
+        auto res = std::to_chars(buf, buf + sizeof(buf), val);
+        out.append(buf, res.ptr - buf);
+    }
+    // 追加格式化后的时间 每个线程按(格式,秒)缓存最近的结果 同一秒内的日志不再调用localtime_r/strftime
+    static inline void AppendDateTime(std::string &out, const std::string &pattern, time_t time)
+    {
+        struct DateTimeCache
+        {
+            std::string pattern; // 时间格式
+            time_t time = -1;    // 秒
+            char buf[64];                         // 格式化结果
+            size_t len = 0;
+        };
+        static thread_local DateTimeCache t_cache[4];
+        static thread_local size_t t_next = 0;
+        for (auto &c : t_cache)
         {
-            osm << "\t";
+            if (c.time == time && c.pattern == pattern)
+            {
+                out.append(c.buf, c.len);
+                return;
+            }
         }
-
-    private:
-    };
+        DateTimeCache &c = t_cache[t_next++ % 4];
+        struct tm tm;
+        localtime_r(&time, &tm);
+        c.len = strftime(c.buf, sizeof(c.buf), pattern.c_str(), &tm);
+        c.pattern = pattern;
+        c.time = time;
+        out.append(c.buf, c.len);
+    }
     Formatter::Formatter(const std::string &fmt_str)
         : _formatter_str(fmt_str), _b_error(false)
     {
@@ -592,67 +878,123 @@ namespace Xten
             // 还有普通字符
             vec.push_back(std::make_tuple(nstr, "", 0));
         }
-        // 遍历所有vec中的tuple生成items
-        // 存放str和生成对应item的映射关系
-        static std::unordered_map<std::string, std::function<FormatterItem::ptr(const std::string &)>> item_map = {
-#define XX(str, item)                                                          \
-    {                                                                          \
-        #str,                                                                  \
-            [](const std::string &fmt) { return std::make_shared<item>(fmt); } \
-    }
-            XX(m, MessageFormatterItem),
-            XX(p, LevelFormatterItem),
-            XX(r, ElapseFormatterItem),
-            XX(c, LoggerNameFormatterItem),
-            XX(t, ThreadIdFormatterItem),
-            XX(n, NewLineFormatterItem),
-            XX(d, DateTimeFormatterItem),
-            XX(f, FileNameFormatterItem),
-            XX(l, LineFormatterItem),
-            XX(T, TabFormatterItem),
-            XX(F, FiberIdFormatterItem),
-            XX(N, ThreadNameFormatterItem)
-#undef XX
-            // 宏函数调用完直接undef
+        // 遍历所有vec中的tuple生成操作码 相邻的普通字符/制表符/换行合并成一个字符串操作
+        static std::unordered_map<std::string, int> op_map = {
+            {"m", OP_MESSAGE},
+            {"p", OP_LEVEL},
+            {"r", OP_ELAPSE},
+            {"c", OP_LOGGER_NAME},
+            {"t", OP_THREAD_ID},
+            {"n", OP_NEWLINE},
+            {"d", OP_DATETIME},
+            {"f", OP_FILE_NAME},
+            {"l", OP_LINE},
+            {"T", OP_TAB},
+            {"F", OP_FIBER_ID},
+            {"N", OP_THREAD_NAME},
+        };
+        auto append_string = [this](const std::string &str)
+        {
+            if (!_ops.empty() && _ops.back().type == OP_STRING)
+            {
+                _ops.back().arg.append(str);
+            }
+            else
+            {
+                _ops.push_back({OP_STRING, str});
+            }
         };
         for (auto &ele : vec)
         {
             if (std::get<2>(ele) == 0) // 说明是普通字符
             {
-                _items.push_back(std::make_shared<StringFormatterItem>(std::get<0>(ele)));
+                append_string(std::get<0>(ele));
+                continue;
+            }
+            auto iter = op_map.find(std::get<0>(ele));
+            if (iter == op_map.end())
+            {
+                // 没找到
+                append_string("<<error_format %" + std::get<0>(ele) + " >>");
+                _b_error = true;
+            }
+            else if (iter->second == OP_TAB)
+            {
+                append_string("\t");
+            }
+            else if (iter->second == OP_NEWLINE)
+            {
+                append_string("\n");
+                _b_newline = true;
             }
             else
-            { // 不是普通字符
-                auto iter = item_map.find(std::get<0>(ele));
-                if (iter != item_map.end())
-                {
-                    // 找到了这个对应的item构造
-                    _items.push_back(item_map[std::get<0>(ele)](std::get<1>(ele)));
-                }
-                else
-                {
-                    // 没找到
-                    _items.push_back(std::make_shared<StringFormatterItem>("<<error_format %" + std::get<0>(ele) + " >>"));
-                    _b_error = true;
-                }
+            {
+                _ops.push_back({iter->second, std::get<1>(ele)});
             }
         }
     }
-    void Formatter::format(std::ostream &out_stream, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr ev) // 向流中输出
+    void Formatter::formatTo(std::string &out, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr ev) // 追加到out
     {
-        for (auto &ele : _items)
+        for (auto &op : _ops)
         {
-            ele->format(out_stream, logger, level, ev);
+            switch (op.type)
+            {
+            case OP_STRING:
+                out.append(op.arg);
+                break;
+            case OP_MESSAGE:
+                out.append(ev->GetContent());
+                break;
+            case OP_LEVEL:
+                out.append(LogLevel::ToString(level));
+                break;
+            case OP_ELAPSE:
+                AppendUint(out, ev->GetElapse());
+                break;
+            case OP_LOGGER_NAME:
+                out.append(ev->GetLogger()->GetName());
+                break;
+            case OP_THREAD_ID:
+                AppendUint(out, ev->GetThreaId());
+                break;
+            case OP_DATETIME:
+                AppendDateTime(out, op.arg, ev->GetTime());
+                break;
+            case OP_FILE_NAME:
+                out.append(ev->FileName());
+                break;
+            case OP_LINE:
+                AppendUint(out, ev->GetLine());
+                break;
+            case OP_FIBER_ID:
+                AppendUint(out, ev->GetFiberId());
+                break;
+            case OP_THREAD_NAME:
+                out.append(ev->GetThreadName());
+                break;
+            default:
+                break;
+            }
         }
     }
-    std::string Formatter::format(std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr ev) // 直接输出字符串
+    void Formatter::format(std::ostream &out_stream, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr ev) // 向流中输出
     {
-        std::stringstream strsm;
-        for (auto &ele : _items)
+        // 先格式化到线程局部缓冲区 再一次写入流
+        static thread_local std::string t_buffer;
+        t_buffer.clear();
+        formatTo(t_buffer, logger, level, ev);
+        out_stream.write(t_buffer.data(), t_buffer.size());
+        if (_b_newline)
         {
-            ele->format(strsm, logger, level, ev);
+            // 与原来的std::endl一致 换行时刷新流
+            out_stream.flush();
         }
-        return strsm.str();
+    }
+    std::string Formatter::format(std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr ev) // 直接输出字符串
+    {
+        std::string str;
+        formatTo(str, logger, level, ev);
+        return str;
     }
     std::string Formatter::getFormatterPattern()
     {
@@ -762,6 +1104,27 @@ namespace Xten
         ss << node;
         return ss.str();
     }
+    std::string AsyncFileLogsinker::toYamlString() // 将配置转化成yaml格式的string
+    {
+        SpinLock::Lock lock(_mutex);
+        YAML::Node node;
+        node["type"] = "AsyncFileLogSinker";
+        node["file"] = _log_filename;
+        node["flush_interval"] = _flushInterval;
+        node["buffer_size"] = _bufferSize;
+        node["policy"] = _dropWhenFull ? "drop" : "block";
+        if (_level_limit != LogLevel::UNKNOW)
+        {
+            node["level"] = LogLevel::ToString(_level_limit);
+        }
+        if (_b_has_formatter && _formatter)
+        {
+            node["formatter"] = _formatter->getFormatterPattern();
+        }
+        std::stringstream ss;
+        ss << node;
+        return ss.str();
+    }
     std::string LoggerManager::toYamlString() // 将配置转化成yaml格式的string
     {
         SpinLock::Lock lock(_mutex);
@@ -782,13 +1145,19 @@ namespace Xten
         std::string _formatter;                          // 日志格式化器字符串---sink级别的
         int _type = SinkType::STDOUT;                    // 日志器的类型
         std::string _file;                               // 文件的话 文件名
+        uint32_t _flushInterval = 1000;                  // 异步文件: 刷盘间隔(ms)
+        uint64_t _bufferSize = 1024 * 1024;              // 异步文件: 每个线程的缓冲区大小
+        bool _dropWhenFull = false;                      // 异步文件: 缓冲区满时丢弃(policy: drop/block)
         bool operator==(const LogSinkerDefine &old) const
         {
             return _name == old._name &&
                    _level_limit == old._level_limit &&
                    _formatter == old._formatter &&
                    _type == old._type &&
-                   _file == old._file;
+                   _file == old._file &&
+                   _flushInterval == old._flushInterval &&
+                   _bufferSize == old._bufferSize &&
+                   _dropWhenFull == old._dropWhenFull;
         }
     };
     struct LoggerDefine
@@ -870,6 +1239,42 @@ namespace Xten
                             lsd._level_limit = LogLevel::ToLevel(a["level"].as<std::string>());
                         }
                     }
+                    else if (type == "AsyncFileLogAppender" || type == "AsyncFileLogSinker" ||
+                             type == "BinaryFileLogAppender" || type == "BinaryFileLogSinker")
+                    {
+                        lsd._type = type.find("Binary") == 0 ? SinkType::BINARY_FILE : SinkType::ASYNC_FILE;
+                        if (!a["file"].IsDefined())
+                        {
+                            std::cout << "log config error: asyncfileappender file is null, " << a
+                                      << std::endl;
+                            continue;
+                        }
+                        lsd._file = a["file"].as<std::string>();
+                        if (a["flush_interval"].IsDefined())
+                        {
+                            lsd._flushInterval = a["flush_interval"].as<uint32_t>();
+                        }
+                        if (a["buffer_size"].IsDefined())
+                        {
+                            lsd._bufferSize = a["buffer_size"].as<uint64_t>();
+                        }
+                        if (a["policy"].IsDefined())
+                        {
+                            lsd._dropWhenFull = a["policy"].as<std::string>() == "drop";
+                        }
+                        if (a["formatter"].IsDefined())
+                        {
+                            lsd._formatter = a["formatter"].as<std::string>();
+                        }
+                        if (a["name"].IsDefined())
+                        {
+                            lsd._name = a["name"].as<std::string>();
+                        }
+                        if (a["level"].IsDefined())
+                        {
+                            lsd._level_limit = LogLevel::ToLevel(a["level"].as<std::string>());
+                        }
+                    }
                     else if (type == "StdoutLogAppender")
                     {
                         lsd._type = SinkType::STDOUT;
@@ -924,6 +1329,14 @@ namespace Xten
                     na["type"] = "FileLogSinker";
                     na["file"] = a._file;
                 }
+                else if (a._type == SinkType::ASYNC_FILE || a._type == SinkType::BINARY_FILE)
+                {
+                    na["type"] = a._type == SinkType::ASYNC_FILE ? "AsyncFileLogSinker" : "BinaryFileLogSinker";
+                    na["file"] = a._file;
+                    na["flush_interval"] = a._flushInterval;
+                    na["buffer_size"] = a._bufferSize;
+                    na["policy"] = a._dropWhenFull ? "drop" : "block";
+                }
                 else if (a._type == SinkType::STDOUT)
                 {
                     na["type"] = "StdoutLogSinker";
@@ -984,6 +1397,10 @@ namespace Xten
                     Xten::Logsinker::ptr ap;
                     if(a._type == SinkType::FILE) {
                         ap.reset(new FileLogsinker(a._file));
+                    } else if(a._type == SinkType::ASYNC_FILE) {
+                        ap.reset(new AsyncFileLogsinker(a._file, a._flushInterval, a._bufferSize, a._dropWhenFull));
+                    } else if(a._type == SinkType::BINARY_FILE) {
+                        ap.reset(new BinaryFileLogsinker(a._file, a._flushInterval, a._bufferSize, a._dropWhenFull));
                     } else if(a._type == SinkType::STDOUT) {
                         if(!Xten::Env::GetInstance()->Has("d")) {
                             //命令行运行
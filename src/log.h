@@ -5,8 +5,11 @@
 #include "util.h"
 #include "mutex.h"
 #include "thread.h"
+#include <atomic>
+#include <condition_variable>
+// 先用日志器缓存的生效级别判断(一次原子读) 被过滤的日志不会构造LogEvent
 #define XTEN_LOG_LEVEL(logger, level)                                                         \
-    if (level >= logger->GetLevelLimit() && logger)                                           \
+    if (logger && logger->IsLevelEnabled(level))                                              \
     Xten::LogEventWrap(std::make_shared<Xten::LogEvent>(logger, level, __FILE__, __LINE__, 0, \
                         Xten::ThreadUtil::GetThreadId(), (uint32_t)Xten::FiberUtil::GetFiberId(), \
                          time(nullptr), Xten::Thread::GetName()))  \
@@ -20,7 +23,7 @@
 
 // 格式化输出日志
 #define XTEN_LOG_FMT_LEVEL(logger, level, fmt, ...)                                           \
-    if (level >= logger->GetLevelLimit() && logger)                                           \
+    if (logger && logger->IsLevelEnabled(level))                                              \
     Xten::LogEventWrap(std::make_shared<Xten::LogEvent>(logger, level, __FILE__, __LINE__, 0, \
                     Xten::ThreadUtil::GetThreadId(), (uint32_t)Xten::FiberUtil::GetFiberId(),       \
                      time(nullptr), Xten::Thread::GetName()))  \
@@ -45,6 +48,8 @@ namespace Xten
     {
         STDOUT = 0,
         FILE = 1,
+        ASYNC_FILE = 2,
+        BINARY_FILE = 3,
     };
     struct LogLevel
     {
@@ -70,13 +75,13 @@ namespace Xten
                  uint32_t elapse, uint32_t thread_id, uint32_t fiber_id, uint64_t time, std::string thread_name);
         std::shared_ptr<Logger> GetLogger();
         LogLevel::Level GetLevel();
-        std::string FileName();
+        const std::string &FileName();
         uint32_t GetLine();
         uint64_t GetElapse();
         uint32_t GetThreaId();
         uint32_t GetFiberId();
         uint64_t GetTime();
-        std::string GetThreadName();
+        const std::string &GetThreadName();
         std::stringstream &GetSStream();   // 获取内容的流--用来保存日志内容
         std::string GetContent();          // 获取内容
         void format(const char *fmt, ...); // 格式化输入日志内容   format("log is %s",aaaaa);
@@ -93,6 +98,7 @@ namespace Xten
         std::stringstream _ss;           // 日志的内容字段输出流
     };
     class Logsinker;
+    struct LogSite;
     // 格式化器
     //  *  %m 消息
     //  *  %p 日志级别
@@ -115,21 +121,36 @@ namespace Xten
         void init();                                                                                                    // 初始化模板
         void format(std::ostream &out_stream, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr ev); // 向流中输出
         std::string format(std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr ev);                    // 直接输出字符串
-        // 格式化items
-        class FormatterItem // 基类
-        {
-        public:
-            typedef std::shared_ptr<FormatterItem> ptr;
-            virtual void format(std::ostream &osm, std::shared_ptr<Logger> logger, LogLevel::Level lv, LogEvent::ptr ev) = 0;
-            virtual ~FormatterItem() {} // 基类析构函数最好为虚函数
-        protected:
-        };
+        void formatTo(std::string &out, std::shared_ptr<Logger> logger, LogLevel::Level level, LogEvent::ptr ev);       // 追加到out(可复用缓冲区)
         std::string getFormatterPattern();
         bool isError();
 
     private:
         std::string _formatter_str;             // 格式化字符串
-        std::vector<FormatterItem::ptr> _items; // 格式化items 根据_formatter_str生成
+        // 格式化操作码 init时由_formatter_str编译生成 相邻的普通字符合并成一个OP_STRING
+        enum OpType
+        {
+            OP_STRING = 0,  // 普通字符(包括%T %n)
+            OP_MESSAGE,     // %m
+            OP_LEVEL,       // %p
+            OP_ELAPSE,      // %r
+            OP_LOGGER_NAME, // %c
+            OP_THREAD_ID,   // %t
+            OP_NEWLINE,     // %n
+            OP_DATETIME,    // %d
+            OP_FILE_NAME,   // %f
+            OP_LINE,        // %l
+            OP_TAB,         // %T
+            OP_FIBER_ID,    // %F
+            OP_THREAD_NAME, // %N
+        };
+        struct Op
+        {
+            int type;        // OpType
+            std::string arg; // 普通字符内容或者时间格式
+        };
+        std::vector<Op> _ops;     // 格式化操作码
+        bool _b_newline = false;  // 是否包含换行(向流输出时刷新)
         bool _b_error;                          // 解析格式是否有错
     };
 
@@ -140,12 +161,23 @@ namespace Xten
         typedef std::shared_ptr<Logger> ptr;
         Logger(const std::string &name = "root");
         void log(LogLevel::Level level, LogEvent::ptr);
+        // 二进制结构化日志(XTEN_LOG_BIN_*) data为编码后的参数
+        void logBinary(const LogSite &site, const char *data, size_t len);
+        // 日志器名字在二进制日志中的id
+        uint32_t GetNameId();
         void SetLevelLimit(LogLevel::Level);
         LogLevel::Level GetLevelLimit();
+        // 该级别的日志是否可能被输出(日志器级别和所有落地类中最低级别的较大者) 日志宏在构造LogEvent前调用
+        bool IsLevelEnabled(LogLevel::Level level) const
+        {
+            return level >= _effectiveLevel.load(std::memory_order_relaxed);
+        }
+        // 重新计算生效级别(已添加的落地类修改级别时自动调用)
+        void RefreshLevelCache();
         void AddSinkers(const std::string &sink_name, std::shared_ptr<Logsinker> sinker);
         void DelSinkers(const std::string &sink_name);
         void ClearSinkers();
-        std::string GetName();
+        const std::string &GetName();
         void info(LogEvent::ptr ev);
         void debug(LogEvent::ptr ev);
         void warn(LogEvent::ptr ev);
@@ -156,12 +188,20 @@ namespace Xten
         void SetFormatter(const char *fmt_str);      // 传入格式化字符串 %d{xxx} %s %g ...
         void SetRootLogger(Logger::ptr root_logger); // 设置主logger
         std::string toYamlString();                  // 将配置转化成yaml格式的string
+    private:
+        void rebuildSnapshot(); // 重建落地类快照(调用方持有锁)
+        void updateLevelCache(); // 重新计算生效级别(调用方持有锁)
+
     private:
         std::string _name;                                                    // 日志名称
         LogLevel::Level _level_limit;                                         // limit日志级别
         std::unordered_map<std::string, std::shared_ptr<Logsinker>> _sinkers; // 所有的日志输出器及其名字
+        // 落地类快照(增删时重建) log时只在锁内拷贝快照 落地在锁外进行
+        std::shared_ptr<std::vector<std::shared_ptr<Logsinker>>> _sinkersSnapshot;
         Formatter::ptr _formatter;                                            // 日志格式化器---logger级别的
         Logger::ptr _root_logger;                                             // 主日志器
+        std::atomic<uint32_t> _nameId{0};                                     // 名字在二进制日志中的id(0表示未注册)
+        std::atomic<int> _effectiveLevel{LogLevel::DEBUG};                    // 生效级别缓存 低于它的日志一定不会输出
         SpinLock _mutex;                                                      // 一把锁（自旋锁） 能保证在多线程情况下logger使用的安全性
     };
     // 日志器落地类
@@ -173,6 +213,8 @@ namespace Xten
         typedef std::shared_ptr<Logsinker> ptr;
         Logsinker(LogLevel::Level level = LogLevel::DEBUG) : _level_limit(level), _b_has_formatter(false),_mutex() {}
         virtual void log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr ev) = 0;
+        // 二进制结构化日志 默认在当前线程还原成文本后调用log
+        virtual void logBinary(Logger::ptr logger, const LogSite &site, const char *data, size_t len);
         virtual std::string toYamlString() = 0; // 将配置转化成yaml格式的string
         bool has_formatter() { return _b_has_formatter; }
         Formatter::ptr GetFormatter()
@@ -189,18 +231,22 @@ namespace Xten
         {
             return _level_limit;
         }
-        void SetLevelLimit(LogLevel::Level level)
-        {
-            SpinLock::Lock lock(_mutex); //
-            _level_limit = level;
-        }
+        // 修改级别 并刷新添加了该落地类的日志器的生效级别
+        void SetLevelLimit(LogLevel::Level level);
         virtual ~Logsinker() {}
 
+    private:
+        // 从添加了该落地类的日志器中移除logger(Logger删除落地类时调用)
+        void delOwner(Logger *logger);
+
     protected:
         SpinLock _mutex;              // 自旋锁
         LogLevel::Level _level_limit; // 每个sinks的日志级别
         std::atomic<bool> _b_has_formatter;        // 是否有格式化器
         Formatter::ptr _formatter;    // 格式化器 --由所属的logger赋值 或者自定义
+
+    private:
+        std::vector<std::weak_ptr<Logger>> _owners; // 添加了该落地类的日志器(级别变化时刷新它们的生效级别)
     };
     // 标准输出落地类
     class StdoutLogsinker : public Logsinker
@@ -229,6 +275,71 @@ namespace Xten
         std::ofstream _file_stream; // 文件流
         ino64_t _last_opentime;     // 上次操作时间
     };
+    // 异步文件输出落地类
+    // 每个写日志的线程有自己的无锁环形缓冲区(单生产者单消费者) 后台刷盘线程按flush_interval
+    // 或缓冲区过半时把所有线程缓冲区的数据用一次writev写入文件 日志线程不再争抢锁和文件流
+    class AsyncFileLogsinker : public Logsinker
+    {
+        friend class Logger;
+
+    public:
+        typedef std::shared_ptr<AsyncFileLogsinker> ptr;
+        // flush_interval: 刷盘间隔(ms) buffer_size: 每个线程的缓冲区大小
+        // drop_when_full: 缓冲区满时丢弃日志(否则阻塞等待刷盘)
+        AsyncFileLogsinker(const std::string &filename, uint32_t flush_interval = 1000,
+                           size_t buffer_size = 1024 * 1024, bool drop_when_full = false);
+        ~AsyncFileLogsinker();
+        virtual void log(Logger::ptr logger, LogLevel::Level level, LogEvent::ptr ev) override;
+        virtual std::string toYamlString() override; // 将配置转化成yaml格式的string
+        // 因缓冲区满(或单条超过缓冲区大小)丢弃的日志条数
+        uint64_t GetDroppedCount() const { return _dropped; }
+        // 已写入文件的字节数
+        uint64_t GetWrittenBytes() const { return _writtenBytes; }
+        // writev调用次数
+        uint64_t GetWriteCount() const { return _writeCount; }
+
+    protected:
+        // 把一条记录写入当前线程的缓冲区(缓冲区满时按策略阻塞或丢弃) 返回是否写入
+        bool append(const char *data, size_t len);
+        // 每次刷盘前调用 prefix中的数据在本次所有缓冲区数据之前写入
+        // new_file: 文件是新建的(为空 比如被删除或轮转后重新打开)
+        virtual void prepareFlush(std::string &prefix, bool new_file) {}
+        // 停止刷盘线程(退出前写完剩余数据) 重写了prepareFlush的子类析构时要先调用
+        void stop();
+
+    private:
+        struct Buffer;
+        // 获取当前线程的缓冲区 第一次使用时创建并登记
+        Buffer *getBuffer();
+        // 刷盘线程函数
+        void flushLoop();
+        // 把所有线程缓冲区的数据写入文件 返回写入字节数
+        size_t flush();
+        // 唤醒刷盘线程
+        void wakeup();
+        // 重新打开文件(文件被删除或轮转)
+        bool reopen();
+
+    private:
+        std::string _log_filename;                     // 文件名 路径+name
+        uint32_t _flushInterval;                       // 刷盘间隔(ms)
+        size_t _bufferSize;                            // 每个线程缓冲区大小(2的幂)
+        bool _dropWhenFull;                            // 缓冲区满时丢弃还是阻塞
+        uint64_t _id;                                  // 唯一id 线程局部缓存用来区分不同的sink
+        int _fd = -1;                                  // 文件描述符(只在刷盘线程中使用)
+        bool _newFile = false;                         // 打开的是空文件 下次刷盘时通知prepareFlush
+        uint64_t _lastOpenTime = 0;                    // 上次打开文件的时间
+        std::mutex _buffersMutex;                      // 保护_buffers
+        std::vector<std::shared_ptr<Buffer>> _buffers; // 所有线程的缓冲区
+        std::mutex _waitMutex;                         // 刷盘线程等待用
+        std::condition_variable _cond;                 // 唤醒刷盘线程
+        std::atomic<bool> _wakeup{false};              // 是否已经请求唤醒
+        std::atomic<bool> _stop{false};                // 停止刷盘线程
+        std::atomic<uint64_t> _dropped{0};             // 丢弃的日志条数
+        std::atomic<uint64_t> _writtenBytes{0};        // 写入的字节数
+        std::atomic<uint64_t> _writeCount{0};          // writev次数
+        Thread::ptr _thread;                           // 刷盘线程
+    };
     // 用于封装event 保证在构造出event的这一行结束的时候会自动进行输出日志 --RAII的思想 临时遍历生命周期为一行 自动析构
     class LogEventWrap
     {
@@ -1,59 +1,733 @@
 #include "objpool.h"
+#include "fiber.h"
 #include "config.h"
 #include "macro.h"
+#include "thread_cache.h"
+#include <atomic>
+#include <sstream>
 namespace Xten
 {
+    static Xten::ConfigVar<uint32_t>::ptr g_objpool_release_threshold =
+        Config::LookUp("objpool.release_threshold_mb", (uint32_t)64, "objpool page heap free memory kept before madvise to os");
 
-    static Xten::ConfigVar<uint32_t>::ptr g_fiber_stack_size =
-        Config::LookUp("fiber.stack_size", (uint32_t)128 * 1024, "fiber stack size");
-    // 定义协程对象池类型
-    // 将 Fiber 放在结构体开头，这样返回的指针可以直接作为 Fiber* 使用
-    template <size_t N>
-    struct FiberType
+    static const size_t s_page_size = 1 << ObjPoolAllocator::PAGE_SHIFT;
+    // 页堆按页数管理的span链表(1~128页) 超过的直接向系统申请
+    static const size_t s_npages = 129;
+    // 大小等级数量
+    static const size_t s_nfreelist = 200;
+    // 页堆的空闲内存超过该值时 释放的span归还系统
+    static std::atomic<size_t> s_release_threshold = {64 * 1024 * 1024};
+
+    struct __ObjPool_Init
+    {
+        __ObjPool_Init()
+        {
+            s_release_threshold = (size_t)g_objpool_release_threshold->GetValue() * 1024 * 1024;
+            g_objpool_release_threshold->AddListener([](const uint32_t &old, const uint32_t &new_value)
+                                                     { s_release_threshold = (size_t)new_value * 1024 * 1024; });
+        }
+    };
+    static __ObjPool_Init __objPoolInit;
+
+    // 分配统计
+    static std::atomic<uint64_t> s_central_fetch = {0};
+    static std::atomic<uint64_t> s_central_release = {0};
+    static std::atomic<uint64_t> s_span_alloc = {0};
+    static std::atomic<uint64_t> s_span_free = {0};
+    static std::atomic<uint64_t> s_large_alloc = {0};
+    static std::atomic<uint64_t> s_system_alloc = {0};
+    static std::atomic<uint64_t> s_system_bytes = {0};
+    static std::atomic<uint64_t> s_free_bytes = {0};
+    static std::atomic<uint64_t> s_released_bytes = {0};
+    static std::atomic<uint64_t> s_release_count = {0};
+
+    static inline void *&NextObj(void *obj)
+    {
+        return *(void **)obj;
+    }
+
+    // 大小等级: 对齐粒度随大小增长 内碎片控制在约10%以内(最小16字节对齐 满足max_align_t)
+    // [1,1024]           16B对齐   64个
+    // [1025,8K]          128B对齐  56个
+    // [8K+1,64K]         1K对齐    56个
+    // [64K+1,256K]       8K对齐    24个
+    struct SizeClass
+    {
+        static inline size_t roundUp(size_t size, size_t align)
+        {
+            return (size + align - 1) & ~(align - 1);
+        }
+        static inline size_t index(size_t size, size_t align_shift)
+        {
+            return ((size + (1 << align_shift) - 1) >> align_shift) - 1;
+        }
+        // 对齐后的大小
+        static inline size_t RoundUp(size_t size)
+        {
+            if (size <= 1024)
+                return roundUp(size, 16);
+            else if (size <= 8 * 1024)
+                return roundUp(size, 128);
+            else if (size <= 64 * 1024)
+                return roundUp(size, 1024);
+            else if (size <= 256 * 1024)
+                return roundUp(size, 8 * 1024);
+            return roundUp(size, s_page_size);
+        }
+        // 空闲链表下标
+        static inline size_t Index(size_t size)
+        {
+            static const size_t group[3] = {64, 56, 56};
+            if (size <= 1024)
+                return index(size, 4);
+            else if (size <= 8 * 1024)
+                return index(size - 1024, 7) + group[0];
+            else if (size <= 64 * 1024)
+                return index(size - 8 * 1024, 10) + group[0] + group[1];
+            return index(size - 64 * 1024, 13) + group[0] + group[1] + group[2];
+        }
+        // 线程缓存与中心缓存一次交换的对象数 [2,512]
+        static inline size_t NumMoveSize(size_t size)
+        {
+            size_t num = ObjPoolAllocator::MAX_BYTES / size;
+            return num < 2 ? 2 : (num > 512 ? 512 : num);
+        }
+        // 中心缓存一次向页堆申请的页数
+        static inline size_t NumMovePage(size_t size)
+        {
+            size_t npage = (NumMoveSize(size) * size) >> ObjPoolAllocator::PAGE_SHIFT;
+            return npage == 0 ? 1 : npage;
+        }
+    };
+
+    // 连续的若干页
+    struct Span
+    {
+        uintptr_t pageId = 0;    // 起始页号
+        size_t n = 0;            // 页数
+        Span *prev = nullptr;    // 双向链表
+        Span *next = nullptr;    // 双向链表
+        void *freeList = nullptr; // 切好的空闲对象
+        size_t useCount = 0;     // 分配给线程缓存的对象数
+        size_t objSize = 0;      // 切分的对象大小
+        bool isUse = false;      // 是否在中心缓存中使用
+        bool released = false;   // 空闲页是否已归还系统
+    };
+
+    // 带头结点的span双向链表
+    struct SpanList
+    {
+        SpanList()
+        {
+            head.prev = &head;
+            head.next = &head;
+        }
+        bool empty() const { return head.next == &head; }
+        Span *begin() { return head.next; }
+        Span *end() { return &head; }
+        void pushFront(Span *span)
+        {
+            span->next = head.next;
+            span->prev = &head;
+            head.next->prev = span;
+            head.next = span;
+        }
+        Span *popFront()
+        {
+            Span *span = head.next;
+            erase(span);
+            return span;
+        }
+        void erase(Span *span)
+        {
+            span->prev->next = span->next;
+            span->next->prev = span->prev;
+            span->prev = span->next = nullptr;
+        }
+        Span head;
+    };
+
+    // 页号到span的两层基数树 叶子按需申请 查询不加锁(只查询自己持有对象所在的span)
+    class PageMap
+    {
+    public:
+        static const size_t LEAF_BITS = 17;
+        static const size_t ROOT_BITS = 48 - ObjPoolAllocator::PAGE_SHIFT - LEAF_BITS;
+        Span *get(uintptr_t id) const
+        {
+            size_t i1 = id >> LEAF_BITS;
+            if (i1 >= (1ull << ROOT_BITS))
+            {
+                return nullptr;
+            }
+            Span **leaf = _root[i1].load(std::memory_order_acquire);
+            return leaf ? leaf[id & ((1ull << LEAF_BITS) - 1)] : nullptr;
+        }
+        // ---需持有页堆锁
+        void set(uintptr_t id, Span *span)
+        {
+            size_t i1 = id >> LEAF_BITS;
+            XTEN_ASSERT(i1 < (1ull << ROOT_BITS));
+            Span **leaf = _root[i1].load(std::memory_order_relaxed);
+            if (!leaf)
+            {
+                leaf = (Span **)SystemCallMemory(sizeof(Span *) << LEAF_BITS);
+                if (!leaf)
+                {
+                    throw std::bad_alloc();
+                }
+                _root[i1].store(leaf, std::memory_order_release);
+            }
+            leaf[id & ((1ull << LEAF_BITS) - 1)] = span;
+        }
+
+    private:
+        std::atomic<Span **> _root[1ull << ROOT_BITS] = {};
+    };
+
+    // 页堆: 按页数组织空闲span 分配时切分 释放时与相邻空闲span合并
+    class PageCache
     {
-        // 大小为一个协程对象+协程栈大小
-        char stack[N];
+    public:
+        static PageCache *GetInstance()
+        {
+            // 不析构 线程退出时仍可能归还内存
+            static PageCache *s_instance = new PageCache;
+            return s_instance;
+        }
+        // 获取k页的span ---需持有锁
+        Span *newSpan(size_t k);
+        // 空闲span归还页堆 ---需持有锁
+        void releaseSpan(Span *span);
+        // 空闲页全部归还系统 ---需持有锁
+        size_t releaseAll();
+        // 对象所在的span
+        Span *mapObjectToSpan(void *obj) const
+        {
+            return _pageMap.get((uintptr_t)obj >> ObjPoolAllocator::PAGE_SHIFT);
+        }
+        Mutex &mutex() { return _mutex; }
+
+    private:
+        // 向系统申请k页(按页大小对齐)
+        void *systemAlloc(size_t k);
+        // 空闲span归还系统(保留地址空间)
+        void releaseToSystem(Span *span);
+
+    private:
+        Mutex _mutex;
+        SpanList _spanLists[s_npages];
+        PageMap _pageMap;
+        ObjPool<Span> _spanPool;
     };
-    // 每个线程都实现一个协程objpool---->有错误：协程的创建和删除可能会跨线程
-    // 解决办法：使用全局对象池+协程锁---性能会下降
-    static ObjPool<FiberType<128 * 1024 + 88>> *t_fiber_objpool = nullptr;
+
+    void *PageCache::systemAlloc(size_t k)
+    {
+        size_t size = k << ObjPoolAllocator::PAGE_SHIFT;
+        // mmap只保证4K对齐 多申请一页后裁掉首尾
+        char *ptr = (char *)SystemCallMemory(size + s_page_size);
+        if (!ptr)
+        {
+            throw std::bad_alloc();
+        }
+        char *aligned = (char *)(((uintptr_t)ptr + s_page_size - 1) & ~(uintptr_t)(s_page_size - 1));
+        if (aligned != ptr)
+        {
+            munmap(ptr, aligned - ptr);
+        }
+        if (aligned + size != ptr + size + s_page_size)
+        {
+            munmap(aligned + size, ptr + size + s_page_size - (aligned + size));
+        }
+        s_system_alloc.fetch_add(1, std::memory_order_relaxed);
+        s_system_bytes.fetch_add(size, std::memory_order_relaxed);
+        return aligned;
+    }
+
+    void PageCache::releaseToSystem(Span *span)
+    {
+        if (span->released)
+        {
+            return;
+        }
+        size_t bytes = span->n << ObjPoolAllocator::PAGE_SHIFT;
+        madvise((void *)(span->pageId << ObjPoolAllocator::PAGE_SHIFT), bytes, MADV_DONTNEED);
+        span->released = true;
+        s_released_bytes.fetch_add(bytes, std::memory_order_relaxed);
+        s_release_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Span *PageCache::newSpan(size_t k)
+    {
+        XTEN_ASSERT(k > 0);
+        if (k > s_npages - 1)
+        {
+            // 大块直接向系统申请 释放时munmap
+            Span *span = _spanPool.New();
+            new (span) Span();
+            span->pageId = (uintptr_t)systemAlloc(k) >> ObjPoolAllocator::PAGE_SHIFT;
+            span->n = k;
+            _pageMap.set(span->pageId, span);
+            return span;
+        }
+        Span *span = nullptr;
+        for (size_t i = k; i < s_npages; i++)
+        {
+            if (!_spanLists[i].empty())
+            {
+                span = _spanLists[i].popFront();
+                break;
+            }
+        }
+        if (!span)
+        {
+            span = _spanPool.New();
+            new (span) Span();
+            span->pageId = (uintptr_t)systemAlloc(s_npages - 1) >> ObjPoolAllocator::PAGE_SHIFT;
+            span->n = s_npages - 1;
+            s_free_bytes.fetch_add(span->n << ObjPoolAllocator::PAGE_SHIFT, std::memory_order_relaxed);
+        }
+        if (span->n > k)
+        {
+            // 切出前k页 剩余部分放回
+            Span *rest = _spanPool.New();
+            new (rest) Span();
+            rest->pageId = span->pageId + k;
+            rest->n = span->n - k;
+            rest->released = span->released;
+            span->n = k;
+            _spanLists[rest->n].pushFront(rest);
+            _pageMap.set(rest->pageId, rest);
+            _pageMap.set(rest->pageId + rest->n - 1, rest);
+        }
+        size_t bytes = k << ObjPoolAllocator::PAGE_SHIFT;
+        s_free_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+        if (span->released)
+        {
+            // 再次使用时由缺页重新分配物理页
+            span->released = false;
+            s_released_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+        }
+        // 使用中的span每一页都建立映射 释放对象时按地址查找
+        for (size_t i = 0; i < k; i++)
+        {
+            _pageMap.set(span->pageId + i, span);
+        }
+        return span;
+    }
+
+    void PageCache::releaseSpan(Span *span)
+    {
+        if (span->n > s_npages - 1)
+        {
+            _pageMap.set(span->pageId, nullptr);
+            size_t bytes = span->n << ObjPoolAllocator::PAGE_SHIFT;
+            munmap((void *)(span->pageId << ObjPoolAllocator::PAGE_SHIFT), bytes);
+            s_system_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+            _spanPool.Delete(span);
+            return;
+        }
+        s_free_bytes.fetch_add(span->n << ObjPoolAllocator::PAGE_SHIFT, std::memory_order_relaxed);
+        span->isUse = false;
+        span->freeList = nullptr;
+        span->useCount = 0;
+        span->objSize = 0;
+        // 合并前后相邻的空闲span 已归还系统的部分只要有一部分没归还 合并后按未归还处理
+        auto merge = [&](Span *other)
+        {
+            if (other->released != span->released)
+            {
+                size_t bytes = (other->released ? other->n : span->n) << ObjPoolAllocator::PAGE_SHIFT;
+                s_released_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+                span->released = false;
+            }
+            if (other->pageId < span->pageId)
+            {
+                span->pageId = other->pageId;
+            }
+            span->n += other->n;
+            _spanLists[other->n].erase(other);
+            _spanPool.Delete(other);
+        };
+        while (true)
+        {
+            Span *prev = _pageMap.get(span->pageId - 1);
+            if (!prev || prev->isUse || prev->n + span->n > s_npages - 1 ||
+                prev->pageId + prev->n != span->pageId)
+            {
+                break;
+            }
+            merge(prev);
+        }
+        while (true)
+        {
+            Span *next = _pageMap.get(span->pageId + span->n);
+            if (!next || next->isUse || next->n + span->n > s_npages - 1 ||
+                next->pageId != span->pageId + span->n)
+            {
+                break;
+            }
+            merge(next);
+        }
+        _spanLists[span->n].pushFront(span);
+        _pageMap.set(span->pageId, span);
+        _pageMap.set(span->pageId + span->n - 1, span);
+        if (s_free_bytes.load(std::memory_order_relaxed) - s_released_bytes.load(std::memory_order_relaxed) >
+            s_release_threshold.load(std::memory_order_relaxed))
+        {
+            releaseToSystem(span);
+        }
+    }
+
+    size_t PageCache::releaseAll()
+    {
+        uint64_t before = s_released_bytes.load(std::memory_order_relaxed);
+        for (size_t i = 1; i < s_npages; i++)
+        {
+            for (Span *span = _spanLists[i].begin(); span != _spanLists[i].end(); span = span->next)
+            {
+                releaseToSystem(span);
+            }
+        }
+        return s_released_bytes.load(std::memory_order_relaxed) - before;
+    }
+
+    // 中心缓存: 每个大小等级一个span链表和一把锁 与线程缓存批量交换对象
+    class CentralCache
+    {
+    public:
+        static CentralCache *GetInstance()
+        {
+            static CentralCache *s_instance = new CentralCache;
+            return s_instance;
+        }
+        // 取最多batch个size大小的对象 返回实际数量
+        size_t fetchRange(void *&start, void *&end, size_t batch, size_t size);
+        // 一串对象归还所在的span 空闲的span归还页堆
+        void releaseList(void *start, size_t size);
+
+    private:
+        // 获取一个有空闲对象的span ---需持有桶锁(申请页时释放)
+        Span *getOneSpan(size_t index, size_t size);
+
+    private:
+        struct Bucket
+        {
+            SpinLock mutex;
+            SpanList spans;
+        };
+        Bucket _buckets[s_nfreelist];
+    };
+
+    Span *CentralCache::getOneSpan(size_t index, size_t size)
+    {
+        Bucket &bucket = _buckets[index];
+        for (Span *span = bucket.spans.begin(); span != bucket.spans.end(); span = span->next)
+        {
+            if (span->freeList)
+            {
+                return span;
+            }
+        }
+        // 向页堆申请时释放桶锁 不阻塞其他线程归还对象
+        bucket.mutex.unlock();
+        PageCache *page_cache = PageCache::GetInstance();
+        Span *span = nullptr;
+        {
+            Mutex::Lock lock(page_cache->mutex());
+            span = page_cache->newSpan(SizeClass::NumMovePage(size));
+            span->isUse = true;
+            span->objSize = size;
+        }
+        s_span_alloc.fetch_add(1, std::memory_order_relaxed);
+        // 切分成对象链表(按地址顺序 提高局部性)
+        char *begin = (char *)(span->pageId << ObjPoolAllocator::PAGE_SHIFT);
+        char *end = begin + (span->n << ObjPoolAllocator::PAGE_SHIFT);
+        span->freeList = begin;
+        char *tail = begin;
+        for (char *cur = begin + size; cur + size <= end; cur += size)
+        {
+            NextObj(tail) = cur;
+            tail = cur;
+        }
+        NextObj(tail) = nullptr;
+        bucket.mutex.lock();
+        bucket.spans.pushFront(span);
+        return span;
+    }
+
+    size_t CentralCache::fetchRange(void *&start, void *&end, size_t batch, size_t size)
+    {
+        size_t index = SizeClass::Index(size);
+        Bucket &bucket = _buckets[index];
+        bucket.mutex.lock();
+        Span *span = getOneSpan(index, size);
+        start = end = span->freeList;
+        size_t n = 1;
+        while (n < batch && NextObj(end))
+        {
+            end = NextObj(end);
+            n++;
+        }
+        span->freeList = NextObj(end);
+        NextObj(end) = nullptr;
+        span->useCount += n;
+        bucket.mutex.unlock();
+        s_central_fetch.fetch_add(1, std::memory_order_relaxed);
+        return n;
+    }
+
+    void CentralCache::releaseList(void *start, size_t size)
+    {
+        size_t index = SizeClass::Index(size);
+        Bucket &bucket = _buckets[index];
+        PageCache *page_cache = PageCache::GetInstance();
+        bucket.mutex.lock();
+        while (start)
+        {
+            void *next = NextObj(start);
+            Span *span = page_cache->mapObjectToSpan(start);
+            XTEN_ASSERT(span && span->objSize == size);
+            NextObj(start) = span->freeList;
+            span->freeList = start;
+            if (--span->useCount == 0)
+            {
+                // span中的对象全部归还 交还页堆
+                bucket.spans.erase(span);
+                bucket.mutex.unlock();
+                {
+                    Mutex::Lock lock(page_cache->mutex());
+                    page_cache->releaseSpan(span);
+                }
+                s_span_free.fetch_add(1, std::memory_order_relaxed);
+                bucket.mutex.lock();
+            }
+            start = next;
+        }
+        bucket.mutex.unlock();
+        s_central_release.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 线程缓存 每个大小等级一个空闲链表(ThreadCacheHolder 线程退出时全部归还中心缓存)
+    struct ThreadCache
+    {
+        struct FreeList
+        {
+            void *head;
+            uint32_t size;
+            uint32_t maxSize; // 慢启动: 每次从中心缓存取满后增长 链表超过后归还一批
+        };
+        FreeList lists[s_nfreelist];
+        bool registered; // 是否已注册线程退出回调
+        bool dead;       // 线程退出后不再缓存
+
+        void *allocate(size_t size)
+        {
+            size_t index = SizeClass::Index(size);
+            FreeList &list = lists[index];
+            if (XTEN_LIKELY(list.head != nullptr))
+            {
+                void *obj = list.head;
+                list.head = NextObj(obj);
+                list.size--;
+                return obj;
+            }
+            return fetchFromCentral(list, SizeClass::RoundUp(size));
+        }
+        void deallocate(void *ptr, size_t size)
+        {
+            size_t index = SizeClass::Index(size);
+            FreeList &list = lists[index];
+            NextObj(ptr) = list.head;
+            list.head = ptr;
+            list.size++;
+            if (XTEN_UNLIKELY(dead))
+            {
+                releaseToCentral(list, SizeClass::RoundUp(size), list.size);
+            }
+            else if (list.size > list.maxSize)
+            {
+                // 慢启动: 只释放不申请的线程(跨线程释放)也逐步增长上限 之后按批归还
+                size_t limit = SizeClass::NumMoveSize(SizeClass::RoundUp(size));
+                if (list.maxSize < limit)
+                {
+                    list.maxSize++;
+                }
+                else
+                {
+                    releaseToCentral(list, SizeClass::RoundUp(size), list.maxSize);
+                }
+            }
+        }
+        void *fetchFromCentral(FreeList &list, size_t size)
+        {
+            size_t limit = SizeClass::NumMoveSize(size);
+            if (list.maxSize == 0)
+            {
+                list.maxSize = 1;
+            }
+            size_t batch = dead ? 1 : std::min<size_t>(list.maxSize, limit);
+            if (batch == list.maxSize && list.maxSize < limit)
+            {
+                list.maxSize++;
+            }
+            void *start = nullptr;
+            void *end = nullptr;
+            size_t n = CentralCache::GetInstance()->fetchRange(start, end, batch, size);
+            if (n > 1)
+            {
+                NextObj(end) = list.head;
+                list.head = NextObj(start);
+                list.size += n - 1;
+            }
+            return start;
+        }
+        void releaseToCentral(FreeList &list, size_t size, size_t count)
+        {
+            void *start = list.head;
+            void *end = start;
+            size_t n = 1; // 至少归还一个
+            for (; n < count && NextObj(end); n++)
+            {
+                end = NextObj(end);
+            }
+            list.head = NextObj(end);
+            NextObj(end) = nullptr;
+            list.size -= n; // 按实际摘下的个数扣减
+            CentralCache::GetInstance()->releaseList(start, size);
+        }
+        void flush()
+        {
+            for (size_t i = 0; i < s_nfreelist; i++)
+            {
+                FreeList &list = lists[i];
+                if (list.head)
+                {
+                    releaseToCentral(list, SizeClass::RoundUp(NextObjSize(i)), list.size);
+                }
+            }
+        }
+        // 下标对应的大小等级(该等级最大的对象)
+        static size_t NextObjSize(size_t index)
+        {
+            if (index < 64)
+                return (index + 1) * 16;
+            index -= 64;
+            if (index < 56)
+                return 1024 + (index + 1) * 128;
+            index -= 56;
+            if (index < 56)
+                return 8 * 1024 + (index + 1) * 1024;
+            index -= 56;
+            return 64 * 1024 + (index + 1) * 8 * 1024;
+        }
+    };
+    static inline ThreadCache &GetThreadCache()
+    {
+        return ThreadCacheHolder<ThreadCache>::Get();
+    }
 
     void *ObjPoolAllocator::Alloc(size_t size)
     {
-        (void)size;
-        if (!t_fiber_objpool)
+        if (size == 0)
+        {
+            size = 1;
+        }
+        if (XTEN_LIKELY(size <= MAX_BYTES))
         {
-            t_fiber_objpool = new ObjPool<FiberType<128 * 1024 + 88>>();
+            return GetThreadCache().allocate(size);
         }
-        return t_fiber_objpool->New();
+        // 大对象直接按页分配
+        size_t k = SizeClass::RoundUp(size) >> PAGE_SHIFT;
+        PageCache *page_cache = PageCache::GetInstance();
+        Span *span = nullptr;
+        {
+            Mutex::Lock lock(page_cache->mutex());
+            span = page_cache->newSpan(k);
+            span->isUse = true;
+            span->objSize = k << PAGE_SHIFT;
+        }
+        s_large_alloc.fetch_add(1, std::memory_order_relaxed);
+        return (void *)(span->pageId << PAGE_SHIFT);
     }
+
     void ObjPoolAllocator::Dealloc(void *ptr, size_t size)
     {
-        (void)size;
-        XTEN_ASSERT(t_fiber_objpool);
-        t_fiber_objpool->Delete((FiberType<128 * 1024 + 88> *)ptr);
+        if (!ptr)
+        {
+            return;
+        }
+        if (size == 0)
+        {
+            size = 1;
+        }
+        if (XTEN_LIKELY(size <= MAX_BYTES))
+        {
+            GetThreadCache().deallocate(ptr, size);
+            return;
+        }
+        PageCache *page_cache = PageCache::GetInstance();
+        Span *span = page_cache->mapObjectToSpan(ptr);
+        XTEN_ASSERT(span);
+        Mutex::Lock lock(page_cache->mutex());
+        page_cache->releaseSpan(span);
+    }
+
+    size_t ObjPoolAllocator::ReleaseFreeMemory()
+    {
+        PageCache *page_cache = PageCache::GetInstance();
+        Mutex::Lock lock(page_cache->mutex());
+        return page_cache->releaseAll();
+    }
+
+    void ObjPoolAllocator::FlushThreadCache()
+    {
+        GetThreadCache().flush();
+    }
+
+    ObjPoolAllocator::Stats ObjPoolAllocator::GetStats()
+    {
+        Stats stats;
+        stats.centralFetch = s_central_fetch.load(std::memory_order_relaxed);
+        stats.centralRelease = s_central_release.load(std::memory_order_relaxed);
+        stats.spanAlloc = s_span_alloc.load(std::memory_order_relaxed);
+        stats.spanFree = s_span_free.load(std::memory_order_relaxed);
+        stats.largeAlloc = s_large_alloc.load(std::memory_order_relaxed);
+        stats.systemAlloc = s_system_alloc.load(std::memory_order_relaxed);
+        stats.systemBytes = s_system_bytes.load(std::memory_order_relaxed);
+        stats.freeBytes = s_free_bytes.load(std::memory_order_relaxed);
+        stats.releasedBytes = s_released_bytes.load(std::memory_order_relaxed);
+        stats.releaseCount = s_release_count.load(std::memory_order_relaxed);
+        return stats;
     }
 
     // interface
     Fiber *NewFiberFromObjPool(size_t stack_size, std::function<void()> func)
     {
-        stack_size = 128 * 1024; // 固定栈大小
         void *ptr = ObjPoolAllocator::Alloc(sizeof(Fiber) + stack_size);
         return new (ptr) Fiber(stack_size, func, false); // placement new
     }
     void FreeFiberToObjPool(Fiber *ptr)
     {
+        size_t stack_size = ptr->_stack_size;
         ptr->~Fiber();
-        ObjPoolAllocator::Dealloc(ptr, sizeof(Fiber) + ptr->_stack_size);
+        ObjPoolAllocator::Dealloc(ptr, sizeof(Fiber) + stack_size);
     }
 
     std::string FiberObjPoolInfo()
     {
-        if (t_fiber_objpool)
-        {
-            return "ObjPool Fiber hit:" + std::to_string(t_fiber_objpool->s_objpool_hit_counter) +
-                   " free:" + std::to_string(t_fiber_objpool->s_objpool_free_counter) +
-                   " mmap_syscall:" + std::to_string(t_fiber_objpool->s_mmap_syscall_counter)+"\n";
-        }
+        ObjPoolAllocator::Stats stats = ObjPoolAllocator::GetStats();
+        std::stringstream ss;
+        ss << "ObjPool central fetch:" << stats.centralFetch
+           << " central release:" << stats.centralRelease
+           << " span alloc:" << stats.spanAlloc
+           << " span free:" << stats.spanFree
+           << " large alloc:" << stats.largeAlloc << "\n"
+           << "ObjPool system alloc:" << stats.systemAlloc
+           << " system bytes:" << stats.systemBytes
+           << " free bytes:" << stats.freeBytes
+           << " released bytes:" << stats.releasedBytes
+           << " release count:" << stats.releaseCount << "\n";
+        return ss.str();
     }
-}
\ No newline at end of file
+}
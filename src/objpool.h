@@ -1,14 +1,15 @@
 #ifndef __XTEN_OBJPOOL_H__
 #define __XTEN_OBJPOOL_H__
-#include "fiber.h"
 #include <sys/mman.h>
-#include "log.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <new>
 #include "nocopyable.hpp"
 #include "mutex.h"
 namespace Xten
 {
-    static Logger::ptr g_logger = XTEN_LOG_NAME("system");
-#define MMAP_SIZE 132 * 1024 * 20 // 20个协程的空间
+#define MMAP_SIZE 128 * 1024 // 定长对象池一次向系统申请的空间
     // 定义linux平台向os申请堆空间的函数
     inline void *SystemCallMemory(size_t size)
     {
@@ -20,28 +21,25 @@ namespace Xten
 #endif
         return ptr;
     }
-    // 非线程安全对象池模板类-----使用空闲链表实现
+    // 定长对象池模板类-----使用空闲链表实现 申请的空间不归还系统
+    // 只用于分配器内部的元数据(Span) 业务对象使用ObjPoolAllocator
     template <class T>
     class ObjPool : public NoCopyable
     {
     public:
-        friend std::string FiberObjPoolInfo();
         typedef Mutex MutexType;
         ObjPool();
-        ~ObjPool();
+        ~ObjPool() = default;
         // 返回一个对象的指针
         T *New();
         // 释放一个指针指向的对象
         void Delete(T *ptr);
 
     private:
-        char *_memory;                       // 指向可用内存空间
-        size_t _freeCapacity;                // 剩余空间大小
-        void *_freeList;                     // 空闲链表管理上层释放的空间
-        MutexType _mutex;                    // 对象池锁
-        uint32_t s_mmap_syscall_counter = 0; // mmap次数
-        uint32_t s_objpool_hit_counter = 0;  // 对象池命中次数
-        uint32_t s_objpool_free_counter = 0; // 对象池未命中次数
+        char *_memory;        // 指向可用内存空间
+        size_t _freeCapacity; // 剩余空间大小
+        void *_freeList;      // 空闲链表管理上层释放的空间
+        MutexType _mutex;     // 对象池锁
     };
 
     template <class T>
@@ -51,12 +49,6 @@ namespace Xten
           _freeList(nullptr)
     {
     }
-    template <class T>
-    ObjPool<T>::~ObjPool()
-    {
-        // 析构定长内存池需要保证内存都已经释放----暂时不考虑，因为上层应用层会一直使用
-        XTEN_LOG_INFO(g_logger) << "ObjPool<T>::~ObjPool()" << std::endl;
-    }
     // 返回一个对象的指针
     template <class T>
     T *ObjPool<T>::New()
@@ -69,18 +61,15 @@ namespace Xten
             // 拿到下一个内存块地址
             obj = (T *)_freeList;
             _freeList = *((void **)_freeList);
-            s_objpool_hit_counter++;
         } // 无回收空间
         else
         {
             size_t objSize = sizeof(T) > sizeof(void *) ? sizeof(T) : sizeof(void *);
             if (_freeCapacity < objSize) // 这一块空间的剩余空间不足一个对象(剩余的空间不会被利用，内部碎片问题)
             {
-                _freeCapacity = MMAP_SIZE; // 一次开辟20个协程的空间
-                // 重新开辟空间
+                _freeCapacity = objSize > MMAP_SIZE ? objSize : MMAP_SIZE;
                 // 原来的空间都被应用层使用，后续归还到空闲链表继续使用，无需关心释放问题
                 _memory = (char *)SystemCallMemory(_freeCapacity);
-                s_mmap_syscall_counter++;
                 if (_memory == nullptr) // failed
                     throw std::bad_alloc();
             }
@@ -99,21 +88,91 @@ namespace Xten
         // 2.归还空间到空闲链表---头插
         *((void **)ptr) = _freeList;
         _freeList = ptr;
-        s_objpool_free_counter++;
     }
 
+    /// @brief 按大小分级的通用内存分配器(tcmalloc结构)
+    /// 线程缓存(每个大小等级一个空闲链表 无锁) -> 中心缓存(每个大小等级一把锁 与线程缓存批量交换)
+    /// -> 页堆(按页管理span 合并相邻空闲页 空闲页超过阈值时madvise归还系统)
+    /// 超过MAX_BYTES的对象直接从页堆按页分配 释放时必须传入申请时的大小
     class ObjPoolAllocator
     {
     public:
+        // 线程缓存/中心缓存管理的最大对象
+        static const size_t MAX_BYTES = 256 * 1024;
+        // 页大小
+        static const size_t PAGE_SHIFT = 13;
+        // 分配统计
+        struct Stats
+        {
+            uint64_t centralFetch = 0;   // 线程缓存从中心缓存批量获取的次数
+            uint64_t centralRelease = 0; // 线程缓存批量归还中心缓存的次数
+            uint64_t spanAlloc = 0;      // 中心缓存从页堆获取span的次数
+            uint64_t spanFree = 0;       // span归还页堆的次数
+            uint64_t largeAlloc = 0;     // 超过MAX_BYTES直接按页分配的次数
+            uint64_t systemAlloc = 0;    // 向系统申请内存(mmap)的次数
+            uint64_t systemBytes = 0;    // 当前向系统申请的内存
+            uint64_t freeBytes = 0;      // 页堆中的空闲内存(包含已归还系统的)
+            uint64_t releasedBytes = 0;  // 页堆中已归还系统(madvise)的空闲内存
+            uint64_t releaseCount = 0;   // 归还系统的次数
+        };
         static void *Alloc(size_t size);
         static void Dealloc(void *ptr, size_t size);
+        // 页堆中所有空闲页归还系统 返回归还的字节数
+        static size_t ReleaseFreeMemory();
+        // 当前线程缓存全部归还中心缓存
+        static void FlushThreadCache();
+        static Stats GetStats();
+    };
+
+    // 继承后对象的new/delete使用ObjPoolAllocator
+    struct ObjPoolObject
+    {
+        static void *operator new(size_t size)
+        {
+            return ObjPoolAllocator::Alloc(size);
+        }
+        static void operator delete(void *ptr, size_t size)
+        {
+            ObjPoolAllocator::Dealloc(ptr, size);
+        }
     };
 
+    // 标准库分配器适配(容器节点/allocate_shared)
+    template <class T>
+    struct ObjPoolStlAllocator
+    {
+        typedef T value_type;
+        ObjPoolStlAllocator() noexcept = default;
+        template <class U>
+        ObjPoolStlAllocator(const ObjPoolStlAllocator<U> &) noexcept {}
+        T *allocate(size_t n)
+        {
+            return (T *)ObjPoolAllocator::Alloc(n * sizeof(T));
+        }
+        void deallocate(T *ptr, size_t n)
+        {
+            ObjPoolAllocator::Dealloc(ptr, n * sizeof(T));
+        }
+        template <class U>
+        bool operator==(const ObjPoolStlAllocator<U> &) const noexcept { return true; }
+        template <class U>
+        bool operator!=(const ObjPoolStlAllocator<U> &) const noexcept { return false; }
+    };
+
+    // 对象和shared_ptr控制块一起从ObjPoolAllocator分配
+    template <class T, class... Args>
+    inline std::shared_ptr<T> ObjPoolMakeShared(Args &&...args)
+    {
+        return std::allocate_shared<T>(ObjPoolStlAllocator<T>(), std::forward<Args>(args)...);
+    }
+
+    class Fiber;
     // interface -----> 性能反而下降？？？服了
     Fiber *NewFiberFromObjPool(size_t stack_size, std::function<void()> func);
     void FreeFiberToObjPool(Fiber *ptr);
 
+    // 分配器统计信息
     std::string FiberObjPoolInfo();
 } // namespace Xten
 
-#endif
\ No newline at end of file
+#endif
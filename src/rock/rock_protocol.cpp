@@ -1,6 +1,7 @@
 #include "rock_protocol.h"
 #include "../log.h"
 #include "../config.h"
+#include "../objpool.h"
 #include "../streams/zlib_stream.h"
 #include <sstream>
 namespace Xten
@@ -45,7 +46,7 @@ namespace Xten
     // 根据请求的字段创建对应的响应
     std::shared_ptr<RockResponse> RockRequest::CreateResponse()
     {
-        std::shared_ptr<RockResponse> rsp = std::make_shared<RockResponse>();
+        std::shared_ptr<RockResponse> rsp = ObjPoolMakeShared<RockResponse>();
         rsp->SetCmd(_cmd);
         rsp->SetSn(_sn);
         return rsp;
@@ -259,7 +260,7 @@ namespace Xten
     Message::ptr RockMessageDecoder::ParseFromStream(Stream::ptr stream)
     {
         RockMsgHead head;
-        ByteArray::ptr ba = std::make_shared<ByteArray>();
+        ByteArray::ptr ba;
         do
         {
             // 先读取rock头
@@ -286,6 +287,8 @@ namespace Xten
                 XTEN_LOG_ERROR(g_logger) << "RockMessageDecoder parse head found body length is invaild";
                 break;
             }
+            // body按长度一次申请连续缓冲区 读入和解析都不跨节点(初始容量封顶 不足时倍增)
+            ba = std::make_shared<ByteArray>(std::min<size_t>(head.length, 1024 * 1024), true);
             // 长度合法，读取指定长度的数据
             if (stream->ReadFixSize(ba, head.length) <= 0)
             {
@@ -318,10 +321,10 @@ namespace Xten
             switch (type)
             {
             case Message::MessageType::REQUEST:
-                msg = std::make_shared<RockRequest>();
+                msg = ObjPoolMakeShared<RockRequest>();
                 break;
             case Message::MessageType::RESPONSE:
-                msg = std::make_shared<RockResponse>();
+                msg = ObjPoolMakeShared<RockResponse>();
                 break;
             case Message::MessageType::NOTIFY:
                 msg = std::make_shared<RockNotify>();
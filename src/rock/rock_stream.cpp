@@ -3,6 +3,7 @@
 #include "../util.h"
 #include "../iomanager.h"
 #include "../config.h"
+#include "../objpool.h"
 
 #if ROCK_CATEGORY == SYNC
 namespace Xten
@@ -252,7 +253,7 @@ namespace Xten
                 break;
             }
             // 3.超时则request一下，成功直接返回
-            RockRequest::ptr req = std::make_shared<RockRequest>();
+            RockRequest::ptr req = ObjPoolMakeShared<RockRequest>();
             req->SetCmd(0); // 心跳请求
             req->SetData("ping");
             RockResult::ptr result = conn->Request(req);
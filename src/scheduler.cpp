@@ -2,19 +2,56 @@
 #include "macro.h"
 #include "hook.h"
 #include "log.h"
+#include "config.h"
+#include "util.h"
+#include <algorithm>
 namespace Xten
 {
 	static Logger::ptr g_logger = XTEN_LOG_NAME("system");
+#if OPTIMIZE == ON
+	static ConfigVar<uint32_t>::ptr g_scheduler_local_queue_size =
+		Config::LookUp("scheduler.local_queue_size", (uint32_t)4096, "scheduler per thread lock-free queue capacity");
+	// 每取多少次任务优先检查一次全局注入队列(防止本地队列一直有任务导致注入队列饥饿)
+	static const uint32_t s_inject_check_interval = 61;
+	static thread_local uint32_t t_fetch_tick = 0;	 // 线程取任务次数
+	static thread_local uint32_t t_steal_seed = 0;	 // 线程随机窃取种子
+	static thread_local uint32_t t_high_streak = 0;	 // 线程连续执行高优先级任务次数
+	static ConfigVar<uint32_t>::ptr g_scheduler_high_burst =
+		Config::LookUp("scheduler.priority.high_burst", (uint32_t)32, "max consecutive high priority tasks before lower classes get a turn");
+	static ConfigVar<uint32_t>::ptr g_scheduler_low_max_wait =
+		Config::LookUp("scheduler.priority.low_max_wait_ms", (uint32_t)100, "low priority task wait time before it is promoted");
+	static uint32_t s_high_burst = 32;
+	static uint32_t s_low_max_wait_ms = 100;
+	struct __SchedulerPriority_Init
+	{
+		__SchedulerPriority_Init()
+		{
+			s_high_burst = g_scheduler_high_burst->GetValue();
+			s_low_max_wait_ms = g_scheduler_low_max_wait->GetValue();
+			g_scheduler_high_burst->AddListener([](const uint32_t &old, const uint32_t &new_value)
+												{ s_high_burst = new_value; });
+			g_scheduler_low_max_wait->AddListener([](const uint32_t &old, const uint32_t &new_value)
+												  { s_low_max_wait_ms = new_value; });
+		}
+	};
+	static __SchedulerPriority_Init __schedulerPriorityInit;
+	// 在任务协程中执行任务记录中的回调 执行完(或者抛出异常)后回收记录
+	static void RunTaskNode(TaskNode *task)
+	{
+		struct Releaser
+		{
+			TaskNode *task;
+			~Releaser() { TaskNode::Delete(task); }
+		} releaser{task};
+		task->func();
+	}
+#endif
 
 	static thread_local Scheduler *t_scheduler = nullptr;	// 线程所属协程调度器
 	static thread_local Fiber *t_scheduler_fiber = nullptr; // 线程的调度协程
 	static thread_local int t_queue_index = -1;				// 线程的队列所在下标
 	Scheduler::Scheduler(int threadNum, bool use_caller, const std::string &name)
 		: _name(name), _threads_num(threadNum)
-#if OPTIMIZE == ON
-		  ,
-		  _queueSizes(threadNum) // 只指定大小，不指定初始值
-#endif
 	{
 		XTEN_ASSERTINFO(_threads_num > 0, "scheduler threads num<0");
 		if (use_caller)
@@ -36,14 +73,11 @@ namespace Xten
 		}
 #if OPTIMIZE == ON
 		_localQueues.resize(threadNum);
-		_localMtx.resize(threadNum);
-		for (auto &item : _queueSizes)
-		{
-			item.store(0);
-		}
-		for (int i = 0; i < _localMtx.size(); i++)
+		_pinnedQueues.resize(threadNum);
+		for (int i = 0; i < threadNum; i++)
 		{
-			_localMtx[i] = std::make_unique<Xten::RWMutex>();
+			_localQueues[i] = std::make_unique<WorkStealQueue<TaskNode *>>(g_scheduler_local_queue_size->GetValue());
+			_pinnedQueues[i] = std::make_unique<PinnedQueue>();
 		}
 		if (use_caller)
 		{
@@ -58,7 +92,37 @@ namespace Xten
 		if (GetThis() == this) // 这个执行析构的线程的所属协程调度器是该调度器
 		{
 			t_scheduler = nullptr; // 置空便于下次继续创建归属调度器
+#if OPTIMIZE == ON
+			t_queue_index = -1;
+#endif
+		}
+#if OPTIMIZE == ON
+		// 释放未被执行的任务(正常停止时队列都为空)
+		TaskNode *task = nullptr;
+		for (size_t i = 0; i < _localQueues.size(); i++)
+		{
+			while (_localQueues[i]->Steal(task))
+			{
+				TaskNode::Delete(task);
+			}
+			for (auto pinned : _pinnedQueues[i]->tasks)
+			{
+				TaskNode::Delete(pinned);
+			}
+		}
+		for (auto inject : _injectQueue)
+		{
+			TaskNode::Delete(inject);
 		}
+		for (auto &high : _highQueue)
+		{
+			TaskNode::Delete(high.task);
+		}
+		for (auto &low : _lowQueue)
+		{
+			TaskNode::Delete(low.second);
+		}
+#endif
 	}
 	// 启动
 	void Scheduler::Start()
@@ -98,11 +162,11 @@ namespace Xten
 		Xten::set_hook_enable(true);
 #if OPTIMIZE == ON
 		// 设置当前线程的队列index
-		if (t_queue_index == -1)
 		{
 			RWMutex::ReadLock rlock(_mapMtx);
 			t_queue_index = _threadIdToIndex[Xten::ThreadUtil::GetThreadId()];
 		}
+		t_steal_seed = (uint32_t)Xten::ThreadUtil::GetThreadId() * 2654435761u + 1;
 		XTEN_LOG_DEBUG(g_logger) << "thread: " << Xten::ThreadUtil::GetThreadId() << " ,index: " << t_queue_index;
 #endif
 		// 设置当前线程的调度协程
@@ -115,13 +179,15 @@ namespace Xten
 		Fiber::ptr idle_fiber = std::shared_ptr<Fiber>(NewFiber(0, std::bind(&Scheduler::Idle, this), false), FreeFiber);
 		// 任务协程
 		Fiber::ptr cb_fiber;
+#if OPTIMIZE == OFF
 		FuncOrFiber fcb; // Task
+#endif
 		while (true)
 		{
-			fcb.Reset();
 			bool tickle_me = false;
 			bool is_active = false;
 #if OPTIMIZE == OFF
+			fcb.Reset();
 			{
 				RWMutex::WriteLock lock(_mutex); // 加一把全局锁保证多线程访问任务队列的线程安全（锁的粒度是比较大的）
 				auto iter = _fun_fibers.begin();
@@ -152,90 +218,25 @@ namespace Xten
 				tickle_me |= !_fun_fibers.empty();
 			}
 #elif OPTIMIZE == ON
-			int currentQueueIndex = t_queue_index;
 			XTEN_ASSERTINFO(t_queue_index != -1, "thread queue index not init");
-			// 1.从自己线程队列中获取任务
+			TaskNode *fcb = fetchTask(t_queue_index, tickle_me);
+			if (fcb)
 			{
-				RWMutex::WriteLock wlock(*_localMtx[currentQueueIndex]);
-				if (_localQueues[currentQueueIndex].empty())
-				{
-					// 当前队列没有任务
-					is_active = false;
-				}
-				else
+				if (fcb->fiber && fcb->fiber->GetStatus() == Fiber::Status::EXEC)
 				{
-					fcb = _localQueues[currentQueueIndex].front();
-					_localQueues[currentQueueIndex].pop_front();
-					if (--_queueSizes[currentQueueIndex] > 0)
-					{
-						tickle_me |= true;
-					}
-					_localHits++;
-					is_active = true;
-					_active_threadNum++;
-				}
-			}
-			// 2.自己队列未获取到任务，尝试窃取任务
-			if (!is_active)
-			{
-				_stealAttempts++;
-				// 选择任务最多的队列进行窃取
-				int bestQueue = -1;
-				size_t max = 0;
-				// 筛选出符合条件队列下标
-				for (int i = 0; i < _queueSizes.size(); i++)
-				{
-					if (i == currentQueueIndex)
-					{
-						continue;
-					}
-					size_t curcount = _queueSizes[i].load();
-					if (curcount > max && curcount > 1)
-					{
-						tickle_me = true;
-						max = curcount;
-						bestQueue = i;
-					}
-				}
-				if (bestQueue != -1)
-				{
-					// 找到目的窃取队列
-					RWMutex::WriteLock wlock(*_localMtx[bestQueue]);
-					auto iter = _localQueues[bestQueue].rbegin();
-					while (iter != _localQueues[bestQueue].rend())
-					{
-						if (iter->threadId == -1)
-						{
-							// 可以窃取该任务
-							fcb = *iter;
-							_localQueues[bestQueue].erase(std::next(iter).base());
-							_queueSizes[bestQueue]--;
-							is_active = true;
-							_active_threadNum++;
-							_steals++;
-							iter++;
-							break;
-						}
-						else
-						{
-							// 这个任务指定了就是在当前队列执行 不能窃取
-							iter++;
-							continue;
-						}
-					}
-				}
-				else
-				{
-					// 窃取失败
-					tickle_me |= false;
-					is_active = false;
+					// 协程被其他线程重新放入队列时还未切出(仍处于执行状态) 放回队列稍后再执行
+					enqueue(fcb, true);
+					continue;
 				}
+				_active_threadNum++;
+				is_active = true;
 			}
 #endif
 			if (tickle_me) // 通知
 			{
 				Tickle();
 			}
+#if OPTIMIZE == OFF
 			// 任务类型是fiber
 			if (fcb.fiber && fcb.fiber->GetStatus() != Fiber::Status::EXCEPT &&
 				fcb.fiber->GetStatus() != Fiber::Status::TERM)
@@ -270,11 +271,63 @@ namespace Xten
 				// 切入执行协程任务
 				int tid = fcb.threadId;
 				fcb.Reset();
+#elif OPTIMIZE == ON
+			// 任务类型是fiber
+			if (fcb && fcb->fiber && fcb->fiber->GetStatus() != Fiber::Status::EXCEPT &&
+				fcb->fiber->GetStatus() != Fiber::Status::TERM)
+			{
+				fcb->fiber->SwapIn(); // 切入执行工作协程
+				_active_threadNum--;
+				if (fcb->fiber->GetStatus() == Fiber::Status::READY)
+				{
+					// 主动让出的协程放到全局注入队列尾部 让本地队列的其他任务先执行
+					// 直接复用任务记录 协程引用随记录转移
+					enqueue(fcb, true);
+				}
+				else
+				{
+					if (fcb->fiber->GetStatus() != Fiber::Status::TERM &&
+						fcb->fiber->GetStatus() != Fiber::Status::EXCEPT)
+					{
+						// 状态设置成挂起状态 ----执行条件不满足
+						fcb->fiber->_status = Fiber::Status::HOLD;
+					}
+					TaskNode::Delete(fcb);
+				}
+			}
+			// 任务类型是cb
+			else if (fcb && fcb->func)
+			{
+				// 回调仍然存放在任务记录中 由任务协程执行完后回收记录
+				// lambda只捕获一个指针 std::function内部存放 不需要malloc
+				int tid = fcb->threadId;
+				uint8_t priority = fcb->priority;
+				uint64_t deadline = fcb->deadline;
+				auto runner = [fcb]()
+				{ RunTaskNode(fcb); };
+				if (cb_fiber) // 使用上次回收协程
+				{
+					cb_fiber->Reset(runner);
+				}
+				else
+				{
+					// 上一个任务协程被挂起无法复用 从协程栈池取(线程本地缓存命中时无mmap)
+					cb_fiber.reset(NewFiber(0, runner, false), FreeFiber);
+				}
+				// 切入执行协程任务
+#endif
 				cb_fiber->SwapIn();
 				_active_threadNum--;
 				if (cb_fiber->GetStatus() == Fiber::Status::READY)
 				{
+#if OPTIMIZE == OFF
 					Schedule(cb_fiber, tid);
+#elif OPTIMIZE == ON
+					TaskNode *node = TaskNode::New(std::move(cb_fiber), tid);
+					node->priority = priority;
+					node->deadline = deadline;
+					enqueue(node, true);
+#endif
 					// 智能指针置空 ---协程不能回收使用
 					cb_fiber.reset();
 				}
@@ -296,6 +349,9 @@ namespace Xten
 			{
 				if (is_active)
 				{ // 基本不会走到这里
+#if OPTIMIZE == ON
+					TaskNode::Delete(fcb); // 协程任务已经终止
+#endif
 					_active_threadNum--;
 					continue;
 				}
@@ -344,9 +400,22 @@ namespace Xten
 			os << _thread_ids[i];
 		}
 #if OPTIMIZE == ON
-		os << "[Localqueue hit Sum: " << _localHits << " ] "
+		os << std::endl
+		   << "    [Localqueue hit Sum: " << _localHits << " ] "
+		   << "[Injectqueue hit Sum: " << _injectHits << " ] "
 		   << "[Attempt steal Task Sum: " << _stealAttempts << " ] "
-		   << "[Success steal Task Sum: " << _steals << " ]";
+		   << "[Success steal Task Sum: " << _steals << " ]" << std::endl
+		   << "    [TaskFunc heap fallback Sum: " << TaskFunc::GetHeapFallbackCount() << " ]" << std::endl
+		   << "    [Injectqueue size: " << _injectSize << " ] [Localqueue size:";
+		for (size_t i = 0; i < _localQueues.size(); ++i)
+		{
+			os << " " << _localQueues[i]->Size() << "/" << _pinnedQueues[i]->size;
+		}
+		os << " ]" << std::endl
+		   << "    [Priority high size: " << _highSize << " run: " << _highRuns
+		   << " deadline miss: " << _deadlineMisses << " burst yield: " << _highYields << " ] "
+		   << "[Priority low size: " << _lowSize << " run: " << _lowRuns
+		   << " promote: " << _lowPromotes << " ]";
 #endif
 		return os;
 	}
@@ -375,6 +444,15 @@ namespace Xten
 	{
 		return t_scheduler_fiber;
 	}
+	// 返回当前线程的队列下标
+	int Scheduler::GetQueueIndex()
+	{
+#if OPTIMIZE == ON
+		return t_queue_index;
+#else
+		return -1;
+#endif
+	}
 
 	// 通知线程有任务 ---子类实现
 	void Scheduler::Tickle()
@@ -390,11 +468,10 @@ namespace Xten
 		return _stopping && _auto_stopping &&
 			   _fun_fibers.empty() && !_active_threadNum;
 #elif OPTIMIZE == ON
-		bool allEmpty = true;
-		for (int i = 0; i < _localQueues.size(); i++)
+		bool allEmpty = (_injectSize == 0 && _highSize == 0 && _lowSize == 0);
+		for (size_t i = 0; i < _localQueues.size() && allEmpty; i++)
 		{
-			RWMutex::ReadLock rlock(*_localMtx[i]);
-			allEmpty &= _localQueues[i].empty();
+			allEmpty &= (_localQueues[i]->Empty() && _pinnedQueues[i]->size == 0);
 		}
 		return _stopping && _auto_stopping &&
 			   allEmpty && !_active_threadNum;
@@ -453,6 +530,7 @@ namespace Xten
 #if OPTIMIZE == ON
 		// 输出整个任务的执行情况
 		XTEN_LOG_INFO(g_logger) << "[Localqueue hit Sum: " << _localHits << " ] "
+								<< "[Injectqueue hit Sum: " << _injectHits << " ] "
 								<< "[Attempt steal Task Sum: " << _stealAttempts << " ] "
 								<< "[Success steal Task Sum: " << _steals << " ]";
 #endif
@@ -472,6 +550,346 @@ namespace Xten
 	{
 		return _idle_threadNum > 0;
 	}
+	// 返回当前线程是否有可以执行的任务
+	bool Scheduler::HasPendingTask()
+	{
+#if OPTIMIZE == OFF
+		RWMutex::ReadLock lock(_mutex);
+		return !_fun_fibers.empty();
+#elif OPTIMIZE == ON
+		if (_injectSize > 0 || _highSize > 0 || _lowSize > 0)
+		{
+			return true;
+		}
+		if (t_queue_index != -1 && _pinnedQueues[t_queue_index]->size > 0)
+		{
+			return true;
+		}
+		// 其他线程本地队列的任务可以被窃取
+		for (size_t i = 0; i < _localQueues.size(); i++)
+		{
+			if (!_localQueues[i]->Empty())
+			{
+				return true;
+			}
+		}
+		return false;
+#endif
+	}
+#if OPTIMIZE == ON
+	int Scheduler::queueIndexOf(int threadId)
+	{
+		// threadId总是LWP id(容器的pid命名空间中LWP id可能很小 不能当作下标)
+		if (threadId < 0)
+		{
+			return -1;
+		}
+		RWMutex::ReadLock rlock(_mapMtx);
+		auto it = _threadIdToIndex.find(threadId);
+		return it == _threadIdToIndex.end() ? -1 : it->second;
+	}
+	void Scheduler::enqueue(TaskNode *task, bool yield)
+	{
+		if (task->threadId == -1 && task->fiber)
+		{
+			// 共享栈协程只能回到绑定线程执行(未绑定为-1)
+			task->threadId = task->fiber->GetBoundThread();
+		}
+		// threadId保持调用方传入的LWP id 重新入队时再次查表
+		int pinned = queueIndexOf(task->threadId);
+		// 1.指定了执行线程
+		if (pinned != -1)
+		{
+			PinnedQueue &queue = *_pinnedQueues[pinned];
+			SpinLock::Lock lock(queue.mutex);
+			queue.tasks.push_back(task);
+			queue.size++;
+			return;
+		}
+		// 高/低优先级任务放入优先级队列
+		if (task->priority != PRIORITY_NORMAL)
+		{
+			enqueuePriority(task);
+			return;
+		}
+		// 2.本调度器的线程放入自己的无锁队列
+		if (!yield && t_scheduler == this && t_queue_index != -1)
+		{
+			if (_localQueues[t_queue_index]->Push(task))
+			{
+				return;
+			}
+		}
+		// 3.其他线程或本地队列已满或主动让出 放入全局注入队列
+		SpinLock::Lock lock(_injectMtx);
+		_injectQueue.push_back(task);
+		_injectSize++;
+	}
+	void Scheduler::enqueueBatch(TaskNode **tasks, size_t count)
+	{
+		// 已绑定线程的共享栈协程逐个放入绑定线程的队列
+		size_t remain = 0;
+		for (size_t i = 0; i < count; i++)
+		{
+			if (tasks[i]->threadId == -1 && tasks[i]->fiber && tasks[i]->fiber->GetBoundThread() != -1)
+			{
+				enqueue(tasks[i]);
+				continue;
+			}
+			tasks[remain++] = tasks[i];
+		}
+		if (remain == 0)
+		{
+			return;
+		}
+		count = remain;
+		int pinned = queueIndexOf(tasks[0]->threadId);
+		// 1.指定了执行线程
+		if (pinned != -1)
+		{
+			PinnedQueue &queue = *_pinnedQueues[pinned];
+			SpinLock::Lock lock(queue.mutex);
+			for (size_t i = 0; i < count; i++)
+			{
+				queue.tasks.push_back(tasks[i]);
+			}
+			queue.size += count;
+			return;
+		}
+		// 2.本调度器的线程放入自己的无锁队列
+		size_t pushed = 0;
+		if (t_scheduler == this && t_queue_index != -1)
+		{
+			pushed = _localQueues[t_queue_index]->PushBatch(tasks, count);
+			if (pushed == count)
+			{
+				return;
+			}
+		}
+		// 3.剩余的放入全局注入队列
+		SpinLock::Lock lock(_injectMtx);
+		_injectQueue.insert(_injectQueue.end(), tasks + pushed, tasks + count);
+		_injectSize += count - pushed;
+	}
+	TaskNode *Scheduler::popInjectTask()
+	{
+		if (_injectSize == 0)
+		{
+			return nullptr;
+		}
+		SpinLock::Lock lock(_injectMtx);
+		if (_injectQueue.empty())
+		{
+			return nullptr;
+		}
+		TaskNode *task = _injectQueue.front();
+		_injectQueue.pop_front();
+		_injectSize--;
+		_injectHits++;
+		return task;
+	}
+	TaskNode *Scheduler::stealTask(int index)
+	{
+		int n = (int)_localQueues.size();
+		if (n <= 1)
+		{
+			return nullptr;
+		}
+		_stealAttempts++;
+		// xorshift随机选择起始窃取对象 避免所有线程同时窃取同一队列
+		t_steal_seed ^= t_steal_seed << 13;
+		t_steal_seed ^= t_steal_seed >> 17;
+		t_steal_seed ^= t_steal_seed << 5;
+		int start = (int)(t_steal_seed % (uint32_t)n);
+		TaskNode *task = nullptr;
+		for (int i = 0; i < n; i++)
+		{
+			int victim = (start + i) % n;
+			if (victim == index)
+			{
+				continue;
+			}
+			WorkStealQueue<TaskNode *> &queue = *_localQueues[victim];
+			// 窃取失败可能是与其他线程竞争 队列不为空则重试
+			while (!queue.Empty())
+			{
+				if (queue.Steal(task))
+				{
+					_steals++;
+					return task;
+				}
+			}
+		}
+		return nullptr;
+	}
+	void Scheduler::setPriority(TaskNode *task, Priority priority, uint64_t deadline_ms)
+	{
+		task->priority = (uint8_t)priority;
+		task->deadline = deadline_ms ? Xten::TimeUitl::GetCurrentMS() + deadline_ms : 0;
+	}
+	void Scheduler::enqueuePriority(TaskNode *task)
+	{
+		if (task->priority == PRIORITY_HIGH)
+		{
+			SpinLock::Lock lock(_highMtx);
+			_highQueue.push_back({task->deadline ? task->deadline : UINT64_MAX, _highSeq++, task});
+			std::push_heap(_highQueue.begin(), _highQueue.end());
+			_highSize++;
+			return;
+		}
+		uint64_t now = Xten::TimeUitl::GetCurrentMS();
+		SpinLock::Lock lock(_lowMtx);
+		_lowQueue.push_back(std::make_pair(now, task));
+		_lowSize++;
+	}
+	TaskNode *Scheduler::popHighTask()
+	{
+		if (_highSize == 0)
+		{
+			return nullptr;
+		}
+		TaskNode *task = nullptr;
+		{
+			SpinLock::Lock lock(_highMtx);
+			if (_highQueue.empty())
+			{
+				return nullptr;
+			}
+			std::pop_heap(_highQueue.begin(), _highQueue.end());
+			task = _highQueue.back().task;
+			_highQueue.pop_back();
+			_highSize--;
+		}
+		_highRuns++;
+		if (task->deadline && Xten::TimeUitl::GetCurrentMS() > task->deadline)
+		{
+			_deadlineMisses++;
+		}
+		return task;
+	}
+	TaskNode *Scheduler::popLowTask(bool aged_only)
+	{
+		if (_lowSize == 0)
+		{
+			return nullptr;
+		}
+		uint64_t now = aged_only ? Xten::TimeUitl::GetCurrentMS() : 0;
+		TaskNode *task = nullptr;
+		{
+			SpinLock::Lock lock(_lowMtx);
+			if (_lowQueue.empty())
+			{
+				return nullptr;
+			}
+			if (aged_only && now < _lowQueue.front().first + s_low_max_wait_ms)
+			{
+				return nullptr;
+			}
+			task = _lowQueue.front().second;
+			_lowQueue.pop_front();
+			_lowSize--;
+		}
+		_lowRuns++;
+		if (aged_only)
+		{
+			_lowPromotes++;
+		}
+		return task;
+	}
+	TaskNode *Scheduler::fetchTask(int index, bool &tickle_me)
+	{
+		TaskNode *task = nullptr;
+		PinnedQueue &pinned = *_pinnedQueues[index];
+		bool high_yield = false; // 本次让出高优先级
+		// 1.定期优先检查全局注入队列
+		if (++t_fetch_tick % s_inject_check_interval == 0)
+		{
+			task = popInjectTask();
+		}
+		// 2.指定在本线程执行的任务
+		if (!task && pinned.size > 0)
+		{
+			SpinLock::Lock lock(pinned.mutex);
+			if (!pinned.tasks.empty())
+			{
+				task = pinned.tasks.front();
+				pinned.tasks.pop_front();
+				pinned.size--;
+			}
+		}
+		// 3.等待超时的低优先级任务(防止饿死)
+		if (!task)
+		{
+			task = popLowTask(true);
+		}
+		// 4.高优先级任务 连续执行达到上限时让其他任务先执行一次
+		if (!task && _highSize > 0)
+		{
+			if (t_high_streak < s_high_burst)
+			{
+				task = popHighTask();
+				if (task)
+				{
+					t_high_streak++;
+				}
+			}
+			else
+			{
+				high_yield = true;
+			}
+		}
+		if (!task || task->priority != PRIORITY_HIGH)
+		{
+			t_high_streak = 0;
+		}
+		// 5.本地无锁队列
+		if (!task && _localQueues[index]->Pop(task))
+		{
+			_localHits++;
+		}
+		// 6.全局注入队列
+		if (!task)
+		{
+			task = popInjectTask();
+		}
+		// 7.窃取其他线程任务
+		if (!task)
+		{
+			task = stealTask(index);
+		}
+		// 8.低优先级任务
+		if (!task)
+		{
+			task = popLowTask(false);
+		}
+		if (high_yield)
+		{
+			if (task)
+			{
+				_highYields++;
+			}
+			else
+			{
+				// 没有其他任务 继续执行高优先级任务
+				task = popHighTask();
+			}
+		}
+		// 还有可以被其他线程执行的任务 通知空闲线程
+		if (!_localQueues[index]->Empty() || _injectSize > 0 || _highSize > 0 || _lowSize > 0)
+		{
+			tickle_me = true;
+		}
+		// 有指定其他线程执行的任务 通知(唤醒目标线程)
+		for (size_t i = 0; i < _pinnedQueues.size() && !tickle_me; i++)
+		{
+			if ((int)i != index && _pinnedQueues[i]->size > 0)
+			{
+				tickle_me = true;
+			}
+		}
+		return task;
+	}
+#endif
 
 	// 协程任务切换器 --切换协程任务运行的调度器
 	SwitchScheduler::SwitchScheduler(Scheduler *target)
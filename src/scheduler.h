@@ -8,8 +8,10 @@
 #include <list>
 #include <atomic>
 #include "macro.h"
-#include <random>
 #include <vector>
+#include <deque>
+#include "work_steal_queue.h"
+#include "task.h"
 #define OFF 0
 #define ON 1
 // #ifndef OPTIMIZE
@@ -22,12 +24,13 @@ namespace Xten
     {
     public:
         typedef std::shared_ptr<Scheduler> ptr;
-        // 任务分配策略
-        enum DistributePolicy
+        // 任务优先级 对于 OPTIMIZE=OFF 忽略优先级按FIFO执行
+        enum Priority
         {
-            ROUND_ROBIN,  // 轮询分配
-            LEAST_LOADED, // 最少队列分配
-            RANDOM        // 随机分配
+            PRIORITY_HIGH = 0,   // 延迟敏感任务 按截止时间(EDF)排序 没有截止时间的排在最后(FIFO)
+            PRIORITY_NORMAL = 1, // 普通任务(Schedule默认)
+            PRIORITY_LOW = 2,    // 后台批量任务 没有其他任务时执行 等待超时后提升
+            PRIORITY_COUNT
         };
         // 默认让创建线程参与协程调度
         Scheduler(int threadNum = 1, bool use_caller = true, const std::string &name = "");
@@ -39,14 +42,19 @@ namespace Xten
         // 放任务  Task表示任务类型  1.fiber::ptr  2.std::function
         // Task &&task 这里的 T&&是万能引用 ---只有在模板类型推导的情况下才是万能引用（否则是普通右值引用）
         // 引用折叠规则 传入左值--左值引用   传入右值--右值引用
-        // 对于 OPTIMIZE=ON threadId为线程的下标[use_caller 0 thread_0 1 thread_2 1 ....] or [thread_0 0 thread_1 1 thread_2 2 ....]
-        // 对于 OPTIMIZE=OFF threadId为线程的LWP进程id
+        // threadId为线程的LWP进程id(OPTIMIZE=ON时在调度器内部转换成队列下标 不是本调度器的线程则不指定)
+        // sharedStack: 回调任务在共享栈协程中执行(协程任务的栈模式在创建时决定 忽略该参数)
         template <class Task>
-        void Schedule(Task &&task, int threadId = -1)
+        void Schedule(Task &&task, int threadId = -1, bool sharedStack = false)
         {
+            if (sharedStack)
+            {
+                Schedule(toSharedStackTask(std::forward<Task>(task)), threadId);
+                return;
+            }
             bool tickle_me = false;
-            FuncOrFiber fcb(std::forward<Task>(task), threadId); // 这里的forward完美转发是必须的 保持原始语义
 #if OPTIMIZE == OFF
+            FuncOrFiber fcb(std::forward<Task>(task), threadId); // 这里的forward完美转发是必须的 保持原始语义
             {
                 RWMutex::WriteLock lock(_mutex);
                 if (_fun_fibers.empty())
@@ -58,27 +66,41 @@ namespace Xten
                 // _fun_fibers.enqueue(fcb);
             }
 #elif OPTIMIZE == ON
-            int bestQueue = selectBestQueue(threadId);
-            tickle_me = true;
-            XTEN_ASSERT((fcb.fiber != nullptr || fcb.func != nullptr));
-            {
-                // 向bestQueue队列中放入任务
-                RWMutex::WriteLock lock(*_localMtx[bestQueue]);
-                for (int i = 0; i < _queueSizes.size(); i++)
-                {
-                    tickle_me &= (_queueSizes[i].load() == 0);
-                }
-                _localQueues[bestQueue].push_back(fcb);
-                _queueSizes[bestQueue]++;
-            }
+            // 任务记录从线程本地空闲链表获取 小的回调直接存放在记录内部 不需要malloc
+            TaskNode *fcb = TaskNode::New(std::forward<Task>(task), threadId);
+            XTEN_ASSERT((fcb->fiber != nullptr || fcb->func != nullptr));
+            // 任务放入线程本地无锁队列/全局注入队列/指定线程队列
+            enqueue(fcb);
+            // 入队(release)与读取空闲线程数之间需要全屏障 与Run中_idle_threadNum++后Idle复查任务队列配对
+            // 否则两边可能同时看不到对方的写入 造成唤醒丢失
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            tickle_me = HasIdleThread();
 #endif
             if (tickle_me)
             {
                 Tickle();
             }
         }
-        // 对于 OPTIMIZE=ON threadId为线程的下标[use_caller 0 thread_0 1 thread_2 1 ....] or [thread_0 0 thread_1 1 thread_2 2 ....]
-        // 对于 OPTIMIZE=OFF threadId为线程的LWP进程id
+        // 按优先级放任务 deadline_ms为相对截止时间(毫秒 0表示没有)
+        // 协程让出后重新入队仍保持原优先级和截止时间 指定了执行线程的任务在线程队列中FIFO执行
+        template <class Task>
+        void SchedulePriority(Task &&task, Priority priority, uint64_t deadline_ms = 0, int threadId = -1)
+        {
+#if OPTIMIZE == OFF
+            Schedule(std::forward<Task>(task), threadId);
+#elif OPTIMIZE == ON
+            TaskNode *fcb = TaskNode::New(std::forward<Task>(task), threadId);
+            XTEN_ASSERT((fcb->fiber != nullptr || fcb->func != nullptr));
+            setPriority(fcb, priority, deadline_ms);
+            enqueue(fcb);
+            std::atomic_thread_fence(std::memory_order_seq_cst); // 同Schedule
+            if (HasIdleThread())
+            {
+                Tickle();
+            }
+#endif
+        }
+        // threadId为线程的LWP进程id(OPTIMIZE=ON时在调度器内部转换成队列下标 不是本调度器的线程则不指定)
         template <class InputIterator>
         void Schedule(InputIterator begin, InputIterator end, int threadId = -1)
         {
@@ -100,24 +122,27 @@ namespace Xten
                 }
             }
 #elif OPTIMIZE == ON
-            int bestQueue = selectBestQueue(threadId);
-            tickle_me = true;
+            // 一批任务在同一个临界区内放入目标队列 最后只通知一次
+            TaskNode *batch[BATCH_SCHEDULE_SIZE];
+            size_t count = 0;
+            while (begin != end)
             {
-                // 向bestQueue队列中放入任务
-                RWMutex::WriteLock lock(*_localMtx[bestQueue]);
-                for (int i = 0; i < _queueSizes.size(); i++)
-                {
-                    tickle_me &= (_queueSizes[i].load() == 0);
-                }
-                while (begin != end)
+                TaskNode *fcb = TaskNode::New(std::move(*begin), threadId);
+                XTEN_ASSERT((fcb->fiber != nullptr || fcb->func != nullptr));
+                batch[count++] = fcb;
+                if (count == BATCH_SCHEDULE_SIZE)
                 {
-                    FuncOrFiber fcb(std::move(*begin), threadId);
-                    XTEN_ASSERT((fcb.fiber != nullptr || fcb.func != nullptr));
-                    _localQueues[bestQueue].push_back(fcb);
-                    _queueSizes[bestQueue]++;
-                    begin++;
+                    enqueueBatch(batch, count);
+                    count = 0;
                 }
+                begin++;
             }
+            if (count)
+            {
+                enqueueBatch(batch, count);
+            }
+            std::atomic_thread_fence(std::memory_order_seq_cst); // 同Schedule
+            tickle_me = HasIdleThread();
 #endif
             if (tickle_me)
             {
@@ -127,7 +152,7 @@ namespace Xten
         // 获取name
         std::string GetName() const;
         // 输出调度器状态信息
-        std::ostream &dump(std::ostream &os) const;
+        virtual std::ostream &dump(std::ostream &os) const;
         // 切换执行线程
         void SwitchTo(int threadId = -1);
 
@@ -135,8 +160,19 @@ namespace Xten
         static Scheduler *GetThis();
         // 返回当前线程的调度协程
         static Fiber *GetScheduleFiber();
+        // 返回当前线程在所属调度器中的队列下标(不是调度线程返回-1)
+        static int GetQueueIndex();
 
     protected:
+        // 回调包装成共享栈协程
+        static Fiber::ptr toSharedStackTask(const Fiber::ptr &fiber) { return fiber; }
+        static Fiber::ptr toSharedStackTask(Fiber::ptr &&fiber) { return std::move(fiber); }
+        template <class F, class = typename std::enable_if<
+                               !std::is_convertible<F, Fiber::ptr>::value>::type>
+        static Fiber::ptr toSharedStackTask(F &&func)
+        {
+            return Fiber::ptr(NewSharedStackFiber(std::function<void()>(std::forward<F>(func))), FreeFiber);
+        }
         // 通知线程有任务
         virtual void Tickle();
         // 线程运行函数
@@ -149,8 +185,11 @@ namespace Xten
         void SetThis();
         // 返回是否有空闲线程
         bool HasIdleThread();
+        // 返回当前线程是否有可以执行的任务(阻塞等待前检查)
+        bool HasPendingTask();
 
     private:
+#if OPTIMIZE == OFF
         /// @brief 任务队列的事件实体 支持两种方式放入事件  1.回调函数  2.协程
         struct FuncOrFiber
         {
@@ -210,13 +249,14 @@ namespace Xten
             {
                 fiber = fb;
                 func = nullptr;
-                threadId = id;
+                // 共享栈协程只能回到绑定线程执行
+                threadId = (id == -1 && fiber) ? fiber->GetBoundThread() : id;
             }
             FuncOrFiber(Xten::Fiber::ptr &&fb, int id = -1) // 右值引用
             {
                 fiber.swap(fb); // 外部为nullptr
                 func = nullptr;
-                threadId = id;
+                threadId = (id == -1 && fiber) ? fiber->GetBoundThread() : id;
             }
             void Reset()
             {
@@ -230,117 +270,50 @@ namespace Xten
             Xten::Fiber::ptr fiber;     // 协程
             int threadId = -1;          // 任务指定的线程id
         };
-#if OPTIMIZE == ON
-        // 挑选合适的队列
-        int selectBestQueue(int threadId)
-        {
-            if (threadId != -1 && threadId < _localQueues.size())
-            {
-                // 指定了执行线程
-                return threadId;
-            }
-            // 未指定(根据不同的分配策略执行不同分配)
-            switch (_policy)
-            {
-            case DistributePolicy::ROUND_ROBIN:
-            {
-                size_t index = _roundRobinCounter.fetch_add(1) % _localQueues.size();
-                return static_cast<int>(index);
-            }
-            break;
-            case DistributePolicy::RANDOM:
-            {
-                static thread_local std::random_device rd;
-                static thread_local std::mt19937 gen(rd());
-                std::uniform_int_distribution<> dis(0, _localQueues.size() - 1);
-                return dis(gen);
-            }
-            break;
-            case DistributePolicy::LEAST_LOADED:
-            default:
-            {
-                int bestQueue = 0;
-                size_t min = _queueSizes[0].load();
-                for (size_t i = 1; i < _queueSizes.size(); i++)
-                {
-                    size_t cur = _queueSizes[i].load();
-                    if (min > cur)
-                    {
-                        // 找到了更少任务队列
-                        min = cur;
-                        bestQueue = i;
-                    }
-                }
-                return bestQueue;
-            }
-            break;
-            }
-            return 0;
-        }
+#elif OPTIMIZE == ON
+        // 任务记录使用TaskNode(task.h) 小对象优化+线程本地空闲链表回收
+        // 将Schedule传入的线程标识(队列下标或者LWP id)转换成队列下标 未指定或无效返回-1
+        int queueIndexOf(int threadId); // LWP id转换成队列下标(不是本调度器的线程返回-1)
+        // 任务入队 yield表示主动让出的任务(放入全局注入队列尾部 避免饿死本地队列中的其他任务)
+        void enqueue(TaskNode *task, bool yield = false);
+        // 批量入队(同一批任务指定的线程相同) 每个目标队列只加一次锁
+        void enqueueBatch(TaskNode **tasks, size_t count);
+        // 当前线程按 [指定线程队列->本地队列->全局注入队列->窃取] 的顺序获取一个任务
+        TaskNode *fetchTask(int index, bool &tickle_me);
+        // 从全局注入队列获取任务
+        TaskNode *popInjectTask();
+        // 随机选择其他线程队列窃取任务
+        TaskNode *stealTask(int index);
+        // 设置任务优先级和截止时间
+        static void setPriority(TaskNode *task, Priority priority, uint64_t deadline_ms);
+        // 放入高/低优先级队列
+        void enqueuePriority(TaskNode *task);
+        // 从高优先级队列取截止时间最早的任务
+        TaskNode *popHighTask();
+        // 从低优先级队列取任务 aged_only表示只取等待超时的任务
+        TaskNode *popLowTask(bool aged_only);
 
-    public:
-        // 进行定期的自动负载均衡
-        void autoLoadBalance()
+        // 批量调度时一次放入队列的最大任务数
+        static const size_t BATCH_SCHEDULE_SIZE = 256;
+        // 指定了执行线程的任务队列(不能被窃取 任意线程都可以放入 需要加锁)
+        struct PinnedQueue
         {
-            // 1.找到任务最多和最少的队列
-            int maxQueue = -1;
-            int minQueue = -1;
-            size_t maxTask = _queueSizes[0].load();
-            size_t minTask = maxTask;
-            for (int i = 1; i < _queueSizes.size(); i++)
+            SpinLock mutex;
+            std::deque<TaskNode *> tasks;
+            std::atomic<size_t> size = {0};
+        };
+        // 高优先级队列元素 按 [截止时间 入队序号] 排序的最小堆
+        struct HighEntry
+        {
+            uint64_t deadline; // 没有截止时间为UINT64_MAX
+            uint64_t seq;      // 入队序号 截止时间相同时FIFO
+            TaskNode *task;
+            bool operator<(const HighEntry &rhs) const
             {
-                size_t cur = _queueSizes[i].load();
-                if (cur > maxTask)
-                {
-                    maxQueue = i;
-                    maxTask = cur;
-                    continue;
-                }
-                if (cur < minTask)
-                {
-                    minQueue = i;
-                    minTask = cur;
-                    continue;
-                }
+                // std::push_heap是最大堆 反向比较
+                return deadline != rhs.deadline ? deadline > rhs.deadline : seq > rhs.seq;
             }
-            // 判断差值是否大于阈值
-            if (maxQueue > -1 && minQueue > -1 && maxTask - minTask > 10)
-            {
-                // 进行负载均衡
-                std::vector<FuncOrFiber> tasks;
-                tasks.reserve(5);
-                {
-                    RWMutex::WriteLock wlock(*_localMtx[maxQueue]);
-                    auto it = _localQueues[maxQueue].rbegin();
-                    size_t moved = 0;
-                    while (it != _localQueues[maxQueue].rend() && moved < 5)
-                    {
-                        // 检查任务是否指定了特定线程执行
-                        if (it->threadId == -1)
-                        { // 只移动未指定线程的任务
-                            tasks.push_back(*it);
-                            it = std::reverse_iterator(_localQueues[maxQueue].erase(std::next(it).base()));
-                            _queueSizes[maxQueue]--;
-                            moved++;
-                        }
-                        else
-                        {
-                            ++it;
-                        }
-                    }
-                }
-                // 移动到最闲队列
-                if (!tasks.empty())
-                {
-                    RWMutex::WriteLock wlock(*_localMtx[minQueue]);
-                    for (auto &task : tasks)
-                    {
-                        _localQueues[minQueue].push_back(task);
-                        _queueSizes[minQueue]++;
-                    }
-                }
-            }
-        }
+        };
 
 #endif
     private:
@@ -348,24 +321,36 @@ namespace Xten
         std::vector<Xten::Thread::ptr> _threads; // 工作线程
 #if OPTIMIZE == OFF
         // 性能优化点---多线程对这个任务队列的操作需要加全局锁（锁的粒度比较大:考虑使用  多个任务队列 + 任务窃取 ）
-        std::list<FuncOrFiber> _fun_fibers; // 任务队列
+        std::list<FuncOrFiber, ObjPoolStlAllocator<FuncOrFiber>> _fun_fibers; // 任务队列(结点从ObjPoolAllocator分配)
         // moodycamel::ConcurrentQueue<FuncOrFiber> _fun_fibers; //任务队列---无锁优化
         Xten::RWMutex _mutex;               // 任务队列互斥锁
 #elif OPTIMIZE == ON
-    public:
-        // 使用多线程多任务队列+任务窃取进行优化
-        std::unordered_map<int, int> _threadIdToIndex;            // 线程id与队列下标映射关系
-        Xten::RWMutex _mapMtx;                                    // 保证这个映射map的线程安全
-        std::vector<std::list<FuncOrFiber>> _localQueues;         // 线程本地队列
-        std::vector<std::unique_ptr<Xten::RWMutex>> _localMtx;    // 线程本地锁
-        DistributePolicy _policy = DistributePolicy::ROUND_ROBIN; // 分配策略（默认轮询分配策略）
-        std::vector<std::atomic<size_t>> _queueSizes;             // 每个队列的负载情况
-        std::atomic<size_t> _roundRobinCounter = {0};             // 轮询分配的计数器
+        // 多任务队列+任务窃取: 每个线程一个有界无锁Chase-Lev队列 + 全局注入队列 + 指定线程队列
+        std::unordered_map<int, int> _threadIdToIndex;                            // 线程id与队列下标映射关系
+        Xten::RWMutex _mapMtx;                                                    // 保证这个映射map的线程安全
+        std::vector<std::unique_ptr<WorkStealQueue<TaskNode *>>> _localQueues;    // 线程本地无锁队列(所属线程push/pop 其他线程steal)
+        std::vector<std::unique_ptr<PinnedQueue>> _pinnedQueues;                  // 指定线程执行的任务队列
+        std::deque<TaskNode *> _injectQueue;                                      // 全局注入队列(非调度线程放入的任务 本地队列满溢出的任务)
+        Xten::SpinLock _injectMtx;                                                // 全局注入队列锁
+        std::atomic<size_t> _injectSize = {0};                                    // 全局注入队列任务数量
+        std::vector<HighEntry> _highQueue;                                        // 高优先级任务(EDF最小堆)
+        Xten::SpinLock _highMtx;                                                  // 高优先级队列锁
+        std::atomic<size_t> _highSize = {0};                                      // 高优先级任务数量
+        uint64_t _highSeq = 0;                                                    // 高优先级入队序号
+        std::deque<std::pair<uint64_t, TaskNode *>> _lowQueue;                    // 低优先级任务 [入队时间 任务]
+        Xten::SpinLock _lowMtx;                                                   // 低优先级队列锁
+        std::atomic<size_t> _lowSize = {0};                                       // 低优先级任务数量
 
         // 工作统计
         std::atomic<uint64_t> _localHits = {0};     // 本地队列命中总数
+        std::atomic<uint64_t> _injectHits = {0};    // 全局注入队列命中总数
         std::atomic<uint64_t> _steals = {0};        // 窃取成功任务数量
         std::atomic<uint64_t> _stealAttempts = {0}; // 尝试窃取次数
+        std::atomic<uint64_t> _highRuns = {0};       // 高优先级任务执行数
+        std::atomic<uint64_t> _lowRuns = {0};        // 低优先级任务执行数
+        std::atomic<uint64_t> _deadlineMisses = {0}; // 超过截止时间才执行的高优先级任务数
+        std::atomic<uint64_t> _highYields = {0};     // 高优先级连续执行达到上限让给其他任务的次数
+        std::atomic<uint64_t> _lowPromotes = {0};    // 低优先级任务等待超时被提升执行的次数
 
 #endif
         Xten::Fiber::ptr _root_fiber; // 创建线程的调度协程
@@ -0,0 +1,133 @@
+#ifndef __XTEN_SEGMENT_TABLE_H__
+#define __XTEN_SEGMENT_TABLE_H__
+#include <atomic>
+#include <cstddef>
+#include "macro.h"
+namespace Xten
+{
+    /// @brief 以fd为下标的分段数组(固定容量)
+    /// 两级结构: 固定大小的段指针数组 + 按需分配的段  元素和段都通过原子指针发布
+    /// 读取不加锁 扩容只分配新段不移动已有元素 元素指针在表析构前一直有效
+    template <class T, size_t SEGMENT_SIZE = 1024, size_t SEGMENT_NUM = 4096>
+    class SegmentTable
+    {
+    public:
+        static constexpr size_t CAPACITY = SEGMENT_SIZE * SEGMENT_NUM;
+
+        SegmentTable()
+        {
+            for (size_t i = 0; i < SEGMENT_NUM; i++)
+            {
+                _segments[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+        ~SegmentTable()
+        {
+            for (size_t i = 0; i < SEGMENT_NUM; i++)
+            {
+                Segment *seg = _segments[i].load(std::memory_order_acquire);
+                if (!seg)
+                {
+                    continue;
+                }
+                for (size_t j = 0; j < SEGMENT_SIZE; j++)
+                {
+                    delete seg->slots[j].load(std::memory_order_acquire);
+                }
+                delete seg;
+            }
+        }
+        SegmentTable(const SegmentTable &) = delete;
+        SegmentTable &operator=(const SegmentTable &) = delete;
+
+        // 获取元素 不存在(或超出容量)返回nullptr
+        T *Get(int index) const
+        {
+            if (XTEN_UNLIKELY(index < 0 || (size_t)index >= CAPACITY))
+            {
+                return nullptr;
+            }
+            Segment *seg = _segments[index / SEGMENT_SIZE].load(std::memory_order_acquire);
+            if (!seg)
+            {
+                return nullptr;
+            }
+            return seg->slots[index % SEGMENT_SIZE].load(std::memory_order_acquire);
+        }
+        // 获取元素 不存在则由creator(index)创建并发布 并发创建时只有一个成功 其余删除
+        // 超出容量返回nullptr
+        template <class Creator>
+        T *GetOrCreate(int index, Creator &&creator)
+        {
+            T *val = Get(index);
+            if (val || index < 0 || (size_t)index >= CAPACITY)
+            {
+                return val;
+            }
+            Segment *seg = getSegment(index / SEGMENT_SIZE);
+            std::atomic<T *> &slot = seg->slots[index % SEGMENT_SIZE];
+            T *created = creator(index);
+            T *expected = nullptr;
+            if (!slot.compare_exchange_strong(expected, created, std::memory_order_acq_rel))
+            {
+                delete created;
+                return expected;
+            }
+            return created;
+        }
+        // 遍历已创建的元素
+        template <class F>
+        void ForEach(F &&func) const
+        {
+            for (size_t i = 0; i < SEGMENT_NUM; i++)
+            {
+                Segment *seg = _segments[i].load(std::memory_order_acquire);
+                if (!seg)
+                {
+                    continue;
+                }
+                for (size_t j = 0; j < SEGMENT_SIZE; j++)
+                {
+                    T *val = seg->slots[j].load(std::memory_order_acquire);
+                    if (val)
+                    {
+                        func(val);
+                    }
+                }
+            }
+        }
+
+    private:
+        struct Segment
+        {
+            Segment()
+            {
+                for (size_t i = 0; i < SEGMENT_SIZE; i++)
+                {
+                    slots[i].store(nullptr, std::memory_order_relaxed);
+                }
+            }
+            std::atomic<T *> slots[SEGMENT_SIZE];
+        };
+        // 获取段 不存在则分配并发布
+        Segment *getSegment(size_t index)
+        {
+            Segment *seg = _segments[index].load(std::memory_order_acquire);
+            if (seg)
+            {
+                return seg;
+            }
+            Segment *created = new Segment();
+            if (!_segments[index].compare_exchange_strong(seg, created, std::memory_order_acq_rel))
+            {
+                delete created;
+                return seg;
+            }
+            return created;
+        }
+
+    private:
+        std::atomic<Segment *> _segments[SEGMENT_NUM]; // 段指针数组
+    };
+}
+#endif
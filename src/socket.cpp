@@ -464,7 +464,7 @@ namespace Xten
     // 通过sockfd进行初始化---服务端通过accept获取连接之后
     bool Socket::init(int sockfd)
     {
-        FdCtx::ptr fdctx = FdCtxMgr::GetInstance()->Get(sockfd);
+        FdCtx *fdctx = FdCtxMgr::GetInstance()->Get(sockfd);
         if (fdctx && fdctx->IsSocket() && !fdctx->IsClose())
         {
             _sockfd = sockfd;
@@ -533,7 +533,7 @@ namespace Xten
     // 获取读超时时间
     int64_t Socket::GetRecvTimeOut()
     {
-        FdCtx::ptr fdctx = FdCtxMgr::GetInstance()->Get(_sockfd);
+        FdCtx *fdctx = FdCtxMgr::GetInstance()->Get(_sockfd);
         if (fdctx)
         {
             return fdctx->GetTimeOut(SO_RCVTIMEO);
@@ -550,7 +550,7 @@ namespace Xten
     int64_t Socket::GetSendTimeOut()
     {
 
-        FdCtx::ptr fdctx = FdCtxMgr::GetInstance()->Get(_sockfd);
+        FdCtx *fdctx = FdCtxMgr::GetInstance()->Get(_sockfd);
         if (fdctx)
         {
             return fdctx->GetTimeOut(SO_SNDTIMEO);
@@ -1,5 +1,6 @@
 #include "socket_stream.h"
 #include "log.h"
+#include "hook.h"
 #include <atomic>
 namespace Xten
 {
@@ -30,6 +31,15 @@ namespace Xten
         {
             return -1;
         }
+#ifdef XTEN_IO_URING
+        // 明文socket阻塞时经io_uring固定缓冲区读取
+        ssize_t ret = -1;
+        if (!std::dynamic_pointer_cast<SSLSocket>(_socket) &&
+            uring_read_fixed(_socket->GetSockFd(), buffer, len, ret))
+        {
+            return ret;
+        }
+#endif
         return _socket->Recv(buffer, len);
     }
     // 读取数据到二进制序列数组bytearray中
@@ -59,6 +69,15 @@ namespace Xten
         {
             return -1;
         }
+#ifdef XTEN_IO_URING
+        // 明文socket阻塞时经io_uring固定缓冲区写入
+        ssize_t ret = -1;
+        if (!std::dynamic_pointer_cast<SSLSocket>(_socket) &&
+            uring_write_fixed(_socket->GetSockFd(), buffer, len, ret))
+        {
+            return ret;
+        }
+#endif
         return _socket->Send(buffer, len);
     }
     // 将二进制序列数组中数据写入
@@ -0,0 +1,25 @@
+#include "task.h"
+#include <atomic>
+namespace Xten
+{
+    static std::atomic<uint64_t> s_task_heap_fallback = {0}; // 可调用对象超过内部缓冲区的次数
+
+    void TaskFunc::onHeapFallback()
+    {
+        s_task_heap_fallback++;
+    }
+    uint64_t TaskFunc::GetHeapFallbackCount()
+    {
+        return s_task_heap_fallback;
+    }
+
+    TaskNode *TaskNode::Alloc()
+    {
+        // operator new来自ObjPoolObject 由ObjPoolAllocator的线程缓存分配
+        return new TaskNode();
+    }
+    void TaskNode::Delete(TaskNode *node)
+    {
+        delete node;
+    }
+}
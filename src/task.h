@@ -0,0 +1,220 @@
+#ifndef __XTEN_TASK_H__
+#define __XTEN_TASK_H__
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include <functional>
+#include "fiber.h"
+#include "objpool.h"
+namespace Xten
+{
+    /// @brief 调度任务的可调用对象(签名 void())
+    /// 小对象优化: 不超过INLINE_SIZE字节的可调用对象直接存放在内部缓冲区 不申请堆内存
+    /// 超过的才退化为堆上存放  只能移动不能拷贝
+    class TaskFunc
+    {
+    public:
+        static constexpr size_t INLINE_SIZE = 48;
+
+        TaskFunc() noexcept : _ops(nullptr) {}
+        TaskFunc(std::nullptr_t) noexcept : _ops(nullptr) {}
+        template <class F, class = typename std::enable_if<
+                               !std::is_same<typename std::decay<F>::type, TaskFunc>::value>::type>
+        TaskFunc(F &&func) : _ops(nullptr)
+        {
+            assign(std::forward<F>(func));
+        }
+        TaskFunc(TaskFunc &&target) noexcept : _ops(nullptr)
+        {
+            moveFrom(target);
+        }
+        TaskFunc &operator=(TaskFunc &&target) noexcept
+        {
+            if (this != &target)
+            {
+                Reset();
+                moveFrom(target);
+            }
+            return *this;
+        }
+        TaskFunc(const TaskFunc &) = delete;
+        TaskFunc &operator=(const TaskFunc &) = delete;
+        ~TaskFunc()
+        {
+            Reset();
+        }
+        void operator()()
+        {
+            _ops->invoke(_storage);
+        }
+        explicit operator bool() const noexcept
+        {
+            return _ops != nullptr;
+        }
+        bool operator==(std::nullptr_t) const noexcept
+        {
+            return _ops == nullptr;
+        }
+        bool operator!=(std::nullptr_t) const noexcept
+        {
+            return _ops != nullptr;
+        }
+        // 是否存放在内部缓冲区
+        bool IsInline() const noexcept
+        {
+            return _ops && _ops->is_inline;
+        }
+        void Reset() noexcept
+        {
+            if (_ops)
+            {
+                _ops->destroy(_storage);
+                _ops = nullptr;
+            }
+        }
+        // 超过内部缓冲区而申请堆内存的次数
+        static uint64_t GetHeapFallbackCount();
+
+    private:
+        // 手写虚函数表 每种可调用类型一张静态表
+        struct Ops
+        {
+            void (*invoke)(void *storage);
+            void (*move)(void *dst, void *src); // 移动到dst并析构src
+            void (*destroy)(void *storage);
+            bool is_inline;
+        };
+        template <class F>
+        struct InlineOps
+        {
+            static void Invoke(void *storage)
+            {
+                (*static_cast<F *>(storage))();
+            }
+            static void Move(void *dst, void *src)
+            {
+                new (dst) F(std::move(*static_cast<F *>(src)));
+                static_cast<F *>(src)->~F();
+            }
+            static void Destroy(void *storage)
+            {
+                static_cast<F *>(storage)->~F();
+            }
+            static constexpr Ops ops = {&Invoke, &Move, &Destroy, true};
+        };
+        template <class F>
+        struct HeapOps
+        {
+            static void Invoke(void *storage)
+            {
+                (**static_cast<F **>(storage))();
+            }
+            static void Move(void *dst, void *src)
+            {
+                *static_cast<F **>(dst) = *static_cast<F **>(src);
+            }
+            static void Destroy(void *storage)
+            {
+                delete *static_cast<F **>(storage);
+            }
+            static constexpr Ops ops = {&Invoke, &Move, &Destroy, false};
+        };
+        template <class F>
+        using FitsInline = std::integral_constant<bool, sizeof(F) <= INLINE_SIZE &&
+                                                            alignof(F) <= alignof(std::max_align_t) &&
+                                                            std::is_nothrow_move_constructible<F>::value>;
+        // 空的std::function/函数指针视为空任务
+        template <class F>
+        static bool isNull(const F &) { return false; }
+        template <class R, class... Args>
+        static bool isNull(const std::function<R(Args...)> &func) { return !func; }
+        template <class R, class... Args>
+        static bool isNull(R (*func)(Args...)) { return func == nullptr; }
+
+        template <class F>
+        void assign(F &&func)
+        {
+            typedef typename std::decay<F>::type FuncType;
+            if (isNull(func))
+            {
+                return;
+            }
+            emplace<FuncType>(std::forward<F>(func), FitsInline<FuncType>());
+        }
+        template <class FuncType, class F>
+        void emplace(F &&func, std::true_type)
+        {
+            new (_storage) FuncType(std::forward<F>(func));
+            _ops = &InlineOps<FuncType>::ops;
+        }
+        template <class FuncType, class F>
+        void emplace(F &&func, std::false_type)
+        {
+            *reinterpret_cast<FuncType **>(_storage) = new FuncType(std::forward<F>(func));
+            _ops = &HeapOps<FuncType>::ops;
+            onHeapFallback();
+        }
+        void moveFrom(TaskFunc &target) noexcept
+        {
+            if (target._ops)
+            {
+                _ops = target._ops;
+                _ops->move(_storage, target._storage);
+                target._ops = nullptr;
+            }
+        }
+        static void onHeapFallback();
+
+    private:
+        alignas(std::max_align_t) unsigned char _storage[INLINE_SIZE]; // 内部缓冲区
+        const Ops *_ops;                                                // 类型操作表 nullptr表示空
+    };
+
+    /// @brief 调度器任务队列中的任务记录(回调函数或者协程)
+    /// 固定大小 由ObjPoolAllocator的线程缓存分配 调度一个普通lambda不需要调用malloc
+    struct TaskNode : public ObjPoolObject
+    {
+        typedef Fiber::ptr FiberPtr;
+
+        // 创建一个任务记录
+        static TaskNode *New(const FiberPtr &fiber, int threadId = -1)
+        {
+            TaskNode *node = Alloc();
+            node->fiber = fiber;
+            node->threadId = threadId;
+            return node;
+        }
+        static TaskNode *New(FiberPtr &&fiber, int threadId = -1)
+        {
+            TaskNode *node = Alloc();
+            node->fiber = std::move(fiber);
+            node->threadId = threadId;
+            return node;
+        }
+        template <class F, class = typename std::enable_if<
+                               !std::is_convertible<F, FiberPtr>::value>::type>
+        static TaskNode *New(F &&func, int threadId = -1)
+        {
+            TaskNode *node = Alloc();
+            node->func = TaskFunc(std::forward<F>(func));
+            node->threadId = threadId;
+            return node;
+        }
+        // 析构任务内容并释放任务记录
+        static void Delete(TaskNode *node);
+
+        TaskFunc func;            // 回调函数
+        FiberPtr fiber;           // 协程
+        int threadId = -1;        // 任务指定的线程id(LWP id)
+        uint8_t priority = 1;     // 任务优先级(Scheduler::Priority 默认PRIORITY_NORMAL)
+        uint64_t deadline = 0;    // 截止时间(绝对毫秒 0表示没有)
+
+    private:
+        TaskNode() = default;
+        ~TaskNode() = default;
+        static TaskNode *Alloc();
+    };
+}
+#endif
@@ -1,8 +1,14 @@
 #include "tcp_server.h"
 #include "log.h"
+#include "fdmanager.h"
 namespace Xten
 {
     static Logger::ptr g_logger = XTEN_LOG_NAME("system");
+#ifdef XTEN_IO_URING
+    // 接受的连接使用io_uring multishot recv(io调度器启用io_uring时生效)
+    static ConfigVar<bool>::ptr g_tcp_server_multishot_recv =
+        Config::LookUp("tcp_server.io_uring_multishot_recv", true, "tcp server client socket use io_uring multishot recv");
+#endif
     TcpServer::TcpServer(Xten::IOManager *accept_worker,
                          Xten::IOManager *io_worker,
                          Xten::IOManager *process_worker,
@@ -160,6 +166,16 @@ namespace Xten
             {
                 // 接受成功
                 client->SetRecvTimeOut(_recvTimeout);
+#ifdef XTEN_IO_URING
+                if (g_tcp_server_multishot_recv->GetValue() && _ioWorker->IsUringEnabled())
+                {
+                    FdCtx *fdctx = FdCtxMgr::GetInstance()->Get(client->GetSockFd());
+                    if (fdctx)
+                    {
+                        fdctx->SetUringMultishotRecv(true);
+                    }
+                }
+#endif
                 // 将该client的处理交给_ioWorker
 
                 // std::bind 在绑定成员函数时，会在运行时根据对象的实际类型进行动态绑定
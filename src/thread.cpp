@@ -81,7 +81,7 @@ namespace Xten
     {
         return t_thread;
     }
-    std::string Thread::GetName() // 获取当前线程name
+    const std::string &Thread::GetName() // 获取当前线程name
     {
         return t_name;
     }
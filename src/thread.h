@@ -20,7 +20,7 @@ namespace Xten
         ~Thread();
     public:  //静态函数---用来获取当前线程的一些值（线程局部存储）
         static Thread* GetThis(); //获取当前线程的this指针
-        static std::string GetName(); //获取当前线程name
+        static const std::string &GetName(); //获取当前线程name
         static void SetName(const std::string& name);//设置当前线程name--主要用于主线程（非用户创建）
     private:
         static void* run(void* args);// 线程的实际运行函数
@@ -0,0 +1,44 @@
+#ifndef __XTEN_THREAD_CACHE_H__
+#define __XTEN_THREAD_CACHE_H__
+#include "macro.h"
+namespace Xten
+{
+    /// @brief 线程本地缓存 线程退出时归还
+    /// Cache必须是平凡类型(线程退出时其他thread_local析构中仍可访问) 并提供:
+    ///   bool registered; // 是否已注册线程退出回调
+    ///   bool dead;       // 线程退出后不再缓存
+    ///   void flush();    // 全部归还
+    /// 首次Get时才构造带析构函数的Flusher注册线程退出回调 之后的访问没有额外开销
+    template <class Cache>
+    class ThreadCacheHolder
+    {
+    public:
+        static Cache &Get()
+        {
+            Cache &cache = t_cache;
+            if (XTEN_UNLIKELY(!cache.registered))
+            {
+                cache.registered = true;
+                static_cast<void>(&t_flusher);
+            }
+            return cache;
+        }
+
+    private:
+        struct Flusher
+        {
+            ~Flusher()
+            {
+                t_cache.flush();
+                t_cache.dead = true;
+            }
+        };
+        static thread_local Cache t_cache;
+        static thread_local Flusher t_flusher;
+    };
+    template <class Cache>
+    thread_local Cache ThreadCacheHolder<Cache>::t_cache = {};
+    template <class Cache>
+    thread_local typename ThreadCacheHolder<Cache>::Flusher ThreadCacheHolder<Cache>::t_flusher;
+}
+#endif
@@ -1,7 +1,10 @@
 #include "timer.h"
+#include <string.h>
+#include <algorithm>
 #include "util.h"
 #include"worker.h"
 #include"iomanager.h"
+#include "objpool.h"
 namespace Xten
 {
     bool Timer::Comparator::operator()(const Timer::ptr &lhs, const Timer::ptr &rhs) const
@@ -29,11 +32,11 @@ namespace Xten
         return lhs.get() < rhs.get();
     }
 
-    Timer::Timer(uint64_t ms, std::function<void()> cb,
-                 bool recurring, TimerManager *manager)
-        : m_recurring(recurring), m_ms(ms), m_cb(cb), m_manager(manager)
+    Timer::Timer(uint64_t us, std::function<void()> cb,
+                 bool recurring, TimerManager *manager, uint64_t slack_us)
+        : m_recurring(recurring), m_us(us), m_slack(slack_us), m_cb(cb), m_manager(manager)
     {
-        m_next = TimeUitl::GetCurrentMS() + m_ms;
+        setNext(TimeUitl::GetCurrentUS() + m_us);
     }
 
     Timer::Timer(uint64_t next)
@@ -41,83 +44,473 @@ namespace Xten
     {
     }
 
+    void Timer::setNext(uint64_t expect)
+    {
+        m_expect = expect;
+        m_next = expect;
+        if (m_slack == 0)
+        {
+            return;
+        }
+        // 向上对齐到不超过slack的最大2的幂 同一窗口内的定时器得到相同的执行时间
+        uint64_t align = 1ull << (63 - __builtin_clzll(m_slack));
+        m_next = (expect + align - 1) & ~(align - 1);
+    }
+
     bool Timer::cancel()
     {
-        TimerManager::RWMutexType::WriteLock lock(m_manager->m_mutex);
+        Timer::ptr self = shared_from_this();
+        TimerShard *shard = m_manager->lockTimer(this);
+        bool ret = false;
         if (m_cb)
         {
             m_cb = nullptr;
-            auto it = m_manager->m_timers.find(shared_from_this());
-            m_manager->m_timers.erase(it);
-            return true;
+            // 在移交队列中的定时器由接收的线程丢弃
+            if (shard)
+            {
+                shard->erase(self);
+            }
+            ret = true;
         }
-        return false;
+        m_manager->unlockTimer(shard);
+        return ret;
     }
 
     bool Timer::refresh()
     {
-        TimerManager::RWMutexType::WriteLock lock(m_manager->m_mutex);
-        if (!m_cb)
+        Timer::ptr self = shared_from_this();
+        TimerShard *shard = m_manager->lockTimer(this);
+        if (!m_cb || (shard && !shard->erase(self)))
         {
+            m_manager->unlockTimer(shard);
             return false;
         }
-        auto it = m_manager->m_timers.find(shared_from_this());
-        if (it == m_manager->m_timers.end())
+        setNext(TimeUitl::GetCurrentUS() + m_us);
+        if (!shard)
         {
-            return false;
+            // 在移交队列中 接收时按新的时间放入
+            m_manager->unlockTimer(shard);
+            return true;
         }
-        m_manager->m_timers.erase(it);
-        m_next = TimeUitl::GetCurrentMS() + m_ms;
-        m_manager->m_timers.insert(shared_from_this());
+        if (shard != m_manager->ownShard())
+        {
+            // 其他线程的分片 交给移交队列 由空闲的线程重新接收
+            m_shard.store(nullptr, std::memory_order_release);
+            m_manager->unlockTimer(shard);
+            m_manager->pushInbox(self);
+            return true;
+        }
+        shard->insert(self);
+        m_manager->unlockTimer(shard);
         return true;
     }
 
     bool Timer::reset(uint64_t ms, bool from_now)
     {
-        if (ms == m_ms && !from_now)
+        uint64_t us = ms * 1000;
+        if (us == m_us && !from_now)
         {
             return true;
         }
-        TimerManager::RWMutexType::WriteLock lock(m_manager->m_mutex);
-        if (!m_cb)
-        {
-            return false;
-        }
-        auto it = m_manager->m_timers.find(shared_from_this());
-        if (it == m_manager->m_timers.end())
+        Timer::ptr self = shared_from_this();
+        TimerShard *shard = m_manager->lockTimer(this);
+        if (!m_cb || (shard && !shard->erase(self)))
         {
+            m_manager->unlockTimer(shard);
             return false;
         }
-        m_manager->m_timers.erase(it);
         uint64_t start = 0;
         if (from_now)
         {
-            start = TimeUitl::GetCurrentMS();
+            start = TimeUitl::GetCurrentUS();
         }
         else
         {
-            start = m_next - m_ms;
+            start = m_expect - m_us;
+        }
+        m_us = us;
+        setNext(start + m_us);
+        if (!shard)
+        {
+            m_manager->unlockTimer(shard);
+            return true;
+        }
+        if (shard != m_manager->ownShard())
+        {
+            m_shard.store(nullptr, std::memory_order_release);
+            m_manager->unlockTimer(shard);
+            m_manager->pushInbox(self);
+            return true;
+        }
+        bool at_front = m_manager->insertTimer(shard, self);
+        m_manager->unlockTimer(shard);
+        if (at_front)
+        {
+            m_manager->onTimerInsertedAtFront();
+        }
+        return true;
+    }
+
+    TimerShard::TimerShard(bool wheel)
+        : m_wheel(wheel)
+    {
+        m_previouseTime = TimeUitl::GetCurrentUS();
+        m_wheelTime = m_previouseTime;
+    }
+
+    bool TimerShard::empty() const
+    {
+        return m_wheel ? m_wheelCount == 0 : m_timers.empty();
+    }
+
+    uint64_t TimerShard::firstExpire() const
+    {
+        if (!m_wheel)
+        {
+            return m_timers.empty() ? ~0ull : (*m_timers.begin())->m_next;
+        }
+        if (m_wheelCount == 0)
+        {
+            return ~0ull;
+        }
+        // 1.主时间轮当前时间片之后的第一个非空槽(精确时间)
+        uint32_t cur = m_wheelTime & TIME_NEAR_MASK;
+        for (uint32_t i = cur / 64; i < TIME_NEAR / 64; i++)
+        {
+            uint64_t bits = m_nearBits[i];
+            if (i == cur / 64)
+            {
+                bits &= (cur % 64 == 63) ? 0 : (~0ull << (cur % 64 + 1));
+            }
+            if (bits)
+            {
+                return (m_wheelTime & ~(uint64_t)TIME_NEAR_MASK) | (i * 64 + __builtin_ctzll(bits));
+            }
+        }
+        // 2.从时间轮当前槽之后的第一个非空槽(槽的起始时间 是过期时间的下界)
+        // 层级越高过期时间越晚 找到即可返回
+        for (int level = 0; level < 4; level++)
+        {
+            int shift = TIME_NEAR_SHIFT + level * TIME_LEVEL_SHIFT;
+            uint32_t idx = (m_wheelTime >> shift) & TIME_LEVEL_MASK;
+            uint64_t bits = m_levelBits[level] & ((idx == 63) ? 0 : (~0ull << (idx + 1)));
+            if (bits)
+            {
+                uint64_t high = (m_wheelTime >> (shift + TIME_LEVEL_SHIFT)) << (shift + TIME_LEVEL_SHIFT);
+                return high | ((uint64_t)__builtin_ctzll(bits) << shift);
+            }
+        }
+        // 3.只剩超出范围的定时器 下一圈开始时再分配
+        return ((m_wheelTime >> 32) + 1) << 32;
+    }
+
+    void TimerShard::insert(const Timer::ptr &timer)
+    {
+        if (!m_wheel)
+        {
+            m_timers.insert(timer);
+            return;
+        }
+        if (m_wheelCount == 0)
+        {
+            // 时间轮为空 直接跳到当前时间 避免之后逐个时间片推进
+            m_wheelTime = std::max(m_wheelTime, TimeUitl::GetCurrentUS());
+        }
+        // 已经过期的定时器放到下一个时间片
+        std::list<Timer::ptr> *slot = wheelSlot(std::max(timer->m_next, m_wheelTime + 1));
+        slot->push_back(timer);
+        timer->m_slot = slot;
+        timer->m_pos = --slot->end();
+        wheelMark(slot);
+        m_wheelCount++;
+    }
+
+    bool TimerShard::erase(const Timer::ptr &timer)
+    {
+        if (!m_wheel)
+        {
+            auto it = m_timers.find(timer);
+            if (it == m_timers.end())
+            {
+                return false;
+            }
+            m_timers.erase(it);
+            return true;
+        }
+        std::list<Timer::ptr> *slot = timer->m_slot;
+        if (!slot)
+        {
+            return false;
         }
-        m_ms = ms;
-        m_next = start + m_ms;
-        m_manager->addTimer(shared_from_this(), lock);
+        timer->m_slot = nullptr;
+        slot->erase(timer->m_pos);
+        wheelMark(slot);
+        m_wheelCount--;
         return true;
     }
 
-    TimerManager::TimerManager()
+    size_t TimerShard::expire(uint64_t now_us, std::vector<Timer::ptr> &expired)
+    {
+        if (empty())
+        {
+            return 0;
+        }
+        bool rollover = detectClockRollover(now_us);
+        if (!rollover && firstExpire() > now_us)
+        {
+            return 0;
+        }
+        if (m_wheel)
+        {
+            if (rollover)
+            {
+                wheelDrain(expired);
+                m_wheelTime = now_us;
+            }
+            else
+            {
+                wheelExpire(now_us, expired);
+            }
+        }
+        else
+        {
+            Timer::ptr now_timer = Xten::protected_make_shared<Timer>(now_us);
+            auto it = rollover ? m_timers.end() : m_timers.lower_bound(now_timer);
+            while (it != m_timers.end() && (*it)->m_next == now_us)
+            {
+                ++it;
+            }
+            expired.insert(expired.end(), m_timers.begin(), it);
+            m_timers.erase(m_timers.begin(), it);
+        }
+        // 节省的唤醒次数: 合并前不同的执行时间个数 - 合并后不同的执行时间个数
+        size_t saved = 0;
+        if (std::any_of(expired.begin(), expired.end(), [](const Timer::ptr &timer)
+                        { return timer->m_slack != 0; }))
+        {
+            std::vector<uint64_t> expects, nexts;
+            expects.reserve(expired.size());
+            nexts.reserve(expired.size());
+            for (auto &timer : expired)
+            {
+                expects.push_back(timer->m_expect);
+                nexts.push_back(timer->m_next);
+            }
+            std::sort(expects.begin(), expects.end());
+            std::sort(nexts.begin(), nexts.end());
+            size_t expect_num = std::unique(expects.begin(), expects.end()) - expects.begin();
+            size_t next_num = std::unique(nexts.begin(), nexts.end()) - nexts.begin();
+            saved = expect_num > next_num ? expect_num - next_num : 0;
+        }
+        for (auto &timer : expired)
+        {
+            if (timer->m_recurring)
+            {
+                // 按期望时间推进周期 slack对齐和处理延迟不会累积漂移 落后太多时从当前时间补一次
+                timer->setNext(std::max(timer->m_expect + timer->m_us, now_us));
+                insert(timer);
+            }
+        }
+        return saved;
+    }
+
+    bool TimerShard::detectClockRollover(uint64_t now_us)
+    {
+        bool rollover = false;
+        if (now_us < m_previouseTime &&
+            now_us < (m_previouseTime - 60 * 60 * 1000 * 1000ull))
+        {
+            rollover = true;
+        }
+        m_previouseTime = now_us;
+        return rollover;
+    }
+
+    std::list<Timer::ptr> *TimerShard::wheelSlot(uint64_t expire)
+    {
+        // 过期时间和当前时间片的最高不同位决定层级
+        uint64_t diff = expire ^ m_wheelTime;
+        if (diff < TIME_NEAR)
+        {
+            return &m_near[expire & TIME_NEAR_MASK];
+        }
+        for (int level = 0; level < 4; level++)
+        {
+            int shift = TIME_NEAR_SHIFT + level * TIME_LEVEL_SHIFT;
+            if ((diff >> (shift + TIME_LEVEL_SHIFT)) == 0)
+            {
+                return &m_levels[level][(expire >> shift) & TIME_LEVEL_MASK];
+            }
+        }
+        return &m_far;
+    }
+
+    void TimerShard::wheelMark(std::list<Timer::ptr> *slot)
+    {
+        uint64_t *bits = nullptr;
+        size_t idx = 0;
+        if (slot >= m_near && slot < m_near + TIME_NEAR)
+        {
+            idx = slot - m_near;
+            bits = &m_nearBits[idx / 64];
+            idx %= 64;
+        }
+        else if (slot >= &m_levels[0][0] && slot < &m_levels[0][0] + 4 * TIME_LEVEL)
+        {
+            idx = slot - &m_levels[0][0];
+            bits = &m_levelBits[idx / TIME_LEVEL];
+            idx %= TIME_LEVEL;
+        }
+        else
+        {
+            return;
+        }
+        if (slot->empty())
+        {
+            *bits &= ~(1ull << idx);
+        }
+        else
+        {
+            *bits |= (1ull << idx);
+        }
+    }
+
+    void TimerShard::wheelMove(std::list<Timer::ptr> &slot)
+    {
+        // splice只移动链表结点 定时器记录的位置依然有效
+        while (!slot.empty())
+        {
+            auto it = slot.begin();
+            std::list<Timer::ptr> *target = wheelSlot(std::max((*it)->m_next, m_wheelTime));
+            target->splice(target->end(), slot, it);
+            (*it)->m_slot = target;
+            wheelMark(target);
+        }
+        wheelMark(&slot);
+    }
+
+    void TimerShard::wheelCascade()
+    {
+        // 低位全0 找到第一个没有进位的层级 下沉它当前槽中的定时器
+        for (int level = 0; level < 4; level++)
+        {
+            uint32_t idx = (m_wheelTime >> (TIME_NEAR_SHIFT + level * TIME_LEVEL_SHIFT)) & TIME_LEVEL_MASK;
+            if (idx != 0)
+            {
+                wheelMove(m_levels[level][idx]);
+                return;
+            }
+        }
+        wheelMove(m_far);
+    }
+
+    void TimerShard::wheelExpire(uint64_t now_us, std::vector<Timer::ptr> &expired)
+    {
+        while (m_wheelTime < now_us)
+        {
+            if (m_wheelCount == 0)
+            {
+                m_wheelTime = now_us;
+                break;
+            }
+            // 下一个需要处理的时间片: 主时间轮的非空槽 或者 最近的非空从时间轮槽的起始(新一圈)
+            // 中间的时间片都是空的 可以直接跳过
+            uint64_t next = firstExpire();
+            if (next > now_us)
+            {
+                m_wheelTime = now_us;
+                break;
+            }
+            m_wheelTime = next;
+            if ((m_wheelTime & TIME_NEAR_MASK) == 0)
+            {
+                wheelCascade();
+            }
+            std::list<Timer::ptr> &slot = m_near[m_wheelTime & TIME_NEAR_MASK];
+            for (auto &timer : slot)
+            {
+                timer->m_slot = nullptr;
+                expired.push_back(std::move(timer));
+            }
+            m_wheelCount -= slot.size();
+            slot.clear();
+            wheelMark(&slot);
+        }
+    }
+
+    void TimerShard::wheelDrain(std::vector<Timer::ptr> &expired)
+    {
+        auto drain = [&](std::list<Timer::ptr> &slot)
+        {
+            for (auto &timer : slot)
+            {
+                timer->m_slot = nullptr;
+                expired.push_back(std::move(timer));
+            }
+            slot.clear();
+        };
+        for (auto &slot : m_near)
+        {
+            drain(slot);
+        }
+        for (auto &level : m_levels)
+        {
+            for (auto &slot : level)
+            {
+                drain(slot);
+            }
+        }
+        drain(m_far);
+        memset(m_nearBits, 0, sizeof(m_nearBits));
+        memset(m_levelBits, 0, sizeof(m_levelBits));
+        m_wheelCount = 0;
+    }
+
+    TimerManager::TimerManager(bool wheel, size_t shards)
+        : m_wheel(wheel)
     {
-        m_previouseTime = TimeUitl::GetCurrentMS();
+        shards = std::max(shards, (size_t)1);
+        for (size_t i = 0; i < shards; i++)
+        {
+            m_shards.emplace_back(new TimerShard(wheel));
+        }
     }
 
     TimerManager::~TimerManager()
     {
+        // 释放移交队列中定时器的自引用
+        Timer *head = m_inbox.exchange(nullptr, std::memory_order_acquire);
+        while (head)
+        {
+            Timer *next = head->m_inboxNext;
+            head->m_inboxNext = nullptr;
+            head->m_inboxRef.reset();
+            head = next;
+        }
     }
 
-    Timer::ptr TimerManager::addTimer(uint64_t ms, std::function<void()> cb, bool recurring)
+    Timer::ptr TimerManager::addTimer(uint64_t ms, std::function<void()> cb, bool recurring, uint64_t slack_ms)
     {
-        Timer::ptr timer = Xten::protected_make_shared<Timer>(ms, cb, recurring, this);
-        RWMutexType::WriteLock lock(m_mutex);
-        addTimer(timer, lock);
+        return addTimerUs(ms * 1000, std::move(cb), recurring, slack_ms * 1000);
+    }
+
+    Timer::ptr TimerManager::addTimerUs(uint64_t us, std::function<void()> cb, bool recurring, uint64_t slack_us)
+    {
+        Timer::ptr timer = Xten::protected_allocate_shared<Timer>(ObjPoolStlAllocator<Timer>(), us, std::move(cb), recurring, this, slack_us);
+        TimerShard *shard = ownShard();
+        if (!shard)
+        {
+            pushInbox(timer);
+            return timer;
+        }
+        RWMutexType::WriteLock lock(shard->m_mutex);
+        timer->m_shard.store(shard, std::memory_order_relaxed);
+        bool at_front = insertTimer(shard, timer);
+        lock.unlock();
+        if (at_front)
+        {
+            onTimerInsertedAtFront();
+        }
         return timer;
     }
 
@@ -130,111 +523,250 @@ namespace Xten
         }
     }
 
-    Timer::ptr TimerManager::addConditionTimer(uint64_t ms, std::function<void()> cb, std::weak_ptr<void> weak_cond, bool recurring)
+    Timer::ptr TimerManager::addConditionTimer(uint64_t ms, std::function<void()> cb, std::weak_ptr<void> weak_cond, bool recurring, uint64_t slack_ms)
     {
-        return addTimer(ms, std::bind(&OnTimer, weak_cond, cb), recurring);
+        return addTimer(ms, std::bind(&OnTimer, weak_cond, cb), recurring, slack_ms);
     }
 
     uint64_t TimerManager::getNextTimer()
     {
-        RWMutexType::ReadLock lock(m_mutex);
-        m_tickled = false;
-        if (m_timers.empty())
+        // 向上取整 避免按毫秒等待时提前醒来空转
+        uint64_t us = getNextTimerUs();
+        return us == ~0ull ? ~0ull : (us + 999) / 1000;
+    }
+
+    uint64_t TimerManager::getNextTimerUs()
+    {
+        uint64_t next = ~0ull;
+        for (auto &shard : m_shards)
+        {
+            RWMutexType::ReadLock lock(shard->m_mutex);
+            shard->m_tickled = false;
+            next = std::min(next, shard->firstExpire());
+        }
+        if (m_inbox.load(std::memory_order_acquire))
+        {
+            // 还有未被接收的定时器
+            return 0;
+        }
+        if (next == ~0ull)
         {
             return ~0ull;
         }
-
-        const Timer::ptr &next = *m_timers.begin();
-        uint64_t now_ms = TimeUitl::GetCurrentMS();
-        if (now_ms >= next->m_next)
+        uint64_t now_us = TimeUitl::GetCurrentUS();
+        if (now_us >= next)
         {
             return 0;
         }
         else
         {
-            return next->m_next - now_ms;
+            return next - now_us;
         }
     }
 
+    uint64_t TimerManager::getNextTimerUs(int shard_idx)
+    {
+        if (m_shards.size() == 1)
+        {
+            return getNextTimerUs();
+        }
+        TimerShard *shard = m_shards[shard_idx].get();
+        adoptInbox(shard);
+        uint64_t next = 0;
+        {
+            RWMutexType::ReadLock lock(shard->m_mutex);
+            shard->m_tickled = false;
+            next = shard->firstExpire();
+        }
+        if (next == ~0ull)
+        {
+            return ~0ull;
+        }
+        uint64_t now_us = TimeUitl::GetCurrentUS();
+        return now_us >= next ? 0 : next - now_us;
+    }
+
     void TimerManager::listExpiredCb(std::vector<std::function<void()>> &cbs)
     {
-        uint64_t now_ms = TimeUitl::GetCurrentMS();
-        std::vector<Timer::ptr> expired;
+        if (m_shards.size() > 1)
         {
-            RWMutexType::ReadLock lock(m_mutex);
-            if (m_timers.empty())
-            {
-                return;
-            }
+            adoptInbox(m_shards[0].get());
         }
-        RWMutexType::WriteLock lock(m_mutex);
-        if (m_timers.empty())
+        for (auto &shard : m_shards)
         {
-            return;
+            listExpiredCb(shard.get(), cbs);
         }
-        bool rollover = detectClockRollover(now_ms);
-        if (!rollover && ((*m_timers.begin())->m_next > now_ms))
+    }
+
+    void TimerManager::listExpiredCb(int shard_idx, std::vector<std::function<void()>> &cbs)
+    {
+        if (m_shards.size() == 1)
         {
+            listExpiredCb(m_shards[0].get(), cbs);
             return;
         }
+        TimerShard *shard = m_shards[shard_idx].get();
+        adoptInbox(shard);
+        listExpiredCb(shard, cbs);
+    }
 
-        Timer::ptr now_timer = Xten::protected_make_shared<Timer>(now_ms);
-        auto it = rollover ? m_timers.end() : m_timers.lower_bound(now_timer);
-        while (it != m_timers.end() && (*it)->m_next == now_ms)
+    void TimerManager::listExpiredCb(TimerShard *shard, std::vector<std::function<void()>> &cbs)
+    {
+        uint64_t now_us = TimeUitl::GetCurrentUS();
+        std::vector<Timer::ptr> expired;
         {
-            ++it;
+            RWMutexType::ReadLock lock(shard->m_mutex);
+            if (shard->empty())
+            {
+                return;
+            }
         }
-        expired.insert(expired.begin(), m_timers.begin(), it);
-        m_timers.erase(m_timers.begin(), it);
-        cbs.reserve(expired.size());
-
+        RWMutexType::WriteLock lock(shard->m_mutex);
+        size_t saved = shard->expire(now_us, expired);
+        if (saved)
+        {
+            m_coalesced.fetch_add(saved, std::memory_order_relaxed);
+        }
+        cbs.reserve(cbs.size() + expired.size());
         for (auto &timer : expired)
         {
             cbs.push_back(timer->m_cb);
-            if (timer->m_recurring)
+            if (!timer->m_recurring)
             {
-                timer->m_next = now_ms + timer->m_ms;
-                m_timers.insert(timer);
+                timer->m_cb = nullptr;
             }
-            else
+        }
+    }
+
+    bool TimerManager::hasTimer()
+    {
+        if (m_inbox.load(std::memory_order_acquire))
+        {
+            return true;
+        }
+        for (auto &shard : m_shards)
+        {
+            RWMutexType::ReadLock lock(shard->m_mutex);
+            if (!shard->empty())
             {
-                timer->m_cb = nullptr;
+                return true;
             }
         }
+        return false;
     }
 
-    void TimerManager::addTimer(Timer::ptr val, RWMutexType::WriteLock &lock)
+    TimerShard *TimerManager::ownShard()
     {
-        auto it = m_timers.insert(val).first;
-        bool at_front = (it == m_timers.begin()) && !m_tickled;
-        if (at_front)
+        if (m_shards.size() == 1)
         {
-            m_tickled = true;
+            return m_shards[0].get();
         }
-        lock.unlock();
+        int idx = currentTimerShard();
+        if (idx < 0 || idx >= (int)m_shards.size())
+        {
+            return nullptr;
+        }
+        return m_shards[idx].get();
+    }
 
+    bool TimerManager::insertTimer(TimerShard *shard, const Timer::ptr &val)
+    {
+        bool at_front = false;
+        if (m_wheel)
+        {
+            at_front = val->m_next < shard->firstExpire();
+            shard->insert(val);
+        }
+        else
+        {
+            auto it = shard->m_timers.insert(val).first;
+            at_front = (it == shard->m_timers.begin());
+        }
+        // 分片时当前线程就是分片的处理线程 下次阻塞前会重新计算超时时间 不需要通知
+        at_front = at_front && !shard->m_tickled && m_shards.size() == 1;
         if (at_front)
         {
+            shard->m_tickled = true;
+        }
+        return at_front;
+    }
+
+    void TimerManager::pushInbox(const Timer::ptr &timer)
+    {
+        Timer *ptr = timer.get();
+        ptr->m_inboxRef = timer;
+        Timer *head = m_inbox.load(std::memory_order_relaxed);
+        do
+        {
+            ptr->m_inboxNext = head;
+        } while (!m_inbox.compare_exchange_weak(head, ptr, std::memory_order_release, std::memory_order_relaxed));
+        if (!head)
+        {
+            // 队列由空变为非空 唤醒一个线程接收 之后的定时器随它一起被接收
             onTimerInsertedAtFront();
         }
     }
 
-    bool TimerManager::detectClockRollover(uint64_t now_ms)
+    void TimerManager::adoptInbox(TimerShard *shard)
     {
-        bool rollover = false;
-        if (now_ms < m_previouseTime &&
-            now_ms < (m_previouseTime - 60 * 60 * 1000))
+        if (!m_inbox.load(std::memory_order_relaxed))
         {
-            rollover = true;
+            return;
+        }
+        Timer *head = m_inbox.exchange(nullptr, std::memory_order_acquire);
+        if (!head)
+        {
+            return;
+        }
+        RWMutexType::WriteLock lock(shard->m_mutex);
+        SpinLock::Lock ilock(m_inboxMutex);
+        while (head)
+        {
+            Timer *next = head->m_inboxNext;
+            head->m_inboxNext = nullptr;
+            Timer::ptr timer = std::move(head->m_inboxRef);
+            timer->m_shard.store(shard, std::memory_order_release);
+            // 在移交队列中被取消的定时器直接丢弃
+            if (timer->m_cb)
+            {
+                shard->insert(timer);
+            }
+            head = next;
         }
-        m_previouseTime = now_ms;
-        return rollover;
     }
 
-    bool TimerManager::hasTimer()
+    TimerShard *TimerManager::lockTimer(Timer *timer)
     {
-        RWMutexType::ReadLock lock(m_mutex);
-        return !m_timers.empty();
+        while (true)
+        {
+            TimerShard *shard = timer->m_shard.load(std::memory_order_acquire);
+            if (shard)
+            {
+                shard->m_mutex.wrlock();
+            }
+            else
+            {
+                m_inboxMutex.lock();
+            }
+            // 只有持有对应的锁才能修改所在位置 加锁后位置没变即可返回
+            if (timer->m_shard.load(std::memory_order_acquire) == shard)
+            {
+                return shard;
+            }
+            unlockTimer(shard);
+        }
+    }
+
+    void TimerManager::unlockTimer(TimerShard *shard)
+    {
+        if (shard)
+        {
+            shard->m_mutex.unlock();
+        }
+        else
+        {
+            m_inboxMutex.unlock();
+        }
     }
 
     TimerW::TimerW(int expire, int sub, std::function<void()> callback, bool recurring, TimerWheelManager *manager)
@@ -7,6 +7,8 @@
 #include"thread.h"
 #include "mutex.h"
 #include <queue>
+#include <set>
+#include <atomic>
 
 // tick时钟指针uint32_t -----每部分字段代表该层时间轮的时钟指针索引
 //   t[3]  t[2]  t[1]  t[0]  near
@@ -23,10 +25,12 @@
 namespace Xten
 {
     class TimerManager;
+    struct TimerShard;
     // 基于红黑树的定时器任务
     class Timer : public std::enable_shared_from_this<Timer>
     {
         friend class TimerManager;
+        friend struct TimerShard;
 
     public:
         /// 定时器的智能指针类型
@@ -41,22 +45,40 @@ namespace Xten
         bool reset(uint64_t ms, bool from_now);
 
     protected:
-        Timer(uint64_t ms, std::function<void()> cb,
-              bool recurring, TimerManager *manager);
+        Timer(uint64_t us, std::function<void()> cb,
+              bool recurring, TimerManager *manager, uint64_t slack_us = 0);
 
         Timer(uint64_t next);
 
+    private:
+        // 设置期望的执行时间 按允许延后的时间对齐得到实际执行时间
+        void setNext(uint64_t expect);
+
     private:
         /// 是否循环定时器
         bool m_recurring = false;
-        /// 执行周期
-        uint64_t m_ms = 0;
-        /// 精确的执行时间
+        /// 执行周期(微秒)
+        uint64_t m_us = 0;
+        /// 精确的执行时间(微秒)
         uint64_t m_next = 0;
+        /// 期望的执行时间(微秒 合并前)
+        uint64_t m_expect = 0;
+        /// 允许延后执行的时间(微秒) 落在同一对齐窗口内的定时器合并为一次唤醒
+        uint64_t m_slack = 0;
         /// 回调函数
         std::function<void()> m_cb;
         /// 定时器管理器
         TimerManager *m_manager = nullptr;
+        /// 时间轮模式: 所在的槽(不在时间轮中为nullptr)
+        std::list<Timer::ptr> *m_slot = nullptr;
+        /// 时间轮模式: 在槽中的位置 用于O(1)删除
+        std::list<Timer::ptr>::iterator m_pos;
+        /// 所属分片(在跨线程移交队列中为nullptr)
+        std::atomic<TimerShard *> m_shard = {nullptr};
+        /// 移交队列中的下一个定时器
+        Timer *m_inboxNext = nullptr;
+        /// 在移交队列中时保持定时器存活
+        Timer::ptr m_inboxRef;
 
     private:
         // 定时器比较仿函数
@@ -67,7 +89,68 @@ namespace Xten
         };
     };
 
-    // 基于红黑树的定时器管理器
+    /// @brief 定时器分片 保存一组定时器 默认基于红黑树 wheel为true时使用多层时间轮(1us精度 O(1)添加/取消)
+    /// 时间单位都是微秒
+    struct TimerShard
+    {
+        typedef RWMutex RWMutexType;
+
+        TimerShard(bool wheel);
+        // 是否没有定时器 ---需持有锁
+        bool empty() const;
+        // 最近的过期时间(时间轮模式为下界) 没有定时器返回~0ull ---需持有锁
+        uint64_t firstExpire() const;
+        // 放入定时器 ---需持有写锁
+        void insert(const Timer::ptr &timer);
+        // 移除定时器 不存在返回false ---需持有写锁
+        bool erase(const Timer::ptr &timer);
+        // 取出now之前过期的定时器 循环定时器重新放入 返回合并节省的唤醒次数 ---需持有写锁
+        size_t expire(uint64_t now_us, std::vector<Timer::ptr> &expired);
+        // 检测服务器时间是否被调后
+        bool detectClockRollover(uint64_t now_us);
+
+        // 时间轮: 按过期时间与当前时间片的差值确定所在层级和槽
+        std::list<Timer::ptr> *wheelSlot(uint64_t expire);
+        // 时间轮: 标记槽是否为空
+        void wheelMark(std::list<Timer::ptr> *slot);
+        // 时间轮: 把槽中的定时器按当前时间片重新分配到下层
+        void wheelMove(std::list<Timer::ptr> &slot);
+        // 时间轮: 当前时间片进入新的一圈 下沉上层的定时器
+        void wheelCascade();
+        // 时间轮: 推进到now 收集过期定时器
+        void wheelExpire(uint64_t now_us, std::vector<Timer::ptr> &expired);
+        // 时间轮: 取出所有定时器
+        void wheelDrain(std::vector<Timer::ptr> &expired);
+
+        /// Mutex
+        RWMutexType m_mutex;
+        /// 定时器集合
+        std::set<Timer::ptr, Timer::Comparator> m_timers;
+        /// 是否触发onTimerInsertedAtFront
+        bool m_tickled = false;
+        /// 上次执行时间
+        uint64_t m_previouseTime = 0;
+
+        /// 是否使用时间轮
+        bool m_wheel = false;
+        /// 主时间轮(每槽1us)
+        std::list<Timer::ptr> m_near[TIME_NEAR];
+        /// 从时间轮
+        std::list<Timer::ptr> m_levels[4][TIME_LEVEL];
+        /// 超出时间轮范围(约71分钟)的定时器
+        std::list<Timer::ptr> m_far;
+        /// 主时间轮非空槽位图
+        uint64_t m_nearBits[TIME_NEAR / 64] = {0};
+        /// 从时间轮非空槽位图
+        uint64_t m_levelBits[4] = {0};
+        /// 时间轮当前时间片 之前的定时器都已取出
+        uint64_t m_wheelTime = 0;
+        /// 时间轮中的定时器数量
+        size_t m_wheelCount = 0;
+    };
+
+    // 定时器管理器 shards>1时按线程分片: 每个线程只过期自己分片的定时器
+    // 不属于任何分片的线程添加的定时器经无锁移交队列交给下一个空闲的线程接收
     class TimerManager
     {
         friend class Timer;
@@ -76,44 +159,79 @@ namespace Xten
         /// 读写锁类型
         typedef RWMutex RWMutexType;
 
-        TimerManager();
+        TimerManager(bool wheel = false, size_t shards = 1);
 
         virtual ~TimerManager();
-        // 添加定时器
-        Timer::ptr addTimer(uint64_t ms, std::function<void()> cb, bool recurring = false);
+        // 添加定时器 slack_ms为允许延后执行的时间(0表示准时)
+        Timer::ptr addTimer(uint64_t ms, std::function<void()> cb, bool recurring = false, uint64_t slack_ms = 0);
+
+        // 添加定时器(微秒)
+        Timer::ptr addTimerUs(uint64_t us, std::function<void()> cb, bool recurring = false, uint64_t slack_us = 0);
 
         // 添加条件定时器
-        Timer::ptr addConditionTimer(uint64_t ms, std::function<void()> cb, std::weak_ptr<void> weak_cond, bool recurring = false);
+        Timer::ptr addConditionTimer(uint64_t ms, std::function<void()> cb, std::weak_ptr<void> weak_cond, bool recurring = false, uint64_t slack_ms = 0);
 
-        // 到最近一个定时器执行的时间间隔(毫秒)
+        // 到最近一个定时器执行的时间间隔(毫秒 向上取整) 所有分片
         uint64_t getNextTimer();
 
-        // 获取需要执行的定时器的回调函数列表
+        // 到最近一个定时器执行的时间间隔(微秒) 所有分片
+        uint64_t getNextTimerUs();
+
+        // 获取需要执行的定时器的回调函数列表 所有分片
         void listExpiredCb(std::vector<std::function<void()>> &cbs);
 
         // 是否有定时器
         bool hasTimer();
 
+        // 是否使用时间轮
+        bool isWheel() const { return m_wheel; }
+
+        // 分片数
+        size_t getShardNum() const { return m_shards.size(); }
+
+        // 允许延后的定时器合并执行节省的唤醒次数
+        uint64_t getCoalescedWakeups() const { return m_coalesced.load(std::memory_order_relaxed); }
+
     protected:
         // 当有新的定时器插入到定时器的首部,执行该函数
         virtual void onTimerInsertedAtFront() = 0;
 
-        // 将定时器添加到管理器中
-        void addTimer(Timer::ptr val, RWMutexType::WriteLock &lock);
+        // 当前线程添加定时器使用的分片下标 -1表示交给移交队列(分片时由子类实现)
+        virtual int currentTimerShard() { return 0; }
+
+        // 分片shard到最近一个定时器执行的时间间隔(微秒) 先接收移交队列
+        uint64_t getNextTimerUs(int shard);
+
+        // 获取分片shard需要执行的定时器的回调函数列表
+        void listExpiredCb(int shard, std::vector<std::function<void()>> &cbs);
 
     private:
-        // 检测服务器时间是否被调后
-        bool detectClockRollover(uint64_t now_ms);
+        // 当前线程添加定时器的分片 没有返回nullptr
+        TimerShard *ownShard();
+        // 放入分片 返回是否需要通知onTimerInsertedAtFront ---需持有分片写锁
+        bool insertTimer(TimerShard *shard, const Timer::ptr &timer);
+        // 放入移交队列 队列由空变为非空时通知
+        void pushInbox(const Timer::ptr &timer);
+        // 移交队列中的定时器放入分片
+        void adoptInbox(TimerShard *shard);
+        // 锁住定时器当前所在位置 返回所在分片(在移交队列中为nullptr)
+        TimerShard *lockTimer(Timer *timer);
+        // 解锁lockTimer的返回值
+        void unlockTimer(TimerShard *shard);
+        // 收集分片中的过期回调
+        void listExpiredCb(TimerShard *shard, std::vector<std::function<void()>> &cbs);
 
     private:
-        /// Mutex
-        RWMutexType m_mutex;
-        /// 定时器集合
-        std::set<Timer::ptr, Timer::Comparator> m_timers;
-        /// 是否触发onTimerInsertedAtFront
-        bool m_tickled = false;
-        /// 上次执行时间
-        uint64_t m_previouseTime = 0;
+        /// 是否使用时间轮
+        bool m_wheel = false;
+        /// 分片
+        std::vector<std::unique_ptr<TimerShard>> m_shards;
+        /// 跨线程移交队列(无锁栈)
+        std::atomic<Timer *> m_inbox = {nullptr};
+        /// 保护移交队列中定时器的修改
+        SpinLock m_inboxMutex;
+        /// 合并节省的唤醒次数
+        std::atomic<uint64_t> m_coalesced = {0};
     };
 
     class TimerWheelManager;
@@ -0,0 +1,305 @@
+#include "uring.h"
+#ifdef XTEN_IO_URING
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include "log.h"
+#include "macro.h"
+namespace Xten
+{
+    static Logger::ptr g_logger = XTEN_LOG_NAME("system");
+
+    static int sys_io_uring_setup(uint32_t entries, io_uring_params *params)
+    {
+        return (int)syscall(__NR_io_uring_setup, entries, params);
+    }
+    static int sys_io_uring_enter(int fd, uint32_t to_submit, uint32_t min_complete, uint32_t flags)
+    {
+        return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0);
+    }
+    static int sys_io_uring_register(int fd, unsigned opcode, const void *arg, unsigned nr_args)
+    {
+        return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+    }
+
+    IoUring::IoUring()
+    {
+    }
+    IoUring::~IoUring()
+    {
+        if (_bufRing)
+        {
+            munmap(_bufRing, _bufRingSize);
+        }
+        if (_recvBase)
+        {
+            munmap(_recvBase, _recvSize * _recvCount);
+        }
+        if (_fixedBase)
+        {
+            munmap(_fixedBase, _fixedSize * _fixedCount);
+        }
+        if (_sqes)
+        {
+            munmap(_sqes, _sqesSize);
+        }
+        if (_cqRing && _cqRing != _sqRing)
+        {
+            munmap(_cqRing, _cqRingSize);
+        }
+        if (_sqRing)
+        {
+            munmap(_sqRing, _sqRingSize);
+        }
+        if (_fd >= 0)
+        {
+            ::close(_fd);
+        }
+    }
+    bool IoUring::Init(uint32_t entries)
+    {
+        io_uring_params params;
+        memset(&params, 0, sizeof params);
+        _fd = sys_io_uring_setup(entries, &params);
+        if (_fd < 0)
+        {
+            XTEN_LOG_WARN(g_logger) << "io_uring_setup(" << entries << ") failed errno=" << errno
+                                    << " errstr=" << strerror(errno);
+            return false;
+        }
+        _features = params.features;
+        // 映射提交队列和完成队列 内核支持时两者共用一次mmap
+        _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (_features & IORING_FEAT_SINGLE_MMAP)
+        {
+            _sqRingSize = _cqRingSize = std::max(_sqRingSize, _cqRingSize);
+        }
+        _sqRing = mmap(nullptr, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       _fd, IORING_OFF_SQ_RING);
+        if (_sqRing == MAP_FAILED)
+        {
+            _sqRing = nullptr;
+            XTEN_LOG_WARN(g_logger) << "io_uring mmap sq ring failed errno=" << errno;
+            return false;
+        }
+        if (_features & IORING_FEAT_SINGLE_MMAP)
+        {
+            _cqRing = _sqRing;
+        }
+        else
+        {
+            _cqRing = mmap(nullptr, _cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                           _fd, IORING_OFF_CQ_RING);
+            if (_cqRing == MAP_FAILED)
+            {
+                _cqRing = nullptr;
+                XTEN_LOG_WARN(g_logger) << "io_uring mmap cq ring failed errno=" << errno;
+                return false;
+            }
+        }
+        _sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void *sqes = mmap(nullptr, _sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          _fd, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+        {
+            XTEN_LOG_WARN(g_logger) << "io_uring mmap sqes failed errno=" << errno;
+            return false;
+        }
+        _sqes = (io_uring_sqe *)sqes;
+        char *sq = (char *)_sqRing;
+        _sqHead = (std::atomic<uint32_t> *)(sq + params.sq_off.head);
+        _sqTail = (std::atomic<uint32_t> *)(sq + params.sq_off.tail);
+        _sqFlags = (std::atomic<uint32_t> *)(sq + params.sq_off.flags);
+        _sqMask = *(uint32_t *)(sq + params.sq_off.ring_mask);
+        _sqEntries = *(uint32_t *)(sq + params.sq_off.ring_entries);
+        _sqArray = (uint32_t *)(sq + params.sq_off.array);
+        char *cq = (char *)_cqRing;
+        _cqHead = (std::atomic<uint32_t> *)(cq + params.cq_off.head);
+        _cqTail = (std::atomic<uint32_t> *)(cq + params.cq_off.tail);
+        _cqMask = *(uint32_t *)(cq + params.cq_off.ring_mask);
+        _cqes = (io_uring_cqe *)(cq + params.cq_off.cqes);
+        XTEN_LOG_INFO(g_logger) << "io_uring init fd=" << _fd << " sq_entries=" << params.sq_entries
+                                << " cq_entries=" << params.cq_entries << " features=" << _features;
+        return true;
+    }
+    io_uring_sqe *IoUring::GetSqe()
+    {
+        uint32_t head = _sqHead->load(std::memory_order_acquire);
+        if (_sqeTail - head >= _sqEntries)
+        {
+            // 提交队列满
+            return nullptr;
+        }
+        io_uring_sqe *sqe = &_sqes[_sqeTail & _sqMask];
+        _sqeTail++;
+        memset(sqe, 0, sizeof *sqe);
+        return sqe;
+    }
+    int IoUring::Submit()
+    {
+        uint32_t tail = _sqTail->load(std::memory_order_relaxed);
+        uint32_t to_submit = _sqeTail - _sqeHead;
+        if (to_submit == 0)
+        {
+            return 0;
+        }
+        while (_sqeHead != _sqeTail)
+        {
+            _sqArray[tail & _sqMask] = _sqeHead & _sqMask;
+            tail++;
+            _sqeHead++;
+        }
+        // 内核看到tail之前sqe内容必须已经写入
+        _sqTail->store(tail, std::memory_order_release);
+        int ret = 0;
+        do
+        {
+            ret = sys_io_uring_enter(_fd, to_submit, 0, 0);
+        } while (ret < 0 && errno == EINTR);
+        if (XTEN_UNLIKELY(ret < 0))
+        {
+            XTEN_LOG_ERROR(g_logger) << "io_uring_enter(" << _fd << ", " << to_submit << ") failed errno="
+                                     << errno << " errstr=" << strerror(errno);
+            return -errno;
+        }
+        return ret;
+    }
+    size_t IoUring::Reap(io_uring_cqe *cqes, size_t max)
+    {
+        // 完成队列曾经溢出(内核暂存了cqe) 需要进入内核把暂存的cqe刷回完成队列
+        if (XTEN_UNLIKELY(_sqFlags->load(std::memory_order_relaxed) & IORING_SQ_CQ_OVERFLOW))
+        {
+            sys_io_uring_enter(_fd, 0, 0, IORING_ENTER_GETEVENTS);
+        }
+        uint32_t head = _cqHead->load(std::memory_order_relaxed);
+        uint32_t tail = _cqTail->load(std::memory_order_acquire);
+        size_t count = 0;
+        while (head != tail && count < max)
+        {
+            cqes[count++] = _cqes[head & _cqMask];
+            head++;
+        }
+        // 通知内核cqe已经被取走
+        _cqHead->store(head, std::memory_order_release);
+        return count;
+    }
+    bool IoUring::RegisterFixedBuffers(uint32_t count, size_t size)
+    {
+        if (count == 0 || size == 0 || _fixedBase)
+        {
+            return false;
+        }
+        void *base = mmap(nullptr, size * count, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED)
+        {
+            XTEN_LOG_WARN(g_logger) << "io_uring mmap fixed buffers failed errno=" << errno;
+            return false;
+        }
+        std::vector<iovec> iovs(count);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            iovs[i].iov_base = (char *)base + (size_t)i * size;
+            iovs[i].iov_len = size;
+        }
+        if (sys_io_uring_register(_fd, IORING_REGISTER_BUFFERS, &iovs[0], count) < 0)
+        {
+            // 超出RLIMIT_MEMLOCK等 不使用固定缓冲区
+            XTEN_LOG_WARN(g_logger) << "io_uring register " << count << " fixed buffers failed errno="
+                                    << errno << " errstr=" << strerror(errno);
+            munmap(base, size * count);
+            return false;
+        }
+        _fixedBase = (char *)base;
+        _fixedSize = size;
+        _fixedCount = count;
+        _fixedFree.reserve(count);
+        for (int i = (int)count - 1; i >= 0; i--)
+        {
+            _fixedFree.push_back(i);
+        }
+        return true;
+    }
+    int IoUring::GetFixedBuffer()
+    {
+        MutexType::Lock lock(_fixedMutex);
+        if (_fixedFree.empty())
+        {
+            return -1;
+        }
+        int index = _fixedFree.back();
+        _fixedFree.pop_back();
+        return index;
+    }
+    void IoUring::PutFixedBuffer(int index)
+    {
+        MutexType::Lock lock(_fixedMutex);
+        _fixedFree.push_back(index);
+    }
+    bool IoUring::RegisterRecvBufRing(uint32_t count, size_t size)
+    {
+        if (count == 0 || count > 32768 || (count & (count - 1)) || size == 0 || _bufRing)
+        {
+            return false;
+        }
+        size_t ring_size = count * sizeof(io_uring_buf);
+        void *ring = mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ring == MAP_FAILED)
+        {
+            XTEN_LOG_WARN(g_logger) << "io_uring mmap buf ring failed errno=" << errno;
+            return false;
+        }
+        void *base = mmap(nullptr, size * count, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED)
+        {
+            XTEN_LOG_WARN(g_logger) << "io_uring mmap recv buffers failed errno=" << errno;
+            munmap(ring, ring_size);
+            return false;
+        }
+        io_uring_buf_reg reg;
+        memset(&reg, 0, sizeof reg);
+        reg.ring_addr = (uint64_t)(uintptr_t)ring;
+        reg.ring_entries = count;
+        reg.bgid = RECV_BUF_GROUP;
+        if (sys_io_uring_register(_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+        {
+            // 内核不支持(5.19之前)
+            XTEN_LOG_WARN(g_logger) << "io_uring register buf ring failed errno="
+                                    << errno << " errstr=" << strerror(errno);
+            munmap(base, size * count);
+            munmap(ring, ring_size);
+            return false;
+        }
+        _bufRing = (io_uring_buf_ring *)ring;
+        _bufRingSize = ring_size;
+        _bufRingMask = count - 1;
+        _recvBase = (char *)base;
+        _recvSize = size;
+        _recvCount = count;
+        // 所有缓冲区交给内核
+        for (uint32_t i = 0; i < count; i++)
+        {
+            io_uring_buf &buf = recvBufEntry(i);
+            buf.addr = (uint64_t)(uintptr_t)GetRecvBufferAddr(i);
+            buf.len = (uint32_t)size;
+            buf.bid = (uint16_t)i;
+        }
+        __atomic_store_n(&_bufRing->tail, (uint16_t)count, __ATOMIC_RELEASE);
+        return true;
+    }
+    void IoUring::RecycleRecvBuffer(uint16_t bid)
+    {
+        MutexType::Lock lock(_bufRingMutex);
+        uint16_t tail = _bufRing->tail;
+        io_uring_buf &buf = recvBufEntry(tail & _bufRingMask);
+        buf.addr = (uint64_t)(uintptr_t)GetRecvBufferAddr(bid);
+        buf.len = (uint32_t)_recvSize;
+        buf.bid = bid;
+        // 内核看到tail之前缓冲区描述必须已经写入
+        __atomic_store_n(&_bufRing->tail, (uint16_t)(tail + 1), __ATOMIC_RELEASE);
+    }
+}
+#endif
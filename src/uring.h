@@ -0,0 +1,106 @@
+#ifndef __XTEN_URING_H__
+#define __XTEN_URING_H__
+#ifdef XTEN_IO_URING
+#include <linux/io_uring.h>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <errno.h>
+#include <vector>
+#include "mutex.h"
+#include "nocopyable.hpp"
+namespace Xten
+{
+    /// @brief 基于原始系统调用封装的io_uring实例(不依赖liburing)
+    /// 1.提交队列(SQ)多线程共享 GetSqe/Submit 需要持有 GetSqMutex()
+    /// 2.完成队列(CQ)由 Reap 批量取出 调用者保证同一时刻只有一个线程收割
+    class IoUring : public NoCopyable
+    {
+    public:
+        typedef SpinLock MutexType;
+        IoUring();
+        ~IoUring();
+        // 创建io_uring 内核不支持(或被禁止)返回false
+        bool Init(uint32_t entries);
+        // io_uring对应的fd(可以放入epoll 有完成事件时可读)
+        int GetFd() const { return _fd; }
+        // 内核支持的特性 IORING_FEAT_*
+        uint32_t GetFeatures() const { return _features; }
+        // 提交队列锁
+        MutexType &GetSqMutex() { return _sqMutex; }
+        // 获取一个空闲sqe(已清零) 提交队列满返回nullptr ---需持有提交队列锁
+        io_uring_sqe *GetSqe();
+        // 提交已准备好的sqe 返回提交数量 失败返回-errno ---需持有提交队列锁
+        int Submit();
+        // 取出已完成的cqe(拷贝到cqes) 最多max个 返回数量 ---调用者串行化
+        size_t Reap(io_uring_cqe *cqes, size_t max);
+
+        // 注册固定缓冲区(count个size大小) 内核只在注册时pin一次内存 READ_FIXED/WRITE_FIXED直接使用
+        bool RegisterFixedBuffers(uint32_t count, size_t size);
+        // 取一个空闲固定缓冲区 返回下标 没有空闲返回-1
+        int GetFixedBuffer();
+        // 归还固定缓冲区
+        void PutFixedBuffer(int index);
+        // 固定缓冲区地址
+        void *GetFixedBufferAddr(int index) const { return _fixedBase + (size_t)index * _fixedSize; }
+        // 固定缓冲区大小(未注册为0)
+        size_t GetFixedBufferSize() const { return _fixedSize; }
+
+        // 提供给multishot recv的缓冲区组id
+        static const uint16_t RECV_BUF_GROUP = 0;
+        // 注册提供缓冲区环(count必须是2的幂) 内核收到数据时从环中挑选缓冲区
+        bool RegisterRecvBufRing(uint32_t count, size_t size);
+        // 是否注册了提供缓冲区环
+        bool HasRecvBufRing() const { return _bufRing != nullptr; }
+        // 提供缓冲区地址(cqe flags中的bid)
+        void *GetRecvBufferAddr(uint16_t bid) const { return _recvBase + (size_t)bid * _recvSize; }
+        // 数据取走后把缓冲区还给内核
+        void RecycleRecvBuffer(uint16_t bid);
+
+    private:
+        // 环中第i个缓冲区描述
+        // 不能用_bufRing->bufs: 内核头文件的柔性数组前有一个空结构体 C++中空结构体占1字节 bufs会错位8字节
+        io_uring_buf &recvBufEntry(uint32_t i) { return ((io_uring_buf *)_bufRing)[i]; }
+
+    private:
+        int _fd = -1;          // io_uring fd
+        uint32_t _features = 0; // 内核特性
+        // 提交队列
+        void *_sqRing = nullptr;
+        size_t _sqRingSize = 0;
+        std::atomic<uint32_t> *_sqHead = nullptr;
+        std::atomic<uint32_t> *_sqTail = nullptr;
+        std::atomic<uint32_t> *_sqFlags = nullptr;
+        uint32_t _sqMask = 0;
+        uint32_t _sqEntries = 0;
+        uint32_t *_sqArray = nullptr;
+        io_uring_sqe *_sqes = nullptr;
+        size_t _sqesSize = 0;
+        uint32_t _sqeHead = 0; // 已提交给内核的位置
+        uint32_t _sqeTail = 0; // 已分配的位置
+        MutexType _sqMutex;
+        // 完成队列
+        void *_cqRing = nullptr;
+        size_t _cqRingSize = 0;
+        std::atomic<uint32_t> *_cqHead = nullptr;
+        std::atomic<uint32_t> *_cqTail = nullptr;
+        uint32_t _cqMask = 0;
+        io_uring_cqe *_cqes = nullptr;
+        // 固定缓冲区
+        char *_fixedBase = nullptr;
+        size_t _fixedSize = 0;
+        uint32_t _fixedCount = 0;
+        std::vector<int> _fixedFree; // 空闲下标
+        MutexType _fixedMutex;
+        // 提供缓冲区环
+        io_uring_buf_ring *_bufRing = nullptr;
+        size_t _bufRingSize = 0;
+        uint32_t _bufRingMask = 0;
+        char *_recvBase = nullptr;
+        size_t _recvSize = 0;
+        uint32_t _recvCount = 0;
+        MutexType _bufRingMutex;
+    };
+}
+#endif
+#endif
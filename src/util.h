@@ -83,6 +83,19 @@ namespace Xten
         };
         return std::make_shared<Helper>(std::forward<Args>(args)...);
     }
+    // 同protected_make_shared 对象和控制块使用alloc分配
+    template <class T, class Alloc, class... Args>
+    inline std::shared_ptr<T> protected_allocate_shared(const Alloc &alloc, Args &&...args)
+    {
+        struct Helper : public T
+        {
+            Helper(Args &&...args)
+                : T(std::forward<Args>(args)...)
+            {
+            }
+        };
+        return std::allocate_shared<Helper>(alloc, std::forward<Args>(args)...);
+    }
     class StringUtil
     {
     public:
@@ -3,6 +3,7 @@
 #include <endian.h>
 #include "config.h"
 #include "../iomanager.h"
+#include "../objpool.h"
 #include "ws_server.h"
 namespace Xten
 {
@@ -200,6 +201,7 @@ namespace Xten
                 _timer->cancel(); // cancel previous timer
             _timer.reset();
             auto wkself = std::weak_ptr<WSSession>(shared_from_this());
+            // 空闲超时不要求准时 允许延后1/8超时时间 与其他会话的定时器合并唤醒
             _timer = Xten::IOManager::GetThis()->addTimer(_timeout, [wkself]()
                                                           {
                 auto self=wkself.lock();
@@ -212,7 +214,7 @@ namespace Xten
                     self->SendMessage("long time no action,cut down connection",WSFrameHead::OPCODE::CLOSE,true);
                     self->ForceClose(); 
                     self->_timer.reset();
-                } }, false);
+                } }, false, _timeout / 8);
         }
 
         // 发送websocket消息体结构
@@ -226,7 +228,7 @@ namespace Xten
                                     int32_t opcode, bool fin)
         {
             // return WSSendMessage(this, std::make_shared<WSFrameMessage>(opcode,data), false, fin);
-            pushMessage(std::make_shared<WSFrameMessage>(opcode, data), fin);
+            pushMessage(ObjPoolMakeShared<WSFrameMessage>(opcode, data), fin);
         }
         // 响应入队列函数
         void WSSession::pushMessage(WSFrameMessage::ptr msg, bool fin)
@@ -252,13 +254,13 @@ namespace Xten
         // 发送心跳ping帧
         void WSSession::Ping()
         {
-            pushMessage(std::make_shared<WSFrameMessage>(WSFrameHead::OPCODE::PING), true);
+            pushMessage(ObjPoolMakeShared<WSFrameMessage>(WSFrameHead::OPCODE::PING), true);
         }
         // 发送心跳pong帧
         void WSSession::Pong()
         {
             // return WSPong(this);
-            pushMessage(std::make_shared<WSFrameMessage>(WSFrameHead::OPCODE::PONG), true);
+            pushMessage(ObjPoolMakeShared<WSFrameMessage>(WSFrameHead::OPCODE::PONG), true);
         }
         extern int32_t WSSendMessage(Stream *stream, WSFrameMessage::ptr msg, bool client, bool fin)
         {
@@ -453,7 +455,7 @@ namespace Xten
                     {
                         // 最后一个继续帧
                         XTEN_LOG_DEBUG(g_logger) << data;
-                        return std::make_shared<WSFrameMessage>(opcode, data);
+                        return ObjPoolMakeShared<WSFrameMessage>(opcode, data);
                     }
                     // 不是最后一个继续帧---继续读取
                 }
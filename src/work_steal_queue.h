@@ -0,0 +1,120 @@
+#ifndef __XTEN_WORK_STEAL_QUEUE_H__
+#define __XTEN_WORK_STEAL_QUEUE_H__
+#include <atomic>
+#include <vector>
+#include <cstdint>
+#include "nocopyable.hpp"
+namespace Xten
+{
+    // 有界无锁Chase-Lev任务窃取双端队列
+    // 1.所属线程(owner)在bottom端 Push/Pop (LIFO)
+    // 2.其他线程(thief)在top端 Steal (FIFO)
+    // 内存序参考: Correct and Efficient Work-Stealing for Weak Memory Models (Lê et al. 2013)
+    // T 必须是可以原子读写的平凡类型(一般是指针)
+    template <class T>
+    class WorkStealQueue : public NoCopyable
+    {
+    public:
+        // capacity 会向上取整为2的幂
+        explicit WorkStealQueue(size_t capacity = 1024)
+            : _top(0), _bottom(0)
+        {
+            size_t cap = 2;
+            while (cap < capacity)
+            {
+                cap <<= 1;
+            }
+            _mask = cap - 1;
+            _buffer = std::vector<std::atomic<T>>(cap);
+        }
+        // 放入任务(仅所属线程调用) 队列满返回false
+        bool Push(T item)
+        {
+            int64_t b = _bottom.load(std::memory_order_relaxed);
+            int64_t t = _top.load(std::memory_order_acquire);
+            if (b - t > (int64_t)_mask)
+            {
+                return false;
+            }
+            _buffer[b & _mask].store(item, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            _bottom.store(b + 1, std::memory_order_relaxed);
+            return true;
+        }
+        // 批量放入任务(仅所属线程调用) 只发布一次bottom 返回实际放入的数量
+        size_t PushBatch(const T *items, size_t count)
+        {
+            int64_t b = _bottom.load(std::memory_order_relaxed);
+            int64_t t = _top.load(std::memory_order_acquire);
+            size_t space = (size_t)((int64_t)_mask + 1 - (b - t));
+            size_t n = count < space ? count : space;
+            for (size_t i = 0; i < n; i++)
+            {
+                _buffer[(b + (int64_t)i) & _mask].store(items[i], std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_release);
+            _bottom.store(b + (int64_t)n, std::memory_order_relaxed);
+            return n;
+        }
+        // 取出任务(仅所属线程调用) 队列空返回false
+        bool Pop(T &item)
+        {
+            int64_t b = _bottom.load(std::memory_order_relaxed) - 1;
+            _bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = _top.load(std::memory_order_relaxed);
+            if (t > b)
+            {
+                // 队列为空
+                _bottom.store(b + 1, std::memory_order_relaxed);
+                return false;
+            }
+            item = _buffer[b & _mask].load(std::memory_order_relaxed);
+            if (t == b)
+            {
+                // 最后一个元素--与窃取线程竞争
+                bool win = _top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                        std::memory_order_relaxed);
+                _bottom.store(b + 1, std::memory_order_relaxed);
+                return win;
+            }
+            return true;
+        }
+        // 窃取任务(任意线程调用) 队列空或竞争失败返回false
+        bool Steal(T &item)
+        {
+            int64_t t = _top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = _bottom.load(std::memory_order_acquire);
+            if (t >= b)
+            {
+                return false;
+            }
+            item = _buffer[t & _mask].load(std::memory_order_relaxed);
+            return _top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                std::memory_order_relaxed);
+        }
+        // 近似任务数量
+        size_t Size() const
+        {
+            int64_t b = _bottom.load(std::memory_order_relaxed);
+            int64_t t = _top.load(std::memory_order_relaxed);
+            return b > t ? (size_t)(b - t) : 0;
+        }
+        bool Empty() const
+        {
+            return Size() == 0;
+        }
+        size_t Capacity() const
+        {
+            return _mask + 1;
+        }
+
+    private:
+        alignas(64) std::atomic<int64_t> _top;    // 窃取端
+        alignas(64) std::atomic<int64_t> _bottom; // 所属线程端
+        alignas(64) size_t _mask;                 // 容量掩码
+        std::vector<std::atomic<T>> _buffer;      // 环形缓冲区
+    };
+}
+#endif
@@ -151,7 +151,7 @@ namespace Xten
         Message::ptr XftpMessageDecoder::ParseFromStream(Stream::ptr stream)
         {
             XftpMsgHead head;
-            ByteArray::ptr ba = std::make_shared<ByteArray>();
+            ByteArray::ptr ba;
             do
             {
                 // 先读取Xftp头
@@ -172,6 +172,8 @@ namespace Xten
                     break;
                 }
                 head.length = be32toh(head.length);
+                // body按长度一次申请连续缓冲区 读入和解析都不跨节点(初始容量封顶 不足时倍增)
+                ba = std::make_shared<ByteArray>(std::min<size_t>(head.length, 1024 * 1024), true);
                 // 长度合法，读取指定长度的数据
                 if (stream->ReadFixSize(ba, head.length) <= 0)
                 {
@@ -80,8 +80,10 @@ namespace Xten
             {
                 // 这里不能直接调用pushMessage---因为发送逻辑要放到iomanager中
                 // 并不能严格保证调用和执行的顺序完全一致！！！---->其实是没有很大的影响，因为客户端接受文件分片的响应不要严格与发送顺序一致
-                iom->Schedule([session, sn, rsp]()
-                              { session->pushResponse(sn, rsp); });
+                // 文件分片响应属于后台批量任务 低优先级执行 不影响延迟敏感的请求
+                iom->SchedulePriority([session, sn, rsp]()
+                                      { session->pushResponse(sn, rsp); },
+                                      Scheduler::PRIORITY_LOW);
             }
         }
     }
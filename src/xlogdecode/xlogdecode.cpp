@@ -0,0 +1,233 @@
+#include "../binlog.h"
+#include <fstream>
+#include <iterator>
+
+/* 把BinaryFileLogAppender输出的二进制日志文件还原成文本
+   example:
+   ./xlogdecode ./log/server.binlog                       使用默认格式输出
+   ./xlogdecode -f "%d{%H:%M:%S}%T[%p]%T%m%n" a.binlog     指定格式(同日志配置的formatter)
+*/
+
+// 站点信息(来自文件中的SITE记录)
+struct SiteInfo
+{
+    Xten::LogLevel::Level level;
+    uint32_t line;
+    std::string file;
+    std::string fmt;
+    std::vector<uint8_t> types;
+};
+
+// 按顺序读取记录内容
+class Reader
+{
+public:
+    Reader(const char *data, size_t len) : _cur(data), _end(data + len) {}
+    template <class T>
+    T get()
+    {
+        T val{};
+        if (_cur + sizeof(T) <= _end)
+        {
+            memcpy(&val, _cur, sizeof(T));
+        }
+        _cur += sizeof(T);
+        return val;
+    }
+    std::string getString()
+    {
+        uint32_t len = get<uint32_t>();
+        if (!ok() || _cur + len > _end)
+        {
+            _cur = _end + 1;
+            return "";
+        }
+        std::string str(_cur, len);
+        _cur += len;
+        return str;
+    }
+    bool ok() const { return _cur <= _end; }
+    const char *cur() const { return _cur; }
+    size_t left() const { return ok() ? _end - _cur : 0; }
+
+private:
+    const char *_cur;
+    const char *_end;
+};
+
+class Decoder
+{
+public:
+    Decoder(const std::string &pattern) : _formatter(std::make_shared<Xten::Formatter>(pattern)) {}
+    // 解码一个文件 返回是否成功
+    bool decode(const std::string &filename, std::ostream &os)
+    {
+        std::ifstream ifs(filename, std::ios::binary);
+        if (!ifs)
+        {
+            std::cerr << "open " << filename << " failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+        std::string content((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+        size_t pos = 0;
+        std::string out;
+        while (pos + 5 <= content.size())
+        {
+            uint32_t len;
+            memcpy(&len, &content[pos], sizeof(len));
+            if (len < 5 || pos + len > content.size())
+            {
+                // 最后一条记录不完整(文件还在写入)
+                std::cerr << filename << ": truncated record at offset " << pos << std::endl;
+                break;
+            }
+            uint8_t type = content[pos + 4];
+            Reader r(content.data() + pos + 5, len - 5);
+            if (!record(type, r, out))
+            {
+                std::cerr << filename << ": bad record type=" << (int)type << " at offset " << pos << std::endl;
+                return false;
+            }
+            pos += len;
+            if (out.size() > 64 * 1024)
+            {
+                os << out;
+                out.clear();
+            }
+        }
+        os << out;
+        return true;
+    }
+
+private:
+    bool record(uint8_t type, Reader &r, std::string &out)
+    {
+        switch (type)
+        {
+        case Xten::LOG_RECORD_SESSION:
+        {
+            if (r.get<uint32_t>() != Xten::XTEN_BINLOG_MAGIC)
+            {
+                return false;
+            }
+            // 新的进程会话 id重新开始
+            _sites.clear();
+            _names.clear();
+            _loggers.clear();
+            return true;
+        }
+        case Xten::LOG_RECORD_SITE:
+        {
+            uint32_t id = r.get<uint32_t>();
+            SiteInfo &site = _sites[id];
+            site.level = (Xten::LogLevel::Level)r.get<uint8_t>();
+            site.line = r.get<uint32_t>();
+            site.file = r.getString();
+            site.fmt = r.getString();
+            uint8_t count = r.get<uint8_t>();
+            if (r.left() < count)
+            {
+                return false;
+            }
+            site.types.assign(r.cur(), r.cur() + count);
+            return r.ok();
+        }
+        case Xten::LOG_RECORD_NAME:
+        {
+            uint32_t id = r.get<uint32_t>();
+            _names[id] = r.getString();
+            return r.ok();
+        }
+        case Xten::LOG_RECORD_EVENT:
+        {
+            uint32_t site_id = r.get<uint32_t>();
+            uint32_t logger_id = r.get<uint32_t>();
+            uint32_t thread_name_id = r.get<uint32_t>();
+            uint32_t thread_id = r.get<uint32_t>();
+            uint32_t fiber_id = r.get<uint32_t>();
+            uint64_t time_us = r.get<uint64_t>();
+            if (!r.ok())
+            {
+                return false;
+            }
+            auto it = _sites.find(site_id);
+            if (it == _sites.end())
+            {
+                out.append("<<unknown log site id=" + std::to_string(site_id) + ">>\n");
+                return true;
+            }
+            SiteInfo &site = it->second;
+            Xten::Logger::ptr logger = getLogger(logger_id);
+            Xten::LogEvent::ptr ev = std::make_shared<Xten::LogEvent>(logger, site.level, site.file, site.line, 0,
+                                                                      thread_id, fiber_id, time_us / 1000000, _names[thread_name_id]);
+            ev->GetSStream() << Xten::LogBinaryFormat(site.fmt.c_str(), site.types.data(), site.types.size(), r.cur(), r.left());
+            _formatter->formatTo(out, logger, site.level, ev);
+            return true;
+        }
+        case Xten::LOG_RECORD_TEXT:
+        {
+            r.get<uint32_t>(); // 日志器名字id
+            r.get<uint8_t>();  // 日志级别
+            r.get<uint64_t>(); // 时间
+            out.append(r.getString());
+            return r.ok();
+        }
+        default:
+            return false;
+        }
+    }
+    Xten::Logger::ptr getLogger(uint32_t id)
+    {
+        auto it = _loggers.find(id);
+        if (it != _loggers.end())
+        {
+            return it->second;
+        }
+        auto name = _names.find(id);
+        Xten::Logger::ptr logger = std::make_shared<Xten::Logger>(name == _names.end() ? "unknown" : name->second);
+        _loggers[id] = logger;
+        return logger;
+    }
+
+private:
+    Xten::Formatter::ptr _formatter;
+    std::unordered_map<uint32_t, SiteInfo> _sites;
+    std::unordered_map<uint32_t, std::string> _names;
+    std::unordered_map<uint32_t, Xten::Logger::ptr> _loggers;
+};
+
+int main(int argc, char **argv)
+{
+    std::string pattern = "%d{%Y-%m-%d %H:%M:%S}%T%t%T%N%T%F%T[%p]%T[%c]%T%f:%l%T%m%n";
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "-f" && i + 1 < argc)
+        {
+            pattern = argv[++i];
+        }
+        else if (arg == "-h" || arg == "--help")
+        {
+            files.clear();
+            break;
+        }
+        else
+        {
+            files.push_back(arg);
+        }
+    }
+    if (files.empty())
+    {
+        std::cout << "Usage: " << argv[0] << " [-f formatter_pattern] [binlog_file]..." << std::endl;
+        std::cout << "example: " << argv[0] << " ./log/server.binlog" << std::endl;
+        return 1;
+    }
+    Decoder decoder(pattern);
+    bool ok = true;
+    for (auto &file : files)
+    {
+        ok &= decoder.decode(file, std::cout);
+    }
+    return ok ? 0 : 1;
+}
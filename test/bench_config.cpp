@@ -0,0 +1,55 @@
+// 配置项读取耗时测试: 多线程并发读取ConfigVar 同时有一个线程不断重载配置
+#include "../src/Xten.h"
+#include "bench_util.h"
+
+static const int s_threads = 8;
+static const int s_reads_per_thread = 5000000;
+
+static Xten::ConfigVar<uint32_t>::ptr g_bench_int =
+    Xten::Config::LookUp("bench.config.int", (uint32_t)128 * 1024, "bench config int");
+static Xten::ConfigVar<std::vector<std::string>>::ptr g_bench_vec =
+    Xten::Config::LookUp("bench.config.vec", std::vector<std::string>{"a", "b", "c"}, "bench config vector");
+
+// 多线程并发读取: 每个线程调用s_reads_per_thread次func 输出每个线程每次读取的平均耗时
+template <class F>
+static void bench_concurrent(const std::string &name, F func)
+{
+    std::atomic<bool> stop{false};
+    Xten::Thread writer([&stop]()
+                        {
+        uint32_t i = 0;
+        while (!stop)
+        {
+            g_bench_int->SetValue(128 * 1024 + (++i & 1));
+            usleep(1000);
+        } }, "config_writer");
+    std::atomic<uint64_t> sum{0};
+    uint64_t cost = bench_elapsed_ns([&]()
+                                     {
+        std::vector<Xten::Thread::ptr> threads;
+        for (int i = 0; i < s_threads; i++)
+        {
+            threads.push_back(std::make_shared<Xten::Thread>([&func, &sum]()
+                                                             { sum += bench_loop(s_reads_per_thread, func); },
+                                                             "bench_" + std::to_string(i)));
+        }
+        for (auto &t : threads)
+        {
+            t->join();
+        } });
+    stop = true;
+    writer.join();
+    bench_report(name, "read", s_reads_per_thread, cost,
+                 "threads=" + std::to_string(s_threads) + " sum=" + std::to_string(sum));
+}
+
+int main(int argc, char **argv)
+{
+    bench_concurrent("int", [](uint64_t)
+                     { return (uint64_t)g_bench_int->GetValue(); });
+    bench_concurrent("vector", [](uint64_t)
+                     { return (uint64_t)g_bench_vec->GetValue().size(); });
+    bench_concurrent("vector_ref", [](uint64_t)
+                     { return (uint64_t)g_bench_vec->GetValueRef().size(); });
+    return 0;
+}
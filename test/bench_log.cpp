@@ -0,0 +1,58 @@
+// 日志落地吞吐测试: 多线程同时写INFO日志 对比FileLogsinker AsyncFileLogsinker和BinaryFileLogsinker(二进制日志)
+#include "../src/Xten.h"
+#include "bench_util.h"
+
+static const int s_threads = 16;
+static const int s_logs_per_thread = 50000;
+
+static void run(const std::string &name, Xten::Logsinker::ptr sinker, bool binary = false)
+{
+    Xten::Logger::ptr logger = XTEN_LOG_NAME("bench_" + name);
+    logger->ClearSinkers();
+    logger->AddSinkers(name, sinker);
+    auto func = [&logger, binary](uint64_t j)
+    {
+        if (binary)
+        {
+            XTEN_LOG_BIN_INFO(logger, "bench log line j=%d", (int)j);
+        }
+        else
+        {
+            XTEN_LOG_INFO(logger) << "bench log line j=" << j;
+        }
+    };
+    uint64_t cost = bench_elapsed_ns([&]()
+                                     {
+        std::vector<Xten::Thread::ptr> threads;
+        for (int i = 0; i < s_threads; i++)
+        {
+            threads.push_back(std::make_shared<Xten::Thread>([&func]()
+                                                             { bench_loop(s_logs_per_thread, func); },
+                                                             "bench_" + std::to_string(i)));
+        }
+        for (auto &t : threads)
+        {
+            t->join();
+        } });
+    uint64_t total = (uint64_t)s_threads * s_logs_per_thread;
+    std::string extra = "threads=" + std::to_string(s_threads) +
+                        " rate=" + std::to_string((uint64_t)(total * 1e9 / cost)) + "/s";
+    auto async = std::dynamic_pointer_cast<Xten::AsyncFileLogsinker>(sinker);
+    if (async)
+    {
+        extra += " dropped=" + std::to_string(async->GetDroppedCount());
+    }
+    // 多线程并发写入 按总条数平均
+    bench_report(name, "log", total, cost, extra);
+    logger->ClearSinkers();
+}
+
+int main(int argc, char **argv)
+{
+    run("sync", std::make_shared<Xten::FileLogsinker>("/tmp/bench_log_sync.txt"));
+    run("block", std::make_shared<Xten::AsyncFileLogsinker>("/tmp/bench_log_block.txt", 100, 1024 * 1024, false));
+    run("drop", std::make_shared<Xten::AsyncFileLogsinker>("/tmp/bench_log_drop.txt", 100, 64 * 1024, true));
+    // 二进制日志 用bin/tools/xlogdecode /tmp/bench_log.binlog还原
+    run("binary", std::make_shared<Xten::BinaryFileLogsinker>("/tmp/bench_log.binlog", 100, 1024 * 1024, false), true);
+    return 0;
+}
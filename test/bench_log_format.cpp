@@ -0,0 +1,29 @@
+// 日志格式化耗时测试: 默认格式下每条日志事件的格式化耗时(ns/event)
+#include "../src/Xten.h"
+#include "bench_util.h"
+
+static const int s_events = 1000000;
+
+int main(int argc, char **argv)
+{
+    Xten::Logger::ptr logger = XTEN_LOG_NAME("bench_format");
+    Xten::Formatter::ptr fmt = std::make_shared<Xten::Formatter>();
+    Xten::LogEvent::ptr ev = std::make_shared<Xten::LogEvent>(logger, Xten::LogLevel::INFO, __FILE__, __LINE__, 0,
+                                                              Xten::ThreadUtil::GetThreadId(), 0, time(nullptr), Xten::Thread::GetName());
+    ev->GetSStream() << "bench log line j=" << 12345;
+    std::cout << fmt->format(logger, Xten::LogLevel::INFO, ev);
+
+    bench("string", "event", s_events, [&](uint64_t)
+          { return fmt->format(logger, Xten::LogLevel::INFO, ev).size(); });
+    std::string buffer;
+    bench("formatTo", "event", s_events, [&](uint64_t)
+          {
+        buffer.clear();
+        fmt->formatTo(buffer, logger, Xten::LogLevel::INFO, ev);
+        return buffer.size(); });
+    std::ofstream null("/dev/null");
+    bench("ostream", "event", s_events, [&](uint64_t)
+          {
+        fmt->format(null, logger, Xten::LogLevel::INFO, ev); });
+    return 0;
+}
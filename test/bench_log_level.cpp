@@ -0,0 +1,22 @@
+// 被过滤日志的耗时测试: 日志器级别DEBUG 落地类级别INFO时 XTEN_LOG_DEBUG的耗时(ns/op)
+#include "../src/Xten.h"
+#include "bench_util.h"
+
+static const int s_ops = 10000000;
+
+int main(int argc, char **argv)
+{
+    Xten::Logger::ptr logger = XTEN_LOG_NAME("bench_level");
+    logger->ClearSinkers();
+    Xten::Logsinker::ptr sinker = std::make_shared<Xten::FileLogsinker>("/dev/null");
+    sinker->SetLevelLimit(Xten::LogLevel::INFO);
+    logger->AddSinkers("null", sinker);
+
+    bench("stream", "op", s_ops, [&](uint64_t i)
+          { XTEN_LOG_DEBUG(logger) << "suppressed debug i=" << i; });
+    bench("fmt", "op", s_ops, [&](uint64_t i)
+          { XTEN_LOG_FMT_DEBUG(logger, "suppressed debug i=%d", (int)i); });
+    bench("binary", "op", s_ops, [&](uint64_t i)
+          { XTEN_LOG_BIN_DEBUG(logger, "suppressed debug i=%d", (int)i); });
+    return 0;
+}
@@ -0,0 +1,144 @@
+// 调度任务记录微基准测试: 旧的 std::function + FuncOrFiber + std::list 路径 对比 TaskNode 路径
+// 统计每个任务的耗时以及malloc次数
+#include "../src/Xten.h"
+#include "../src/task.h"
+#include "../src/work_steal_queue.h"
+#include <list>
+#include <new>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include "bench_util.h"
+
+static std::atomic<uint64_t> s_new_count = {0};
+void *operator new(size_t size)
+{
+    s_new_count.fetch_add(1, std::memory_order_relaxed);
+    void *ptr = malloc(size);
+    if (!ptr)
+    {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+void operator delete(void *ptr) noexcept
+{
+    free(ptr);
+}
+void operator delete(void *ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+static const int s_loop = 1000000;
+static uint64_t s_sink = 0;
+
+// 与调度器原来的任务实体相同的布局
+struct LegacyTask
+{
+    LegacyTask(std::function<void()> &&fc, int id) : threadId(id) { func.swap(fc); }
+    std::function<void()> func;
+    Xten::Fiber::ptr fiber;
+    int threadId = -1;
+};
+
+struct Result
+{
+    uint64_t cost; // 总耗时(纳秒)
+    uint64_t news; // 总malloc次数
+};
+
+static void report(const char *name, const Result &res)
+{
+    std::ostringstream extra;
+    extra << "malloc/task=" << res.news / (double)s_loop;
+    bench_report(name, "task", s_loop, res.cost, extra.str());
+}
+
+template <class Fn>
+static Result measure(Fn &&fn)
+{
+    uint64_t news = s_new_count;
+    Result res;
+    res.cost = bench_elapsed_ns(fn);
+    res.news = s_new_count - news;
+    return res;
+}
+
+// 旧路径: 每个任务构造std::function 入队std::list(加锁) 出队执行
+static Result bench_legacy()
+{
+    std::list<LegacyTask> queue;
+    Xten::RWMutex mutex;
+    auto step = [&](uint64_t i)
+    {
+        uint64_t a = i, b = i * 2, c = i * 3;
+        {
+            Xten::RWMutex::WriteLock lock(mutex);
+            queue.push_back(LegacyTask([a, b, c]()
+                                       { s_sink += a + b + c; }, -1));
+        }
+        Xten::RWMutex::WriteLock lock(mutex);
+        LegacyTask task = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        task.func();
+    };
+    return measure([&]()
+                   { bench_loop(s_loop, step); });
+}
+
+// 新路径: TaskNode(内部存放回调) + 线程本地无锁队列
+static Result bench_tasknode()
+{
+    Xten::WorkStealQueue<Xten::TaskNode *> queue(1024);
+    auto step = [&](uint64_t i)
+    {
+        uint64_t a = i, b = i * 2, c = i * 3;
+        queue.Push(Xten::TaskNode::New([a, b, c]()
+                                       { s_sink += a + b + c; }));
+        Xten::TaskNode *task = nullptr;
+        queue.Pop(task);
+        task->func();
+        Xten::TaskNode::Delete(task);
+    };
+    return measure([&]()
+                   { bench_loop(s_loop, step); });
+}
+
+// 完整调度器路径: 调度线程内部批量Schedule lambda
+static Result bench_scheduler()
+{
+    Xten::Scheduler sc(1, true, "bench");
+    sc.Start();
+    std::atomic<int> done = {0};
+    Result res = measure([&]()
+                         {
+        sc.Schedule([&]()
+                    {
+            for (int i = 0; i < s_loop; i++)
+            {
+                uint64_t a = i, b = i * 2;
+                Xten::Scheduler::GetThis()->Schedule([a, b, &done]()
+                                                     { s_sink += a + b; done++; });
+                if (i % 512 == 511)
+                {
+                    Xten::Fiber::YieldToReady();
+                }
+            } });
+        sc.Stop(); });
+    return res;
+}
+
+int main()
+{
+    Xten::Logger::ptr logger = XTEN_LOG_NAME("system");
+    logger->SetLevelLimit(Xten::LogLevel::ERROR);
+    report("legacy std::function + std::list", bench_legacy());
+    report("TaskNode + WorkStealQueue", bench_tasknode());
+    report("Scheduler::Schedule(lambda) end to end", bench_scheduler());
+    std::cout << "ObjPool mmap: " << Xten::ObjPoolAllocator::GetStats().systemAlloc
+              << " TaskFunc heap fallback: " << Xten::TaskFunc::GetHeapFallbackCount()
+              << " sink=" << s_sink << std::endl;
+    return 0;
+}
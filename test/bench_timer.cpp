@@ -0,0 +1,62 @@
+// 定时器管理器基准测试: 红黑树(std::set) 对比 多层时间轮
+// 1M个定时器的添加/取消/最近过期时间/过期收集耗时
+#include "../src/Xten.h"
+#include "../src/timer.h"
+#include <chrono>
+#include <thread>
+#include <iostream>
+#include "bench_util.h"
+
+static const int s_count = 1000000;
+static const uint64_t s_max_delay_ms = 2000;
+static uint64_t s_sink = 0;
+
+class BenchTimerManager : public Xten::TimerManager
+{
+public:
+    BenchTimerManager(bool wheel) : Xten::TimerManager(wheel) {}
+
+protected:
+    void onTimerInsertedAtFront() override {}
+};
+
+static void bench_manager(const std::string &name, bool wheel)
+{
+    BenchTimerManager mgr(wheel);
+    std::vector<Xten::Timer::ptr> timers;
+    timers.reserve(s_count);
+    uint64_t seed = 88172645463325252ull;
+    bench(name + " add", "timer", s_count, [&](uint64_t i)
+          {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        timers.push_back(mgr.addTimer(1 + seed % s_max_delay_ms, [i]()
+                                      { s_sink += i; })); });
+    bench(name + " next", "timer", s_count, [&](uint64_t)
+          { return mgr.getNextTimer(); });
+    // 取消一半
+    bench(name + " cancel", "timer", s_count / 2, [&](uint64_t i)
+          { timers[i * 2]->cancel(); });
+    timers.clear();
+    std::this_thread::sleep_for(std::chrono::milliseconds(s_max_delay_ms + 10));
+    std::vector<std::function<void()>> cbs;
+    uint64_t cost = bench_elapsed_ns([&]()
+                                     { mgr.listExpiredCb(cbs); });
+    for (auto &cb : cbs)
+    {
+        cb();
+    }
+    bench_report(name + " expire", "timer", s_count / 2, cost,
+                 "fired=" + std::to_string(cbs.size()) + " left=" + std::to_string(mgr.hasTimer()));
+}
+
+int main()
+{
+    Xten::Logger::ptr logger = XTEN_LOG_NAME("system");
+    logger->SetLevelLimit(Xten::LogLevel::ERROR);
+    bench_manager("std::set", false);
+    bench_manager("timing wheel", true);
+    std::cout << "sink=" << s_sink << std::endl;
+    return 0;
+}
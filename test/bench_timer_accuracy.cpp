@@ -0,0 +1,57 @@
+// 定时器精度测试: hook的usleep在毫秒精度(epoll_wait)和微秒精度(epoll_pwait2)下的唤醒延迟分布
+#include "../src/Xten.h"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include "bench_util.h"
+
+static const int s_samples = 2000;
+
+// 单个协程连续usleep(sleep_us) 记录每次实际唤醒比预期晚多少微秒
+static std::vector<uint64_t> run(bool high_res, uint64_t sleep_us)
+{
+    Xten::Config::LookUp<bool>("iomanager.timer_high_resolution")->SetValue(high_res);
+    std::vector<uint64_t> lateness;
+    lateness.reserve(s_samples);
+    {
+        Xten::IOManager iom(1, false, "accuracy");
+        auto sample = [&](uint64_t)
+        {
+            uint64_t cost = bench_elapsed_ns([&]()
+                                             { usleep(sleep_us); }) / 1000;
+            lateness.push_back(cost > sleep_us ? cost - sleep_us : 0);
+        };
+        iom.Schedule([&]()
+                     { bench_loop(s_samples, sample); });
+    }
+    std::sort(lateness.begin(), lateness.end());
+    return lateness;
+}
+
+// 输出延迟分位数(不是平均耗时 所以不走bench_report)
+static void report(bool high_res, uint64_t sleep_us)
+{
+    std::vector<uint64_t> lateness = run(high_res, sleep_us);
+    auto pct = [&](double p)
+    {
+        return lateness[std::min(lateness.size() - 1, (size_t)(lateness.size() * p))];
+    };
+    std::cout << std::left << std::setw(14) << (high_res ? "epoll_pwait2" : "epoll_wait")
+              << " usleep(" << std::setw(5) << sleep_us << ")"
+              << " late(us) p50=" << std::setw(6) << pct(0.5)
+              << " p90=" << std::setw(6) << pct(0.9)
+              << " p99=" << std::setw(6) << pct(0.99)
+              << " max=" << lateness.back() << std::endl;
+}
+
+int main()
+{
+    Xten::Logger::ptr logger = XTEN_LOG_NAME("system");
+    logger->SetLevelLimit(Xten::LogLevel::ERROR);
+    for (uint64_t sleep_us : {50, 200, 500, 2000})
+    {
+        report(false, sleep_us);
+        report(true, sleep_us);
+    }
+    return 0;
+}
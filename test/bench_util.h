@@ -0,0 +1,63 @@
+// 基准测试公共函数: 计时 循环调用 输出每次调用的平均耗时
+#ifndef __XTEN_BENCH_UTIL_H__
+#define __XTEN_BENCH_UTIL_H__
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <iostream>
+#include <iomanip>
+
+// 执行一次func 返回耗时(纳秒 steady_clock)
+template <class F>
+inline uint64_t bench_elapsed_ns(F &&func)
+{
+    auto begin = std::chrono::steady_clock::now();
+    func();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+}
+
+// 调用count次func(i) 返回func返回值之和(防止被优化掉 无返回值时为0)
+template <class F>
+inline uint64_t bench_loop(uint64_t count, F &func)
+{
+    uint64_t sum = 0;
+    for (uint64_t i = 0; i < count; i++)
+    {
+        if constexpr (std::is_void<decltype(func(i))>::value)
+        {
+            func(i);
+        }
+        else
+        {
+            sum += func(i);
+        }
+    }
+    return sum;
+}
+
+// 输出一行结果: 名字 调用次数 平均每次耗时 附加信息
+inline void bench_report(const std::string &name, const std::string &unit, uint64_t count, uint64_t cost_ns,
+                         const std::string &extra = "")
+{
+    std::cout << std::left << std::setw(12) << name
+              << " " << unit << "s=" << count
+              << " " << std::fixed << std::setprecision(2) << (double)cost_ns / count << " ns/" << unit;
+    if (!extra.empty())
+    {
+        std::cout << " " << extra;
+    }
+    std::cout << std::endl;
+}
+
+// 单线程计时执行count次func(i)并输出结果
+template <class F>
+inline void bench(const std::string &name, const std::string &unit, uint64_t count, F func)
+{
+    uint64_t sum = 0;
+    uint64_t cost = bench_elapsed_ns([&]()
+                                     { sum = bench_loop(count, func); });
+    bench_report(name, unit, count, cost, std::is_void<decltype(func(0))>::value ? "" : "sum=" + std::to_string(sum));
+}
+#endif
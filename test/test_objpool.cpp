@@ -0,0 +1,49 @@
+// 对象池跨线程释放测试: 在从未申请过该大小对象的线程上释放
+// 线程缓存应按批归还中心缓存 而不是每次释放都加锁归还 缓存数量也不会无限增长
+#include "../src/objpool.h"
+#include <iostream>
+#include <thread>
+#include <vector>
+
+static const size_t s_obj_size = 64;
+static const size_t s_count = 100000;
+
+int main(int argc, char **argv)
+{
+    std::vector<void *> objs;
+    objs.reserve(s_count);
+    for (size_t i = 0; i < s_count; i++)
+    {
+        objs.push_back(Xten::ObjPoolAllocator::Alloc(s_obj_size));
+    }
+    uint64_t release_num = 0;
+    size_t cached = 0;
+    std::thread t([&]()
+                  {
+        // 该线程只释放不申请
+        uint64_t before = Xten::ObjPoolAllocator::GetStats().centralRelease;
+        for (void *obj : objs)
+        {
+            Xten::ObjPoolAllocator::Dealloc(obj, s_obj_size);
+        }
+        release_num = Xten::ObjPoolAllocator::GetStats().centralRelease - before;
+        // 线程缓存中剩余的对象: 申请到需要从中心缓存获取为止
+        uint64_t fetch = Xten::ObjPoolAllocator::GetStats().centralFetch;
+        std::vector<void *> reuse;
+        while (Xten::ObjPoolAllocator::GetStats().centralFetch == fetch && reuse.size() <= s_count)
+        {
+            reuse.push_back(Xten::ObjPoolAllocator::Alloc(s_obj_size));
+        }
+        cached = reuse.size() - 1;
+        for (void *obj : reuse)
+        {
+            Xten::ObjPoolAllocator::Dealloc(obj, s_obj_size);
+        } });
+    t.join();
+    std::cout << "frees=" << s_count << " central_release=" << release_num
+              << " thread_cached=" << cached << std::endl;
+    // 每次归还一批(最多512个) 线程缓存不超过两批
+    bool ok = release_num > 0 && release_num <= s_count / 64 && cached <= 2 * 512;
+    std::cout << (ok ? "ok" : "FAILED") << std::endl;
+    return ok ? 0 : 1;
+}